@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+
+"""Compares harness benchmark results (see src/tests/harness_benchmarks.h) against a baseline.
+
+Inputs may be benchmarks.json files or result archives containing them. Exits with a non-zero status if any benchmark
+is slower than the baseline by more than the threshold.
+"""
+
+from __future__ import annotations
+
+import argparse
+import json
+import sys
+from typing import Dict
+
+import result_archive
+
+_RESULTS_FILE_NAME = "benchmarks.json"
+
+
+def load_benchmarks(path: str) -> Dict[str, dict]:
+    """Returns a map of benchmark name to its measurement."""
+    with open(path, "rb") as infile:
+        data = infile.read()
+
+    documents = []
+    if data.startswith(result_archive.FILE_MAGIC):
+        archive = result_archive.Archive(path)
+        for entry in archive.entries:
+            if entry.type == result_archive.PAYLOAD_LOG and entry.test == _RESULTS_FILE_NAME:
+                documents.append(json.loads(archive.payload(entry)))
+    else:
+        documents.append(json.loads(data))
+
+    ret = {}
+    for document in documents:
+        for benchmark in document.get("benchmarks", []):
+            ret[benchmark["name"]] = benchmark
+    return ret
+
+
+def _main(args) -> int:
+    baseline = load_benchmarks(args.baseline)
+    current = load_benchmarks(args.current)
+    if not current:
+        print(f"No benchmarks found in {args.current}", file=sys.stderr)
+        return 1
+
+    regressions = 0
+    print(f"{'benchmark':<24} {'baseline':>12} {'current':>12} {'change':>8}")
+    for name in sorted(current):
+        value = current[name][args.metric]
+        if name not in baseline:
+            print(f"{name:<24} {'-':>12} {value:>12.3f} {'new':>8}")
+            continue
+
+        base_value = baseline[name][args.metric]
+        change = (value - base_value) / base_value if base_value else 0.0
+        marker = ""
+        if change > args.threshold:
+            marker = "  REGRESSION"
+            regressions += 1
+        print(f"{name:<24} {base_value:>12.3f} {value:>12.3f} {change:>+8.1%}{marker}")
+
+    for name in sorted(set(baseline) - set(current)):
+        print(f"{name:<24} {baseline[name][args.metric]:>12.3f} {'-':>12} {'missing':>8}")
+
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+
+    def _parse_args():
+        parser = argparse.ArgumentParser(
+            description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+        )
+        parser.add_argument("baseline", help="Baseline benchmarks.json or result archive.")
+        parser.add_argument("current", help="benchmarks.json or result archive to compare.")
+        parser.add_argument(
+            "--metric",
+            default="median_ns_per_op",
+            choices=["median_ns_per_op", "min_ns_per_op"],
+            help="Measurement to compare.",
+        )
+        parser.add_argument(
+            "--threshold",
+            type=float,
+            default=0.05,
+            help="Fractional slowdown above which a benchmark is considered a regression.",
+        )
+        return parser.parse_args()
+
+    sys.exit(_main(_parse_args()))
@@ -0,0 +1,302 @@
+#!/usr/bin/env python3
+
+"""Compares the structured results of two nxdk_vsh_tests runs.
+
+Each side may be a result archive (see result_archive.py) or a directory containing `.results` files as written by
+`result_archive.py extract`. Entries are matched by suite, test and result title, and every output lane is compared
+using the same policy as `almost_equal` in src/tests/cpu_shader_tests.cpp:
+
+* NaN only matches NaN (any NaN representation is considered equivalent).
+* If the golden value is +/-0, the candidate must be within FLT_EPSILON of zero.
+* Infinities must match exactly.
+* Values of differing sign only match if they compare equal.
+* Otherwise the values may differ by at most `--ulps` units in the last place.
+"""
+
+from __future__ import annotations
+
+import argparse
+import json
+import os
+import struct
+import sys
+import time
+from concurrent.futures import ProcessPoolExecutor
+from dataclasses import asdict, dataclass
+from typing import Dict, Iterable, List, Optional, Tuple
+
+import result_archive
+
+FLT_EPSILON = 1.1920928955078125e-07
+DEFAULT_ULPS = 4
+
+# Below this many matched entries the comparison is done inline, as process startup would dominate.
+_MIN_ENTRIES_FOR_PARALLEL = 2048
+
+# (suite, test, title, occurrence) -> {register index: (x, y, z, w) bit patterns}
+ResultKey = Tuple[str, str, str, int]
+ResultSet = Dict[ResultKey, Dict[int, Tuple[int, int, int, int]]]
+
+_LANES = "xyzw"
+
+
+@dataclass
+class LaneDiff:
+    suite: str
+    test: str
+    title: str
+    register: int
+    lane: str
+    golden: int
+    candidate: int
+    reason: str
+    ulps: Optional[int]
+
+
+def _bits_to_float(bits: int) -> float:
+    return struct.unpack("<f", struct.pack("<I", bits))[0]
+
+
+def _is_nan(bits: int) -> bool:
+    return (bits & 0x7F800000) == 0x7F800000 and (bits & 0x007FFFFF) != 0
+
+
+def _is_inf(bits: int) -> bool:
+    return (bits & 0x7FFFFFFF) == 0x7F800000
+
+
+def _ordered(bits: int) -> int:
+    """Maps a float bit pattern onto a lexicographically ordered two's complement integer."""
+    if bits & 0x80000000:
+        return 0x80000000 - bits
+    return bits
+
+
+def ulp_distance(a: int, b: int) -> int:
+    return abs(_ordered(a) - _ordered(b))
+
+
+def compare_lane(golden: int, candidate: int, max_ulps: int) -> Tuple[Optional[str], Optional[int]]:
+    """Returns (failure reason, ulp distance) for a single lane. The reason is None if the values match."""
+    nan_golden = _is_nan(golden)
+    nan_candidate = _is_nan(candidate)
+    if nan_golden != nan_candidate:
+        return "nan", None
+    if nan_golden:
+        return None, None
+
+    if not golden or golden == 0x80000000:
+        if abs(_bits_to_float(candidate)) > FLT_EPSILON:
+            return "zero", None
+        return None, None
+
+    if _is_inf(golden) or _is_inf(candidate):
+        if golden != candidate:
+            return "inf", None
+        return None, None
+
+    if (golden ^ candidate) & 0x80000000:
+        if _bits_to_float(golden) != _bits_to_float(candidate):
+            return "sign", None
+        return None, None
+
+    distance = ulp_distance(golden, candidate)
+    if distance > max_ulps:
+        return "ulps", distance
+    return None, distance
+
+
+def compare_chunk(args) -> List[LaneDiff]:
+    chunk, max_ulps = args
+    diffs = []
+    for key, golden_outputs, candidate_outputs in chunk:
+        suite, test, title, _ = key
+        for register in sorted(golden_outputs.keys() | candidate_outputs.keys()):
+            golden = golden_outputs.get(register)
+            candidate = candidate_outputs.get(register)
+            if golden is None or candidate is None:
+                diffs.append(
+                    LaneDiff(
+                        suite,
+                        test,
+                        title,
+                        register,
+                        "*",
+                        golden[0] if golden else 0,
+                        candidate[0] if candidate else 0,
+                        "missing_register",
+                        None,
+                    )
+                )
+                continue
+
+            for lane in range(4):
+                reason, distance = compare_lane(golden[lane], candidate[lane], max_ulps)
+                if reason:
+                    diffs.append(
+                        LaneDiff(
+                            suite,
+                            test,
+                            title,
+                            register,
+                            _LANES[lane],
+                            golden[lane],
+                            candidate[lane],
+                            reason,
+                            distance,
+                        )
+                    )
+    return diffs
+
+
+def add_records(
+    result_set: ResultSet, suite: str, test: str, records: Iterable[result_archive.ResultRecord]
+):
+    occurrences: Dict[str, int] = {}
+    for record in records:
+        occurrence = occurrences.get(record.title, 0)
+        occurrences[record.title] = occurrence + 1
+        result_set[(suite, test, record.title, occurrence)] = record.outputs
+
+
+def load_results(path: str) -> ResultSet:
+    """Loads the structured results from an archive or an extracted archive directory."""
+    ret: ResultSet = {}
+
+    if os.path.isdir(path):
+        for root, _, files in os.walk(path):
+            for filename in files:
+                if not filename.endswith(".results"):
+                    continue
+                suite = os.path.relpath(root, path)
+                if suite == ".":
+                    suite = ""
+                with open(os.path.join(root, filename), "rb") as infile:
+                    records = result_archive.parse_results_payload(infile.read())
+                add_records(ret, suite, filename[: -len(".results")], records)
+        return ret
+
+    archive = result_archive.Archive(path)
+    for entry in archive.entries:
+        if entry.type != result_archive.PAYLOAD_RESULTS:
+            continue
+        records = result_archive.parse_results_payload(archive.payload(entry))
+        add_records(ret, entry.suite, entry.test, records)
+    return ret
+
+
+def compare(golden: ResultSet, candidate: ResultSet, max_ulps: int, jobs: int) -> List[LaneDiff]:
+    matched = [
+        (key, golden[key], candidate[key]) for key in sorted(golden.keys() & candidate.keys())
+    ]
+
+    if jobs <= 1 or len(matched) < _MIN_ENTRIES_FOR_PARALLEL:
+        return compare_chunk((matched, max_ulps))
+
+    chunk_size = (len(matched) + jobs - 1) // jobs
+    chunks = [(matched[i : i + chunk_size], max_ulps) for i in range(0, len(matched), chunk_size)]
+    diffs = []
+    with ProcessPoolExecutor(max_workers=jobs) as executor:
+        for chunk_diffs in executor.map(compare_chunk, chunks):
+            diffs.extend(chunk_diffs)
+    return diffs
+
+
+def _format_key(key: ResultKey) -> str:
+    suite, test, title, occurrence = key
+    title = title.replace("\n", " ")
+    if occurrence:
+        title = f"{title}#{occurrence}"
+    return f"{suite}/{test}: {title}"
+
+
+def _main(args) -> int:
+    start = time.perf_counter()
+    golden = load_results(args.golden)
+    candidate = load_results(args.candidate)
+    loaded = time.perf_counter()
+
+    diffs = compare(golden, candidate, args.ulps, args.jobs)
+    compared = time.perf_counter()
+
+    missing = sorted(golden.keys() - candidate.keys())
+    added = sorted(candidate.keys() - golden.keys())
+    failed_entries = {(d.suite, d.test, d.title) for d in diffs}
+    num_matched = len(golden.keys() & candidate.keys())
+
+    if args.json:
+        report = {
+            "golden": args.golden,
+            "candidate": args.candidate,
+            "max_ulps": args.ulps,
+            "matched": num_matched,
+            "failed": len(failed_entries),
+            "missing": [_format_key(k) for k in missing],
+            "added": [_format_key(k) for k in added],
+            "diffs": [asdict(d) for d in diffs],
+        }
+        json.dump(report, sys.stdout, indent=2)
+        print()
+    else:
+        for key in missing:
+            print(f"- {_format_key(key)}")
+        for key in added:
+            print(f"+ {_format_key(key)}")
+        for diff in diffs:
+            ulps = f" ({diff.ulps} ulps)" if diff.ulps is not None else ""
+            print(
+                f"! {diff.suite}/{diff.test}: {diff.title.replace(chr(10), ' ')} "
+                f"c[{diff.register}].{diff.lane} {diff.reason}{ulps}: "
+                f"golden {_bits_to_float(diff.golden):g} (0x{diff.golden:08X}) "
+                f"candidate {_bits_to_float(diff.candidate):g} (0x{diff.candidate:08X})"
+            )
+
+        print(
+            f"{num_matched} matched, {num_matched - len(failed_entries)} passed, {len(failed_entries)} failed, "
+            f"{len(diffs)} lane difference(s), {len(missing)} missing, {len(added)} added"
+        )
+        print(
+            f"Loaded in {(loaded - start) * 1000:.1f}ms, compared in {(compared - loaded) * 1000:.1f}ms",
+            file=sys.stderr,
+        )
+
+    return 1 if diffs or missing else 0
+
+
+if __name__ == "__main__":
+
+    def _parse_args():
+        parser = argparse.ArgumentParser(
+            description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+        )
+
+        parser.add_argument(
+            "golden",
+            help="Result archive or extracted directory containing the expected results.",
+        )
+        parser.add_argument(
+            "candidate",
+            help="Result archive or extracted directory containing the results to check.",
+        )
+        parser.add_argument(
+            "--ulps",
+            type=int,
+            default=DEFAULT_ULPS,
+            help="Maximum number of units in the last place that values may differ by.",
+        )
+        parser.add_argument(
+            "-j",
+            "--jobs",
+            type=int,
+            default=os.cpu_count() or 1,
+            help="Number of worker processes used for large comparisons.",
+        )
+        parser.add_argument(
+            "--json",
+            action="store_true",
+            help="Emit the report as JSON instead of text.",
+        )
+
+        return parser.parse_args()
+
+    sys.exit(_main(_parse_args()))
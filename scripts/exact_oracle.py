@@ -0,0 +1,379 @@
+#!/usr/bin/env python3
+
+"""Compares CPU Shader Tests results against correctly rounded results computed on the host.
+
+Reads the mismatches.bin written in builds configured with ENABLE_MISMATCH_LOG (optionally with LOG_ALL_COMPARISONS
+defined in cpu_shader_tests.cpp so that passing comparisons are logged as well) and, for every record, computes the
+mathematically exact result of the operation rounded to the nearest float. Arithmetic operations are evaluated exactly
+with rationals; RSQ, EXP, LOG and LIT use 60 significant decimal digits before rounding.
+
+For each opcode, prints how often and by how many ULPs the hardware and the nv2a_vsh_cpu model differ from the exact
+result, and sorts each record where hardware and model disagree into one of:
+  model_error  - the hardware is within tolerance of the exact result but the model is not (a bug in the model).
+  hw_approx    - the model is within tolerance of the exact result but the hardware is not (an approximation in the
+                 hardware that the model does not reproduce).
+  both_off     - neither is within tolerance of the exact result.
+  both_close   - both are within tolerance of the exact result but not of each other.
+"""
+
+from __future__ import annotations
+
+import argparse
+import collections
+import decimal
+import math
+import struct
+import sys
+from fractions import Fraction
+from typing import Callable, Dict, List, Optional, Sequence
+
+import mismatch_log
+
+_SIGN_BIT = 0x80000000
+_POSITIVE_INFINITY = 0x7F800000
+
+# Tolerances used by cpu_shader_tests.cpp (kUnitsInLastPlace and kUnitsInLastPlaceLowPrecision).
+_DEFAULT_ULPS = 4
+_LOW_PRECISION_ULPS = 0x200
+_LOW_PRECISION_OPCODES = {"EXP", "LOG"}
+
+# Bounds of RCC and the exponent clamp of LIT, as used by nv2a_vsh_cpu.
+_RCC_MIN = 1.884467e-19
+_RCC_MAX = 1.884467e19
+_LIT_MAX_POWER = 127.9961
+
+_CLASSES = ("model_error", "hw_approx", "both_off", "both_close")
+
+decimal.getcontext().prec = 60
+
+Vector = Sequence[Fraction]
+# Each lane is the bit pattern of the correctly rounded result, or None if it is not computed.
+Result = List[Optional[int]]
+
+
+def _f32(value: float) -> Fraction:
+    """Returns the exact value of `value` rounded to a float32."""
+    return Fraction(struct.unpack("<f", struct.pack("<f", value))[0])
+
+
+def bits_to_fraction(bits: int) -> Optional[Fraction]:
+    """Returns the exact value of a float32 bit pattern, or None for infinities and NaNs."""
+    value = struct.unpack("<f", struct.pack("<I", bits))[0]
+    if not math.isfinite(value):
+        return None
+    return Fraction(value)
+
+
+def round_to_f32(value: Fraction, negative_zero: bool = False) -> int:
+    """Returns the bit pattern of the float32 nearest to `value`, rounding ties to even."""
+    if not value:
+        return _SIGN_BIT if negative_zero else 0
+
+    sign = _SIGN_BIT if value < 0 else 0
+    value = abs(value)
+    numerator, denominator = value.numerator, value.denominator
+
+    # Find the exponent e such that 2^e <= value < 2^(e+1).
+    exponent = numerator.bit_length() - denominator.bit_length()
+    if Fraction(2) ** exponent > value:
+        exponent -= 1
+
+    # Scale so that the integer part holds the 24 significant bits (or fewer for subnormals).
+    shift = 23 - max(exponent, -126)
+    scaled_numerator = numerator << shift if shift >= 0 else numerator
+    scaled_denominator = denominator if shift >= 0 else denominator << -shift
+    mantissa, remainder = divmod(scaled_numerator, scaled_denominator)
+    if remainder * 2 > scaled_denominator or (remainder * 2 == scaled_denominator and mantissa & 1):
+        mantissa += 1
+
+    if exponent < -126:
+        # Rounding up to 2^23 produces the smallest normal, which has the same encoding.
+        return sign | mantissa
+
+    if mantissa == 1 << 24:
+        mantissa >>= 1
+        exponent += 1
+    if exponent > 127:
+        return sign | _POSITIVE_INFINITY
+    return sign | ((exponent + 127) << 23) | (mantissa - (1 << 23))
+
+
+def _infinity(negative: bool) -> int:
+    return (_SIGN_BIT if negative else 0) | _POSITIVE_INFINITY
+
+
+def _from_decimal(value: decimal.Decimal) -> int:
+    return round_to_f32(Fraction(value))
+
+
+def _decimal(value: Fraction) -> decimal.Decimal:
+    return decimal.Decimal(value.numerator) / decimal.Decimal(value.denominator)
+
+
+_LN2 = decimal.Decimal(2).ln()
+
+
+def _exp2(value: Fraction) -> int:
+    return _from_decimal((_decimal(value) * _LN2).exp())
+
+
+def _floor_log2(value: Fraction) -> int:
+    exponent = value.numerator.bit_length() - value.denominator.bit_length()
+    if Fraction(2) ** exponent > value:
+        exponent -= 1
+    return exponent
+
+
+def _broadcast(value: int) -> Result:
+    return [value] * 4
+
+
+_ONE = round_to_f32(Fraction(1))
+_ZERO = 0
+
+
+def _rcp(a: Vector, _b, _c) -> Result:
+    if not a[0]:
+        return _broadcast(_infinity(False))
+    return _broadcast(round_to_f32(1 / a[0]))
+
+
+def _rcc(a: Vector, _b, _c) -> Result:
+    if not a[0]:
+        return _broadcast(round_to_f32(_f32(_RCC_MAX)))
+    value = 1 / a[0]
+    low, high = _f32(_RCC_MIN), _f32(_RCC_MAX)
+    if value > 0:
+        value = min(max(value, low), high)
+    else:
+        value = max(min(value, -low), -high)
+    return _broadcast(round_to_f32(value))
+
+
+def _rsq(a: Vector, _b, _c) -> Result:
+    if not a[0]:
+        return _broadcast(_infinity(False))
+    return _broadcast(_from_decimal(1 / _decimal(abs(a[0])).sqrt()))
+
+
+def _exp(a: Vector, _b, _c) -> Result:
+    floor = math.floor(a[0])
+    fraction = round_to_f32(a[0] - floor)
+    # Clamped before building the powers, which would otherwise take unbounded time for inputs near +/-2^127. 2^x
+    # overflows from 128 on and rounds to 0 below -150 (2^-150 itself is a tie that rounds to even).
+    if floor >= 128:
+        return [_infinity(False), fraction, _infinity(False), _ONE]
+    if floor <= -150:
+        return [_ZERO, fraction, _ZERO if floor < -150 or a[0] == floor else _exp2(a[0]), _ONE]
+    return [round_to_f32(Fraction(2) ** floor), fraction, _exp2(a[0]), _ONE]
+
+
+def _log(a: Vector, _b, _c) -> Result:
+    value = abs(a[0])
+    if not value:
+        return [_infinity(True), _ONE, _infinity(True), _ONE]
+    exponent = _floor_log2(value)
+    log2 = _from_decimal(_decimal(value).ln() / _LN2)
+    return [round_to_f32(Fraction(exponent)), round_to_f32(value / Fraction(2) ** exponent), log2, _ONE]
+
+
+def _lit(a: Vector, _b, _c) -> Result:
+    ret = [_ONE, _ZERO, _ZERO, _ONE]
+    if a[0] > 0:
+        ret[1] = round_to_f32(a[0])
+        if a[1] > 0:
+            limit = _f32(_LIT_MAX_POWER)
+            power = min(max(a[3], -limit), limit)
+            ret[2] = _from_decimal((_decimal(power) * _decimal(a[1]).ln()).exp())
+    return ret
+
+
+def _dot(a: Vector, b: Vector, lanes: int) -> Fraction:
+    return sum((a[i] * b[i] for i in range(lanes)), Fraction(0))
+
+
+_OPERATIONS: Dict[str, Callable[[Vector, Optional[Vector], Optional[Vector]], Result]] = {
+    "ADD": lambda a, b, _c: [round_to_f32(a[i] + b[i]) for i in range(4)],
+    "MUL": lambda a, b, _c: [round_to_f32(a[i] * b[i]) for i in range(4)],
+    "MAD": lambda a, b, c: [round_to_f32(a[i] * b[i] + c[i]) for i in range(4)],
+    "DP3": lambda a, b, _c: _broadcast(round_to_f32(_dot(a, b, 3))),
+    "DP4": lambda a, b, _c: _broadcast(round_to_f32(_dot(a, b, 4))),
+    "DPH": lambda a, b, _c: _broadcast(round_to_f32(_dot(a, b, 3) + b[3])),
+    "DST": lambda a, b, _c: [_ONE, round_to_f32(a[1] * b[1]), round_to_f32(a[2]), round_to_f32(b[3])],
+    "MOV": lambda a, _b, _c: [round_to_f32(a[i]) for i in range(4)],
+    "MIN": lambda a, b, _c: [round_to_f32(min(a[i], b[i])) for i in range(4)],
+    "MAX": lambda a, b, _c: [round_to_f32(max(a[i], b[i])) for i in range(4)],
+    "SGE": lambda a, b, _c: [_ONE if a[i] >= b[i] else _ZERO for i in range(4)],
+    "SLT": lambda a, b, _c: [_ONE if a[i] < b[i] else _ZERO for i in range(4)],
+    "RCP": _rcp,
+    "RCC": _rcc,
+    "RSQ": _rsq,
+    "EXP": _exp,
+    "LOG": _log,
+    "LIT": _lit,
+}
+
+
+def exact_result(opcode: str, inputs: Sequence[Sequence[int]]) -> Optional[Result]:
+    """Returns the correctly rounded result of `opcode`, or None if it is unknown or an input is not finite."""
+    operation = _OPERATIONS.get(opcode)
+    if not operation:
+        return None
+
+    vectors = []
+    for vector in inputs:
+        values = [bits_to_fraction(bits) for bits in vector]
+        if any(value is None for value in values):
+            return None
+        vectors.append(values)
+    vectors += [None] * (3 - len(vectors))
+    return operation(*vectors)
+
+
+def _ordered(bits: int) -> int:
+    return -(bits & ~_SIGN_BIT) if bits & _SIGN_BIT else bits
+
+
+def _is_nan(bits: int) -> bool:
+    return (bits & _POSITIVE_INFINITY) == _POSITIVE_INFINITY and bool(bits & 0x007FFFFF)
+
+
+def ulp_distance(a: int, b: int) -> float:
+    """Returns the number of floats between two bit patterns, treating all NaNs as equal to each other only."""
+    if _is_nan(a) or _is_nan(b):
+        return 0 if _is_nan(a) and _is_nan(b) else math.inf
+    return abs(_ordered(a) - _ordered(b))
+
+
+def classify(hw_error: float, cpu_error: float, hw_cpu_error: float, tolerance: int) -> Optional[str]:
+    """Returns the class of a record, or None if the hardware and model agree."""
+    if hw_cpu_error <= tolerance:
+        return None
+    if hw_error <= tolerance:
+        return "both_close" if cpu_error <= tolerance else "model_error"
+    return "hw_approx" if cpu_error <= tolerance else "both_off"
+
+
+class _OpcodeStats:
+    def __init__(self):
+        self.records = 0
+        self.skipped = 0
+        self.lanes = 0
+        self.hw_exact = 0
+        self.cpu_exact = 0
+        self.hw_max = 0.0
+        self.cpu_max = 0.0
+        self.classes = collections.Counter()
+
+
+def _format_ulps(value: float) -> str:
+    return "inf" if math.isinf(value) else str(int(value))
+
+
+def _format_vector(bits: Sequence[Optional[int]]) -> str:
+    def _one(value: Optional[int]) -> str:
+        if value is None:
+            return "-"
+        return f"{struct.unpack('<f', struct.pack('<I', value))[0]:.9g} (0x{value:08X})"
+
+    return ", ".join(_one(value) for value in bits)
+
+
+def _main(args) -> int:
+    records = mismatch_log.decode(mismatch_log.read(args.log))
+    stats: Dict[str, _OpcodeStats] = collections.defaultdict(_OpcodeStats)
+
+    for record in records:
+        if args.opcode and record.opcode != args.opcode:
+            continue
+        opcode_stats = stats[record.opcode]
+        opcode_stats.records += 1
+
+        try:
+            exact = exact_result(record.opcode, record.inputs)
+        except decimal.DecimalException:
+            # E.g., an overflow of the 60 digit intermediate results of an input that the clamps do not cover.
+            exact = None
+        if exact is None:
+            opcode_stats.skipped += 1
+            continue
+
+        hw_error = cpu_error = hw_cpu_error = 0.0
+        for lane, exact_bits in enumerate(exact):
+            if exact_bits is None:
+                continue
+            lane_hw_error = ulp_distance(record.hw[lane], exact_bits)
+            lane_cpu_error = ulp_distance(record.cpu[lane], exact_bits)
+            opcode_stats.lanes += 1
+            opcode_stats.hw_exact += lane_hw_error == 0
+            opcode_stats.cpu_exact += lane_cpu_error == 0
+            hw_error = max(hw_error, lane_hw_error)
+            cpu_error = max(cpu_error, lane_cpu_error)
+            hw_cpu_error = max(hw_cpu_error, ulp_distance(record.hw[lane], record.cpu[lane]))
+        opcode_stats.hw_max = max(opcode_stats.hw_max, hw_error)
+        opcode_stats.cpu_max = max(opcode_stats.cpu_max, cpu_error)
+
+        tolerance = args.ulps
+        if tolerance is None:
+            tolerance = _LOW_PRECISION_ULPS if record.opcode in _LOW_PRECISION_OPCODES else _DEFAULT_ULPS
+        record_class = classify(hw_error, cpu_error, hw_cpu_error, tolerance)
+        if not record_class:
+            continue
+        opcode_stats.classes[record_class] += 1
+
+        if args.records and (not args.record_class or args.record_class == record_class):
+            print(f"{record.opcode} {record_class}")
+            for index, vector in enumerate(record.inputs):
+                print(f"  in{index}:  {_format_vector(vector)}")
+            print(f"  hw:   {_format_vector(record.hw)}")
+            print(f"  cpu:  {_format_vector(record.cpu)}")
+            print(f"  exact: {_format_vector(exact)}")
+
+    if not stats:
+        print("No records found", file=sys.stderr)
+        return 1
+
+    headers = ["opcode", "records", "skipped", "hw_exact", "hw_max_ulp", "cpu_exact", "cpu_max_ulp", *_CLASSES]
+    table = []
+    for opcode, opcode_stats in sorted(stats.items()):
+        lanes = max(opcode_stats.lanes, 1)
+        table.append(
+            [
+                opcode,
+                str(opcode_stats.records),
+                str(opcode_stats.skipped),
+                f"{opcode_stats.hw_exact / lanes:.1%}",
+                _format_ulps(opcode_stats.hw_max),
+                f"{opcode_stats.cpu_exact / lanes:.1%}",
+                _format_ulps(opcode_stats.cpu_max),
+                *(str(opcode_stats.classes[name]) for name in _CLASSES),
+            ]
+        )
+
+    widths = [max(len(h), *(len(row[i]) for row in table)) for i, h in enumerate(headers)]
+    print("  ".join(h.rjust(widths[i]) for i, h in enumerate(headers)))
+    for row in table:
+        print("  ".join(v.rjust(widths[i]) for i, v in enumerate(row)))
+    return 0
+
+
+if __name__ == "__main__":
+
+    def _parse_args():
+        parser = argparse.ArgumentParser(
+            description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+        )
+        parser.add_argument("log", help="mismatches.bin or a result archive containing it.")
+        parser.add_argument(
+            "--ulps",
+            type=int,
+            help="Tolerance for every opcode. Defaults to the tolerances used by CPU Shader Tests.",
+        )
+        parser.add_argument("--opcode", help="Only process records for the given opcode.")
+        parser.add_argument(
+            "--records", action="store_true", help="Print every record where hardware and model disagree."
+        )
+        parser.add_argument("--class", dest="record_class", choices=_CLASSES, help="Only print records of this class.")
+        return parser.parse_args()
+
+    sys.exit(_main(_parse_args()))
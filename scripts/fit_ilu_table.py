@@ -0,0 +1,385 @@
+#!/usr/bin/env python3
+
+"""Fits tables that reproduce the hardware RCP and RSQ results bit for bit.
+
+Reads the ilu_captures.bin written by the ILU Characterization suite (in builds configured with
+ENABLE_ILU_CHARACTERIZATION) or any mismatches.bin with RCP or RSQ records, and writes the tables loaded by
+IluTableModel (see src/ilu_table_model.h). Several captures, e.g. from runs with different seeds, may be combined.
+
+Each function is modeled as a piecewise quadratic in its reduced argument. Every captured input that the quadratics do
+not reproduce is stored as an exception, so the tables are exact for every capture. To estimate how well the model
+generalizes to inputs that were not captured, every --holdout-th key is left out of the fit and the fraction of those
+keys that the quadratics reproduce is reported, along with how close the captures are to covering every key. The
+number of distinct keys captured is stored with each table, and CPU Shader Tests only require an exact match when every
+key of the function was captured. The segment count is chosen to minimize the size of the table unless --segment-bits
+is given.
+"""
+
+from __future__ import annotations
+
+import argparse
+import collections
+import struct
+import sys
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Sequence, Tuple
+
+import mismatch_log
+
+_CAPTURE_NAME = "ilu_captures.bin"
+
+_MAGIC = 0x54495356  # "VSIT"
+_VERSION = 2
+
+_HEADER = struct.Struct("<III")
+_TABLE_HEADER = struct.Struct("<4sIIII")
+_SEGMENT = struct.Struct("<iii")
+_EXCEPTION = struct.Struct("<Ii")
+
+_SIGN_BIT = 0x80000000
+_MANTISSA_MASK = 0x007FFFFF
+_EXPONENT_SHIFT = 23
+_EXPONENT_BIAS = 127
+_ONE = 1 << _EXPONENT_SHIFT
+
+# Reduced argument width of each function, as in ilu_table_model.cpp.
+_KEY_BITS = {"RCP": 23, "RSQ": 24}
+
+# Fixed point scale of the linear and quadratic coefficients. The constant coefficient has
+# _COEFFICIENT_SHIFT - _CONSTANT_SHIFT fractional bits.
+_COEFFICIENT_SHIFT = 24
+_CONSTANT_SHIFT = 17
+
+_INT32_MIN = -(1 << 31)
+_INT32_MAX = (1 << 31) - 1
+
+# Offsets within a segment are limited to 16 bits so that the quadratic term fits in 64 bits.
+_MAX_OFFSET_BITS = 16
+_MAX_SEGMENT_BITS = 16
+
+# Fewest captured keys per segment for the segment count to be considered when choosing it automatically.
+_MIN_KEYS_PER_SEGMENT = 16
+
+# Points of the exact function per segment that its quadratic is fitted to.
+_IDEAL_SAMPLES = 32
+
+
+@dataclass
+class _Capture:
+    # Significand of the result for each key, see IluTableModel.
+    keys: Dict[int, int] = field(default_factory=dict)
+    conflicts: int = 0
+    out_of_model: int = 0
+    # Every significand observed for each key, to resolve conflicts by majority.
+    observed: Dict[int, collections.Counter] = field(
+        default_factory=lambda: collections.defaultdict(collections.Counter)
+    )
+
+
+@dataclass
+class _Table:
+    segment_bits: int
+    segments: List[Tuple[int, int, int]]
+    exceptions: List[Tuple[int, int]]
+    holdout_keys: int
+    holdout_exact: int
+
+    def size(self) -> int:
+        return len(self.segments) * _SEGMENT.size + len(self.exceptions) * _EXCEPTION.size
+
+
+def reduce(opcode: str, bits: int) -> Optional[Tuple[int, int, int]]:
+    """Returns (key, result exponent, result sign) for the input `bits`, or None if it is outside of the model."""
+    exponent = (bits >> _EXPONENT_SHIFT) & 0xFF
+    if not exponent or exponent == 0xFF:
+        return None
+
+    key = bits & _MANTISSA_MASK
+    if opcode == "RCP":
+        return key, 2 * _EXPONENT_BIAS - 1 - exponent, bits & _SIGN_BIT
+
+    unbiased = exponent - _EXPONENT_BIAS
+    return key | ((unbiased & 1) << _EXPONENT_SHIFT), _EXPONENT_BIAS - 1 - (unbiased >> 1), 0
+
+
+def ideal_significand(opcode: str, key: int) -> float:
+    """Returns the exact significand for `key`, used for segments without captures."""
+    mantissa = 1.0 + (key & _MANTISSA_MASK) / _ONE
+    if opcode == "RCP":
+        value = 2.0 / mantissa
+    else:
+        value = 2.0 / ((2.0 if key >> _EXPONENT_SHIFT else 1.0) * mantissa) ** 0.5
+    return (value - 1.0) * _ONE
+
+
+def evaluate(segment: Tuple[int, int, int], offset: int) -> int:
+    """Mirrors IluTableModel::Significand; Python's >> rounds toward negative infinity like the C++ shift."""
+    c0, c1, c2 = segment
+    quadratic = (c2 * offset * offset) >> _COEFFICIENT_SHIFT
+    return ((c0 << _CONSTANT_SHIFT) + c1 * offset + quadratic) >> _COEFFICIENT_SHIFT
+
+
+def _solve(matrix: List[List[float]], vector: List[float]) -> Optional[List[float]]:
+    """Solves a small linear system by Gaussian elimination with partial pivoting."""
+    size = len(vector)
+    rows = [row[:] + [value] for row, value in zip(matrix, vector)]
+    for column in range(size):
+        pivot = max(range(column, size), key=lambda r: abs(rows[r][column]))
+        if abs(rows[pivot][column]) < 1e-12:
+            return None
+        rows[column], rows[pivot] = rows[pivot], rows[column]
+        for row in range(column + 1, size):
+            factor = rows[row][column] / rows[column][column]
+            for index in range(column, size + 1):
+                rows[row][index] -= factor * rows[column][index]
+
+    ret = [0.0] * size
+    for row in reversed(range(size)):
+        ret[row] = (rows[row][size] - sum(rows[row][i] * ret[i] for i in range(row + 1, size))) / rows[row][row]
+    return ret
+
+
+def _least_squares(samples: Sequence[Tuple[int, float]], width: int) -> Optional[Tuple[int, int, int]]:
+    """Returns the fixed point quadratic closest to `samples` of (offset, significand), or None if there is none."""
+    if len({offset for offset, _ in samples}) < 3:
+        return None
+
+    # Offsets are normalized to [0, 1) to keep the normal equations well conditioned.
+    sums = [0.0] * 5
+    moments = [0.0] * 3
+    for offset, value in samples:
+        u = offset / width
+        powers = (1.0, u, u * u, u * u * u, u * u * u * u)
+        for index in range(5):
+            sums[index] += powers[index]
+        for index in range(3):
+            moments[index] += powers[index] * value
+
+    solution = _solve([[sums[row + column] for column in range(3)] for row in range(3)], moments)
+    if not solution:
+        return None
+
+    scale = 1 << _COEFFICIENT_SHIFT
+    ret = (
+        round(solution[0] * (1 << (_COEFFICIENT_SHIFT - _CONSTANT_SHIFT))),
+        round(solution[1] / width * scale),
+        round(solution[2] / (width * width) * scale * scale),
+    )
+    if any(not _INT32_MIN <= value <= _INT32_MAX for value in ret):
+        return None
+    return ret
+
+
+def _best_constant(
+    segment: Tuple[int, int, int], samples: Sequence[Tuple[int, int]]
+) -> Tuple[Tuple[int, int, int], int]:
+    """Returns `segment` with the constant term that reproduces the most `samples`, and the number reproduced.
+
+    Each sample admits a half-open range of constants, so the best one is found by sweeping over the range ends.
+    """
+    _, c1, c2 = segment
+    unit = 1 << _CONSTANT_SHIFT
+    events: Dict[int, int] = collections.Counter()
+    for offset, value in samples:
+        rest = c1 * offset + ((c2 * offset * offset) >> _COEFFICIENT_SHIFT)
+        low = (value << _COEFFICIENT_SHIFT) - rest
+        high = low + (1 << _COEFFICIENT_SHIFT)
+        # Constants c0 with low <= c0 * unit < high.
+        events[-(-low // unit)] += 1
+        events[-(-high // unit)] -= 1
+
+    best = segment
+    best_count = count = 0
+    for c0 in sorted(events):
+        count += events[c0]
+        if count > best_count and _INT32_MIN <= c0 <= _INT32_MAX:
+            best = (c0, c1, c2)
+            best_count = count
+    return best, best_count
+
+
+def fit(opcode: str, keys: Dict[int, int], segment_bits: int, holdout: int) -> _Table:
+    key_bits = _KEY_BITS[opcode]
+    offset_bits = key_bits - segment_bits
+    width = 1 << offset_bits
+
+    training: Dict[int, List[Tuple[int, int]]] = collections.defaultdict(list)
+    held_out: Dict[int, List[Tuple[int, int]]] = collections.defaultdict(list)
+    for index, (key, significand) in enumerate(sorted(keys.items())):
+        target = held_out if holdout and index % holdout == holdout - 1 else training
+        target[key >> offset_bits].append((key & (width - 1), significand))
+
+    segments = []
+    exceptions = []
+    holdout_keys = holdout_exact = 0
+    for segment_index in range(1 << segment_bits):
+        start = segment_index << offset_bits
+        samples = training.get(segment_index, [])
+
+        # The shape of the exact function is a better guess than a fit to a few noisy captures, while a fit to many
+        # captures follows an approximation made by the hardware. The candidate that reproduces more captures wins and
+        # its constant term is then tuned to the captures, which also absorbs the rounding of the hardware.
+        step = max(1, width // _IDEAL_SAMPLES)
+        ideal = [(offset, ideal_significand(opcode, start + offset)) for offset in range(0, width, step)]
+        candidates = [_least_squares(ideal, width), _least_squares(samples, width)]
+        segment = max(
+            (_best_constant(candidate, samples) for candidate in candidates if candidate),
+            key=lambda result: result[1],
+        )[0]
+        segments.append(segment)
+
+        for offset, value in samples:
+            if evaluate(segment, offset) != value:
+                exceptions.append((start + offset, value))
+        for offset, value in held_out.get(segment_index, []):
+            holdout_keys += 1
+            if evaluate(segment, offset) == value:
+                holdout_exact += 1
+            else:
+                exceptions.append((start + offset, value))
+
+    exceptions.sort()
+    return _Table(segment_bits, segments, exceptions, holdout_keys, holdout_exact)
+
+
+def _load(paths: Sequence[str]) -> Dict[str, _Capture]:
+    captures: Dict[str, _Capture] = collections.defaultdict(_Capture)
+    for path in paths:
+        try:
+            data = mismatch_log.read(path, _CAPTURE_NAME)
+        except ValueError:
+            data = mismatch_log.read(path)
+
+        for record in mismatch_log.decode(data):
+            if record.opcode not in _KEY_BITS:
+                continue
+            capture = captures[record.opcode]
+            reduced = reduce(record.opcode, record.inputs[0][0])
+            result = record.hw[0]
+            if reduced is None or (result & _SIGN_BIT) != reduced[2]:
+                capture.out_of_model += 1
+                continue
+            key, exponent, _ = reduced
+            significand = (result & ~_SIGN_BIT) - (exponent << _EXPONENT_SHIFT)
+            if exponent < 1 or exponent > 0xFD or not 0 <= significand <= _ONE:
+                capture.out_of_model += 1
+                continue
+            capture.observed[key][significand] += 1
+
+    for capture in captures.values():
+        for key, counts in capture.observed.items():
+            if len(counts) > 1:
+                capture.conflicts += 1
+            capture.keys[key] = counts.most_common(1)[0][0]
+    return captures
+
+
+def _coverage(keys: Dict[int, int], key_bits: int) -> str:
+    """Describes how close `keys` is to covering every key of a function."""
+    total = 1 << key_bits
+    if len(keys) == total:
+        return f"all {total} keys"
+
+    largest_gap = 0
+    previous = -1
+    for key in sorted(keys):
+        largest_gap = max(largest_gap, key - previous - 1)
+        previous = key
+    largest_gap = max(largest_gap, total - 1 - previous)
+    return (
+        f"{len(keys)} of {total} keys ({len(keys) / total:.2%}, {total - len(keys)} missing, "
+        f"largest run of missing keys {largest_gap})"
+    )
+
+
+def _write(path: str, tables: Dict[str, _Table], captured_keys: Dict[str, int]):
+    with open(path, "wb") as outfile:
+        outfile.write(_HEADER.pack(_MAGIC, _VERSION, len(tables)))
+        for opcode, table in sorted(tables.items()):
+            outfile.write(
+                _TABLE_HEADER.pack(
+                    opcode.encode("ascii"),
+                    _KEY_BITS[opcode],
+                    table.segment_bits,
+                    captured_keys[opcode],
+                    len(table.exceptions),
+                )
+            )
+            for segment in table.segments:
+                outfile.write(_SEGMENT.pack(*segment))
+            for exception in table.exceptions:
+                outfile.write(_EXCEPTION.pack(*exception))
+
+
+def _main(args) -> int:
+    captures = _load(args.captures)
+    if not captures:
+        print("No RCP or RSQ records found", file=sys.stderr)
+        return 1
+
+    tables: Dict[str, _Table] = {}
+    for opcode, capture in sorted(captures.items()):
+        if not capture.keys:
+            print(f"{opcode}: no captures within the model ({capture.out_of_model} outside)", file=sys.stderr)
+            continue
+        if capture.conflicts:
+            # The model assumes that the significand depends only on the key, which conflicts contradict.
+            print(f"{opcode}: {capture.conflicts} keys produced different significands, using the most common")
+
+        min_segment_bits = _KEY_BITS[opcode] - _MAX_OFFSET_BITS
+        if args.segment_bits:
+            candidates = [max(args.segment_bits, min_segment_bits)]
+        else:
+            candidates = [
+                bits
+                for bits in range(min_segment_bits, _MAX_SEGMENT_BITS + 1)
+                if len(capture.keys) >> bits >= _MIN_KEYS_PER_SEGMENT
+            ] or [min_segment_bits]
+        table = min((fit(opcode, capture.keys, bits, args.holdout) for bits in candidates), key=_Table.size)
+        tables[opcode] = table
+
+        holdout = f"{table.holdout_exact / table.holdout_keys:.2%}" if table.holdout_keys else "n/a"
+        print(
+            f"{opcode}: {_coverage(capture.keys, _KEY_BITS[opcode])}, {capture.out_of_model} outside the model, "
+            f"{1 << table.segment_bits} segments, {len(table.exceptions)} exceptions, {table.size()} bytes, "
+            f"held out keys exact: {holdout}"
+        )
+        if len(capture.keys) != 1 << _KEY_BITS[opcode]:
+            print(
+                f"{opcode}: incomplete, so CPU Shader Tests will compare with a tolerance. Capture with "
+                "ILU_CHARACTERIZATION_STRATA=0 to cover every key."
+            )
+
+    if not tables:
+        return 1
+    _write(args.output, tables, {opcode: len(captures[opcode].keys) for opcode in tables})
+    return 0
+
+
+if __name__ == "__main__":
+
+    def _parse_args():
+        parser = argparse.ArgumentParser(
+            description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+        )
+        parser.add_argument(
+            "captures", nargs="+", help="ilu_captures.bin, mismatches.bin or result archives containing them."
+        )
+        parser.add_argument("-o", "--output", default="ilu_table.bin", help="Path of the table to write.")
+        parser.add_argument(
+            "--segment-bits",
+            type=int,
+            choices=range(1, _MAX_SEGMENT_BITS + 1),
+            metavar=f"[1-{_MAX_SEGMENT_BITS}]",
+            help="Log2 of the number of segments, at least the key width minus 16. Defaults to the value that "
+            "minimizes the table size.",
+        )
+        parser.add_argument(
+            "--holdout",
+            type=int,
+            default=8,
+            help="Leave every Nth key out of the fit to estimate the accuracy for uncaptured inputs. 0 fits every key.",
+        )
+        return parser.parse_args()
+
+    sys.exit(_main(_parse_args()))
@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+
+"""Generates the tables and polynomial coefficients of FloatMath (src/float_math.cpp).
+
+Log2 splits the significand range [0x3F330000, 0x3FB30000) into 16 subintervals. Each has a center c, rounded so that
+its reciprocal is a float and therefore z / c is computed exactly in double precision, and log2(c). The subinterval
+that contains 1 uses c = 1 exactly so that results close to 0 keep their relative precision. log2(1 + r) is then
+approximated by r times a quartic interpolating log2(1 + r) / r at the Chebyshev nodes of the range of r, which is
+close to the minimax polynomial.
+
+Exp2 uses 2^(i / 32) for i in [0, 32), stored as the bit pattern of the double minus i << 47 so that adding the
+integer and table index bits of round(x * 32) << 47 yields 2^(round(x * 32) / 32) directly. 2^r is approximated on
+[-1/64, 1/64] by 1 + r times a quadratic interpolating (2^r - 1) / r at the Chebyshev nodes.
+
+Prints the C++ definitions to paste into src/float_math.cpp, and the maximum approximation error of each polynomial.
+"""
+
+from __future__ import annotations
+
+import argparse
+import decimal
+import struct
+import sys
+from fractions import Fraction
+from typing import Callable, List, Tuple
+
+decimal.getcontext().prec = 60
+
+_D = decimal.Decimal
+_LN2 = _D(2).ln()
+
+_LOG2_TABLE_BITS = 4
+_LOG2_OFFSET = 0x3F330000
+_EXP2_TABLE_BITS = 5
+
+
+def _float_from_bits(bits: int) -> float:
+    return struct.unpack("<f", struct.pack("<I", bits))[0]
+
+
+def _double_bits(value: float) -> int:
+    return struct.unpack("<Q", struct.pack("<d", value))[0]
+
+
+def _to_float32(value: _D) -> float:
+    return struct.unpack("<f", struct.pack("<f", float(value)))[0]
+
+
+def _decimal(value: float) -> _D:
+    return _D(Fraction(value).numerator) / _D(Fraction(value).denominator)
+
+
+def _log2(value: _D) -> _D:
+    return value.ln() / _LN2
+
+
+def _chebyshev_fit(function: Callable[[_D], _D], low: _D, high: _D, degree: int) -> List[_D]:
+    """Returns the coefficients, lowest order first, of the polynomial interpolating `function` at the Chebyshev nodes
+    of [low, high]."""
+    pi = _D("3.14159265358979323846264338327950288419716939937510582097494")
+    nodes = []
+    for index in range(degree + 1):
+        angle = (2 * index + 1) * pi / (2 * (degree + 1))
+        # cos by its Taylor series, which converges quickly for angles below pi.
+        cosine = term = _D(1)
+        for n in range(1, 60):
+            term *= -angle * angle / ((2 * n - 1) * (2 * n))
+            cosine += term
+        nodes.append((low + high) / 2 + (high - low) / 2 * cosine)
+
+    # Solve the Vandermonde system by Gaussian elimination.
+    rows = [[node**power for power in range(degree + 1)] + [function(node)] for node in nodes]
+    size = degree + 1
+    for column in range(size):
+        pivot = max(range(column, size), key=lambda r: abs(rows[r][column]))
+        rows[column], rows[pivot] = rows[pivot], rows[column]
+        for row in range(size):
+            if row != column:
+                factor = rows[row][column] / rows[column][column]
+                for index in range(column, size + 1):
+                    rows[row][index] -= factor * rows[column][index]
+    return [rows[index][size] / rows[index][index] for index in range(size)]
+
+
+def _max_error(function: Callable[[_D], _D], coefficients: List[float], low: _D, high: _D) -> float:
+    """Returns the largest relative error of r * poly(r) against function(r) * r over a grid on [low, high]."""
+    worst = _D(0)
+    steps = 2000
+    for step in range(steps + 1):
+        r = low + (high - low) * step / steps
+        if not r:
+            continue
+        approximation = sum(_decimal(c) * r**power for power, c in enumerate(coefficients))
+        worst = max(worst, abs(approximation / function(r) - 1))
+    return float(worst)
+
+
+def log2_tables() -> Tuple[List[Tuple[float, float]], List[float], float]:
+    entries = []
+    max_r = _D(0)
+    min_r = _D(0)
+    for index in range(1 << _LOG2_TABLE_BITS):
+        low_bits = _LOG2_OFFSET + (index << (23 - _LOG2_TABLE_BITS))
+        high_bits = low_bits + (1 << (23 - _LOG2_TABLE_BITS)) - 1
+        low = _decimal(_float_from_bits(low_bits))
+        high = _decimal(_float_from_bits(high_bits))
+        if low <= 1 <= high:
+            inverse = 1.0
+        else:
+            inverse = _to_float32(2 / (low + high))
+        log_c = float(-_log2(_decimal(inverse)))
+        entries.append((inverse, log_c))
+        min_r = min(min_r, low * _decimal(inverse) - 1)
+        max_r = max(max_r, high * _decimal(inverse) - 1)
+
+    def function(r: _D) -> _D:
+        # Summed as a series since a Chebyshev node may be close enough to 0 for log2(1 + r) / r to lose precision.
+        return sum((-r) ** n / (n + 1) for n in range(40)) / _LN2
+
+    coefficients = [float(c) for c in _chebyshev_fit(function, min_r, max_r, 4)]
+    return entries, coefficients, _max_error(function, coefficients, min_r, max_r)
+
+
+def exp2_tables() -> Tuple[List[int], List[float], float]:
+    entries = []
+    for index in range(1 << _EXP2_TABLE_BITS):
+        value = float((_D(index) / (1 << _EXP2_TABLE_BITS) * _LN2).exp())
+        entries.append((_double_bits(value) - (index << (52 - _EXP2_TABLE_BITS))) & 0xFFFFFFFFFFFFFFFF)
+
+    bound = _D(1) / (2 << _EXP2_TABLE_BITS)
+
+    def function(r: _D) -> _D:
+        ret = term = _LN2
+        for n in range(2, 30):
+            term *= r * _LN2 / n
+            ret += term
+        return ret
+
+    coefficients = [float(c) for c in _chebyshev_fit(function, -bound, bound, 2)]
+    return entries, coefficients, _max_error(function, coefficients, -bound, bound)
+
+
+def _main(_args) -> int:
+    log2_entries, log2_coefficients, log2_error = log2_tables()
+    exp2_entries, exp2_coefficients, exp2_error = exp2_tables()
+
+    print(f"// Relative error of the log2(1 + r) / r polynomial: {log2_error:.3g}")
+    print("static constexpr Log2Entry kLog2Table[] = {")
+    for inverse, log_c in log2_entries:
+        print(f"    {{{inverse.hex()}, {log_c.hex()}}},")
+    print("};")
+    print("// Coefficients of r to r^5.")
+    print("static constexpr double kLog2Poly[] = {")
+    for coefficient in log2_coefficients:
+        print(f"    {coefficient.hex()},")
+    print("};")
+    print()
+    print(f"// Relative error of the (2^r - 1) / r polynomial: {exp2_error:.3g}")
+    print("static constexpr uint64_t kExp2Table[] = {")
+    for offset in range(0, len(exp2_entries), 4):
+        print("    " + " ".join(f"0x{entry:016X}," for entry in exp2_entries[offset : offset + 4]))
+    print("};")
+    print("// Coefficients of r, r^2 and r^3.")
+    print("static constexpr double kExp2Poly[] = {")
+    for coefficient in exp2_coefficients:
+        print(f"    {coefficient.hex()},")
+    print("};")
+    return 0
+
+
+if __name__ == "__main__":
+
+    def _parse_args():
+        parser = argparse.ArgumentParser(
+            description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+        )
+        return parser.parse_args()
+
+    sys.exit(_main(_parse_args()))
@@ -0,0 +1,255 @@
+#!/usr/bin/env python3
+
+"""Minimal FTP server that accepts results uploaded by nxdk_vsh_tests builds configured with ENABLE_FTP_UPLOAD.
+
+Only the subset of the protocol used by src/result_uploader.cpp and common clients is implemented (USER, PASS, SYST,
+TYPE, NOOP, PASV, PORT, MKD, STOR, QUIT). `--strict-directories` rejects a STOR into a directory that was not created
+first, as standard servers do; otherwise parent directories are created on STOR.
+Uploaded files are written beneath the given root directory. Any credentials are accepted.
+
+`--fail-every N` rejects every Nth STOR so that the uploader's retry handling can be exercised locally.
+"""
+
+from __future__ import annotations
+
+import argparse
+import asyncio
+import os
+import sys
+from typing import Awaitable, Callable, Optional
+
+# Invoked with (relative path, payload) after each successful STOR.
+UploadCallback = Callable[[str, bytes], Optional[Awaitable[None]]]
+
+
+class FTPReceiver:
+    """Accepts uploads from any number of concurrent clients on a single event loop."""
+
+    def __init__(
+        self,
+        root: str,
+        host: str = "0.0.0.0",
+        port: int = 2121,
+        fail_every: int = 0,
+        strict_directories: bool = False,
+        on_upload: Optional[UploadCallback] = None,
+        verbose: bool = False,
+    ):
+        self.root = os.path.abspath(root)
+        self.host = host
+        self.port = port
+        self.fail_every = fail_every
+        self.strict_directories = strict_directories
+        self.on_upload = on_upload
+        self.verbose = verbose
+        self.num_stores = 0
+        self._server: Optional[asyncio.base_events.Server] = None
+
+    async def start(self):
+        self._server = await asyncio.start_server(self._handle_client, self.host, self.port)
+        self.port = self._server.sockets[0].getsockname()[1]
+
+    async def serve_forever(self):
+        if not self._server:
+            await self.start()
+        async with self._server:
+            await self._server.serve_forever()
+
+    async def close(self):
+        if self._server:
+            self._server.close()
+            await self._server.wait_closed()
+
+    def _local_path(self, path: str) -> str:
+        ret = os.path.abspath(os.path.join(self.root, path.lstrip("/")))
+        if os.path.commonpath([ret, self.root]) != self.root:
+            raise ValueError(f"Path {path} escapes the upload root")
+        return ret
+
+    async def _handle_client(self, reader: asyncio.StreamReader, writer: asyncio.StreamWriter):
+        peer = writer.get_extra_info("peername")
+        local_address = writer.get_extra_info("sockname")[0]
+        passive_server: Optional[asyncio.base_events.Server] = None
+        data_connection: asyncio.Future = asyncio.get_running_loop().create_future()
+
+        async def reply(message: str):
+            if self.verbose:
+                print(f"{peer} < {message}")
+            writer.write(message.encode("utf-8") + b"\r\n")
+            await writer.drain()
+
+        await reply("220 nxdk_vsh_tests receiver ready")
+        try:
+            while True:
+                line = await reader.readline()
+                if not line:
+                    break
+                command, _, argument = line.decode("utf-8").rstrip("\r\n").partition(" ")
+                command = command.upper()
+                if self.verbose:
+                    print(f"{peer} > {command} {argument if command != 'PASS' else '***'}")
+
+                if command == "USER":
+                    await reply("331 Password required")
+                elif command == "PASS":
+                    await reply("230 Logged in")
+                elif command == "SYST":
+                    await reply("215 UNIX Type: L8")
+                elif command == "TYPE":
+                    await reply("200 Type set")
+                elif command == "NOOP":
+                    await reply("200 OK")
+                elif command == "MKD":
+                    try:
+                        path = self._local_path(argument)
+                    except ValueError as err:
+                        await reply(f"550 {err}")
+                        continue
+                    if os.path.isdir(path):
+                        await reply("550 Directory exists")
+                    else:
+                        os.makedirs(path, exist_ok=True)
+                        await reply(f'257 "{argument}" created')
+                elif command == "PASV":
+                    if passive_server:
+                        passive_server.close()
+                    data_connection = asyncio.get_running_loop().create_future()
+
+                    async def _accept(data_reader, data_writer, future=data_connection):
+                        if not future.done():
+                            future.set_result((data_reader, data_writer))
+                        else:
+                            data_writer.close()
+
+                    passive_server = await asyncio.start_server(_accept, local_address, 0)
+                    data_port = passive_server.sockets[0].getsockname()[1]
+                    address = local_address.replace(".", ",")
+                    await reply(
+                        f"227 Entering Passive Mode ({address},{data_port >> 8},{data_port & 0xFF})"
+                    )
+                elif command == "PORT":
+                    try:
+                        fields = [int(field) for field in argument.split(",")]
+                        if len(fields) != 6:
+                            raise ValueError
+                    except ValueError:
+                        await reply("501 Invalid PORT argument")
+                        continue
+                    if passive_server:
+                        passive_server.close()
+                        passive_server = None
+                    data_host = ".".join(str(field) for field in fields[:4])
+                    data_connection = asyncio.ensure_future(
+                        asyncio.open_connection(data_host, fields[4] << 8 | fields[5])
+                    )
+                    await reply("200 PORT command successful")
+                elif command == "STOR":
+                    await self._store(argument, data_connection, reply)
+                    if passive_server:
+                        passive_server.close()
+                        passive_server = None
+                elif command == "QUIT":
+                    await reply("221 Bye")
+                    break
+                else:
+                    await reply("502 Command not implemented")
+        except (ConnectionError, asyncio.IncompleteReadError):
+            pass
+        finally:
+            if passive_server:
+                passive_server.close()
+            writer.close()
+
+    async def _store(self, argument: str, data_connection: asyncio.Future, reply):
+        if not data_connection.done() and not data_connection.cancelled():
+            try:
+                await asyncio.wait_for(asyncio.shield(data_connection), timeout=10)
+            except (asyncio.TimeoutError, OSError):
+                await reply("425 No data connection")
+                return
+
+        try:
+            data_reader, data_writer = data_connection.result()
+        except OSError:
+            await reply("425 No data connection")
+            return
+        try:
+            path = self._local_path(argument)
+        except ValueError as err:
+            data_writer.close()
+            await reply(f"553 {err}")
+            return
+        if self.strict_directories and not os.path.isdir(os.path.dirname(path)):
+            data_writer.close()
+            await reply("553 No such directory")
+            return
+
+        await reply("150 Ready for data")
+        payload = await data_reader.read()
+        data_writer.close()
+
+        self.num_stores += 1
+        if self.fail_every and self.num_stores % self.fail_every == 0:
+            await reply("451 Simulated failure")
+            return
+
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        with open(path, "wb") as outfile:
+            outfile.write(payload)
+        await reply("226 Transfer complete")
+
+        if self.on_upload:
+            result = self.on_upload(os.path.relpath(path, self.root), payload)
+            if asyncio.iscoroutine(result):
+                await result
+
+
+def _main(args) -> int:
+    os.makedirs(args.root, exist_ok=True)
+    receiver = FTPReceiver(
+        args.root,
+        host=args.host,
+        port=args.port,
+        fail_every=args.fail_every,
+        strict_directories=args.strict_directories,
+        verbose=args.verbose,
+        on_upload=lambda path, payload: print(f"Received {path} ({len(payload)} bytes)"),
+    )
+
+    async def _run():
+        await receiver.start()
+        print(f"Listening on {receiver.host}:{receiver.port}, writing to {receiver.root}")
+        await receiver.serve_forever()
+
+    try:
+        asyncio.run(_run())
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+
+    def _parse_args():
+        parser = argparse.ArgumentParser(
+            description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+        )
+        parser.add_argument("root", help="Directory into which uploads are written.")
+        parser.add_argument("--host", default="0.0.0.0", help="Address to listen on.")
+        parser.add_argument("--port", type=int, default=2121, help="Port to listen on.")
+        parser.add_argument(
+            "--fail-every",
+            type=int,
+            default=0,
+            metavar="N",
+            help="Reject every Nth upload to exercise client retries.",
+        )
+        parser.add_argument(
+            "--strict-directories",
+            action="store_true",
+            help="Reject uploads into directories that were not created with MKD.",
+        )
+        parser.add_argument("-v", "--verbose", action="store_true", help="Log the control connection traffic.")
+        return parser.parse_args()
+
+    sys.exit(_main(_parse_args()))
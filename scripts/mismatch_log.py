@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+
+"""Decodes the mismatches.bin written by CPU Shader Tests in builds configured with ENABLE_MISMATCH_LOG.
+
+Prints the number of mismatches per opcode and, with --records, every mismatch with its inputs and the hardware and
+CPU results as both floats and bit patterns. Accepts the log itself or a result archive containing it.
+"""
+
+from __future__ import annotations
+
+import argparse
+import collections
+import struct
+import sys
+from dataclasses import dataclass
+from typing import List, Optional, Tuple
+
+import result_archive
+
+_LOG_NAME = "mismatches.bin"
+_MAGIC = 0x4D485356  # "VSHM"
+_VERSION = 1
+
+_HEADER = struct.Struct("<II")
+_RECORD_HEADER = struct.Struct("<4sI")
+_VECTOR = struct.Struct("<4I")
+
+
+@dataclass
+class Mismatch:
+    opcode: str
+    inputs: List[Tuple[int, int, int, int]]
+    hw: Tuple[int, int, int, int]
+    cpu: Tuple[int, int, int, int]
+
+
+def decode(data: bytes) -> List[Mismatch]:
+    magic, version = _HEADER.unpack_from(data, 0)
+    if magic != _MAGIC:
+        msg = "Not a mismatch log"
+        raise ValueError(msg)
+    if version != _VERSION:
+        msg = f"Unsupported mismatch log version {version}"
+        raise ValueError(msg)
+
+    ret = []
+    offset = _HEADER.size
+    while offset + _RECORD_HEADER.size <= len(data):
+        tag, num_inputs = _RECORD_HEADER.unpack_from(data, offset)
+        record_size = _RECORD_HEADER.size + (num_inputs + 2) * _VECTOR.size
+        # A record cut short by a crash is ignored.
+        if offset + record_size > len(data):
+            break
+        offset += _RECORD_HEADER.size
+        vectors = []
+        for _ in range(num_inputs + 2):
+            vectors.append(_VECTOR.unpack_from(data, offset))
+            offset += _VECTOR.size
+        ret.append(Mismatch(tag.rstrip(b"\0").decode("ascii"), vectors[:-2], vectors[-2], vectors[-1]))
+    return ret
+
+
+def read(path: str, name: str = _LOG_NAME) -> bytes:
+    """Returns the contents of the log at `path`, which may also be a result archive containing it as `name`."""
+    with open(path, "rb") as infile:
+        data = infile.read()
+    if not data.startswith(result_archive.FILE_MAGIC):
+        return data
+
+    archive = result_archive.Archive(path)
+    payload: Optional[bytes] = None
+    for entry in archive.entries:
+        if entry.type == result_archive.PAYLOAD_LOG and entry.test == name:
+            payload = archive.payload(entry)
+    if payload is None:
+        msg = f"{path} does not contain {name}"
+        raise ValueError(msg)
+    return payload
+
+
+def _format_vector(vector: Tuple[int, int, int, int]) -> str:
+    floats = struct.unpack("<4f", _VECTOR.pack(*vector))
+    return ", ".join(f"{value:g} (0x{bits:08X})" for value, bits in zip(floats, vector))
+
+
+def _main(args) -> int:
+    mismatches = decode(read(args.log))
+
+    if args.records:
+        for mismatch in mismatches:
+            if args.opcode and mismatch.opcode != args.opcode:
+                continue
+            print(mismatch.opcode)
+            for index, vector in enumerate(mismatch.inputs):
+                print(f"  in{index}: {_format_vector(vector)}")
+            print(f"  hw:  {_format_vector(mismatch.hw)}")
+            print(f"  cpu: {_format_vector(mismatch.cpu)}")
+
+    counts = collections.Counter(mismatch.opcode for mismatch in mismatches)
+    for opcode, count in sorted(counts.items()):
+        print(f"{opcode}: {count}")
+    print(f"Total: {len(mismatches)}")
+    return 0
+
+
+if __name__ == "__main__":
+
+    def _parse_args():
+        parser = argparse.ArgumentParser(
+            description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+        )
+        parser.add_argument("log", help="mismatches.bin or a result archive containing it.")
+        parser.add_argument("--records", action="store_true", help="Print every mismatch.")
+        parser.add_argument("--opcode", help="Only print records for the given opcode.")
+        return parser.parse_args()
+
+    sys.exit(_main(_parse_args()))
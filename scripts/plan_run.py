@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+
+"""Estimates the cost of a run from a dry-run report without touching a console.
+
+Reads the dry_run.csv written by a run with the "!dry_run" config directive (or a result archive containing it),
+optionally restricts it to the suites and tests enabled by a config file and re-estimates wall time from a newer
+durations file (see scripts/shard_durations.py), then prints the cost of each suite and the estimated wall time.
+"""
+
+from __future__ import annotations
+
+import argparse
+import csv
+import io
+import sys
+from typing import Dict, List, Optional, Set, Tuple
+
+import result_archive
+
+_REPORT_NAME = "dry_run.csv"
+_COLUMNS = [
+    "computations",
+    "custom_draws",
+    "shader_uploads",
+    "constant_uploads",
+    "pushbuffer_dwords",
+    "readback_registers",
+    "images",
+    "estimated_ms",
+]
+
+# Matches TestSharder::kDefaultDurationMilliseconds.
+_DEFAULT_DURATION_MS = 1000
+
+
+def _read_report(path: str) -> str:
+    with open(path, "rb") as infile:
+        is_archive = infile.read(len(result_archive.FILE_MAGIC)) == result_archive.FILE_MAGIC
+
+    if not is_archive:
+        with open(path, encoding="utf-8") as infile:
+            return infile.read()
+
+    archive = result_archive.Archive(path)
+    for entry in archive.entries:
+        if entry.type == result_archive.PAYLOAD_LOG and entry.test == _REPORT_NAME:
+            return archive.payload(entry).decode("utf-8")
+    msg = f"{path} does not contain {_REPORT_NAME}"
+    raise ValueError(msg)
+
+
+def load_report(path: str) -> Dict[Tuple[str, str], Dict[str, int]]:
+    """Returns the per-test rows of a dry-run report, dropping the suite and run totals."""
+    tests = {}
+    for row in csv.DictReader(io.StringIO(_read_report(path))):
+        if row["test"] == "*":
+            continue
+        tests[(row["suite"], row["test"])] = {column: int(row[column]) for column in _COLUMNS}
+    return tests
+
+
+def load_config(path: str) -> Tuple[Set[str], Set[Tuple[str, str]]]:
+    """Returns the enabled suites and the disabled tests, following load_config in src/main.cpp."""
+    suites: Set[str] = set()
+    disabled: Set[Tuple[str, str]] = set()
+    last_suite = ""
+    with open(path, encoding="utf-8") as infile:
+        for line in infile:
+            line = line.rstrip("\r\n")
+            if not line or line.startswith(("#", "!")):
+                continue
+            if line.startswith("-"):
+                disabled.add((last_suite, line[1:]))
+                continue
+            suites.add(line)
+            last_suite = line
+    return suites, disabled
+
+
+def load_durations(path: str) -> Dict[str, int]:
+    durations = {}
+    with open(path, encoding="utf-8") as infile:
+        for line in infile:
+            line = line.rstrip("\r\n")
+            if not line or line.startswith("#") or " " not in line:
+                continue
+            milliseconds, key = line.split(" ", 1)
+            durations[key] = int(milliseconds)
+    return durations
+
+
+def _apply_config(tests: Dict[Tuple[str, str], Dict[str, int]], config: str):
+    suites, disabled = load_config(config)
+    filtered = {key: row for key, row in tests.items() if key[0] in suites and key not in disabled}
+    # As on the console, a config that matches no suite runs everything.
+    return filtered or tests
+
+
+def _apply_durations(tests: Dict[Tuple[str, str], Dict[str, int]], durations: Dict[str, int]):
+    # Matches TestSharder::MedianDuration, which takes the upper median.
+    default = sorted(durations.values())[len(durations) // 2] if durations else _DEFAULT_DURATION_MS
+    for (suite, test), row in tests.items():
+        row["estimated_ms"] = durations.get(f"{suite}::{test}", default)
+
+
+def _print_table(tests: Dict[Tuple[str, str], Dict[str, int]]):
+    suites: Dict[str, Dict[str, int]] = {}
+    for (suite, _test), row in tests.items():
+        totals = suites.setdefault(suite, {column: 0 for column in ["tests", *_COLUMNS]})
+        totals["tests"] += 1
+        for column in _COLUMNS:
+            totals[column] += row[column]
+
+    headers = ["suite", "tests", *_COLUMNS]
+    rows: List[List[str]] = [[suite, *(str(totals[h]) for h in headers[1:])] for suite, totals in sorted(suites.items())]
+    run_totals = ["*", *(str(sum(totals[h] for totals in suites.values())) for h in headers[1:])]
+    rows.append(run_totals)
+
+    widths = [max(len(h), *(len(row[i]) for row in rows)) for i, h in enumerate(headers)]
+    print("  ".join(h.ljust(widths[i]) if not i else h.rjust(widths[i]) for i, h in enumerate(headers)))
+    for row in rows:
+        print("  ".join(v.ljust(widths[i]) if not i else v.rjust(widths[i]) for i, v in enumerate(row)))
+
+
+def _main(args) -> int:
+    tests = load_report(args.report)
+    if args.config:
+        tests = _apply_config(tests, args.config)
+    if args.durations:
+        _apply_durations(tests, load_durations(args.durations))
+
+    if not tests:
+        print("No tests in report", file=sys.stderr)
+        return 1
+
+    _print_table(tests)
+
+    custom_draws = sum(row["custom_draws"] for row in tests.values())
+    if custom_draws:
+        print(f"\n{custom_draws} computations use a custom draw whose pushbuffer DWORDs are not counted.")
+
+    total_ms = sum(row["estimated_ms"] for row in tests.values())
+    shards: Optional[int] = args.shards
+    if shards and shards > 1:
+        # Longest-first onto the least loaded shard, as TestSharder::Apply does.
+        loads = [0] * shards
+        for duration in sorted((row["estimated_ms"] for row in tests.values()), reverse=True):
+            loads[loads.index(min(loads))] += duration
+        print(f"\nEstimated wall time: {max(loads) / 1000.0:.1f}s across {shards} shards ({total_ms / 1000.0:.1f}s total)")
+    else:
+        print(f"\nEstimated wall time: {total_ms / 1000.0:.1f}s")
+    return 0
+
+
+if __name__ == "__main__":
+
+    def _parse_args():
+        parser = argparse.ArgumentParser(
+            description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+        )
+        parser.add_argument("report", help="dry_run.csv or a result archive containing it.")
+        parser.add_argument("-c", "--config", help="Config file selecting the suites and tests to plan for.")
+        parser.add_argument("-d", "--durations", help="Test durations file to estimate wall time from.")
+        parser.add_argument("-s", "--shards", type=int, help="Number of consoles the run will be split across.")
+        return parser.parse_args()
+
+    sys.exit(_main(_parse_args()))
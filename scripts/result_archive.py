@@ -0,0 +1,393 @@
+#!/usr/bin/env python3
+
+"""Utility to inspect, extract and diff result archives produced by nxdk_vsh_tests.
+
+See src/result_archive.h for a description of the file format.
+"""
+
+from __future__ import annotations
+
+import argparse
+import hashlib
+import os
+import struct
+import sys
+from dataclasses import dataclass
+from typing import Dict, Iterable, Iterator, List, Optional, Tuple
+
+FILE_MAGIC = b"VSHAARC\x00"
+ENTRY_MAGIC = 0x45485356
+FOOTER_MAGIC = 0x58485356
+VERSION = 1
+
+PAYLOAD_PNG = 1
+PAYLOAD_RESULTS = 2
+PAYLOAD_LOG = 3
+
+PAYLOAD_NAMES = {
+    PAYLOAD_PNG: "png",
+    PAYLOAD_RESULTS: "results",
+    PAYLOAD_LOG: "log",
+}
+
+# Extension used when extracting a payload of the given type.
+PAYLOAD_EXTENSIONS = {
+    PAYLOAD_PNG: ".png",
+    PAYLOAD_RESULTS: ".results",
+    PAYLOAD_LOG: "",
+}
+
+_FILE_HEADER = struct.Struct("<8sII")
+_ENTRY_HEADER = struct.Struct("<IIIHH")
+_INDEX_ENTRY = struct.Struct("<IIIHH")
+_FOOTER = struct.Struct("<III")
+
+
+@dataclass
+class Entry:
+    """A single payload within an archive."""
+
+    type: int
+    suite: str
+    test: str
+    offset: int
+    payload_size: int
+
+    @property
+    def payload_offset(self) -> int:
+        return (
+            self.offset
+            + _ENTRY_HEADER.size
+            + len(self.suite.encode("utf-8"))
+            + len(self.test.encode("utf-8"))
+        )
+
+    @property
+    def type_name(self) -> str:
+        return PAYLOAD_NAMES.get(self.type, f"type{self.type}")
+
+    @property
+    def key(self) -> Tuple[int, str, str]:
+        return self.type, self.suite, self.test
+
+    @property
+    def relative_path(self) -> str:
+        name = self.test + PAYLOAD_EXTENSIONS.get(self.type, f".type{self.type}")
+        if not self.suite:
+            return name
+        return os.path.join(self.suite, name)
+
+
+@dataclass
+class ResultRecord:
+    """A single TestHost::Results entry from a PAYLOAD_RESULTS payload."""
+
+    title: str
+    results_mask: int
+    # Maps output register index to the raw bit patterns of its x, y, z, w components.
+    outputs: Dict[int, Tuple[int, int, int, int]]
+    # Hash of the shader microcode and constant inputs that produced the outputs (0 if unknown).
+    input_hash: int = 0
+
+
+class Archive:
+    """Read-only view of a result archive."""
+
+    def __init__(self, path: str):
+        self.path = path
+        with open(path, "rb") as infile:
+            self._data = infile.read()
+
+        magic, version, _ = _FILE_HEADER.unpack_from(self._data, 0)
+        if magic != FILE_MAGIC:
+            raise ValueError(f"{path} is not a result archive")
+        if version != VERSION:
+            raise ValueError(f"{path} has unsupported version {version}")
+
+        self.complete = True
+        entries = self._read_index()
+        if entries is None:
+            self.complete = False
+            entries = list(self._scan_entries())
+        self.entries: List[Entry] = entries
+
+    def payload(self, entry: Entry) -> bytes:
+        start = entry.payload_offset
+        return self._data[start : start + entry.payload_size]
+
+    def _read_index(self) -> Optional[List[Entry]]:
+        if len(self._data) < _FILE_HEADER.size + _FOOTER.size:
+            return None
+
+        index_offset, entry_count, magic = _FOOTER.unpack_from(
+            self._data, len(self._data) - _FOOTER.size
+        )
+        if magic != FOOTER_MAGIC:
+            return None
+
+        entries = []
+        offset = index_offset
+        for _ in range(entry_count):
+            entry_type, entry_offset, payload_size, suite_len, test_len = (
+                _INDEX_ENTRY.unpack_from(self._data, offset)
+            )
+            offset += _INDEX_ENTRY.size
+            suite = self._data[offset : offset + suite_len].decode("utf-8")
+            offset += suite_len
+            test = self._data[offset : offset + test_len].decode("utf-8")
+            offset += test_len
+            entries.append(Entry(entry_type, suite, test, entry_offset, payload_size))
+        return entries
+
+    def _scan_entries(self) -> Iterator[Entry]:
+        """Recovers the entries from an archive whose index was never written."""
+        offset = _FILE_HEADER.size
+        while offset + _ENTRY_HEADER.size <= len(self._data):
+            magic, entry_type, payload_size, suite_len, test_len = (
+                _ENTRY_HEADER.unpack_from(self._data, offset)
+            )
+            if magic != ENTRY_MAGIC:
+                break
+            names_offset = offset + _ENTRY_HEADER.size
+            end = names_offset + suite_len + test_len + payload_size
+            if end > len(self._data):
+                print(
+                    f"Warning: {self.path} is truncated at entry offset {offset}",
+                    file=sys.stderr,
+                )
+                break
+            suite = self._data[names_offset : names_offset + suite_len].decode("utf-8")
+            test = self._data[
+                names_offset + suite_len : names_offset + suite_len + test_len
+            ].decode("utf-8")
+            yield Entry(entry_type, suite, test, offset, payload_size)
+            offset = end
+
+
+def parse_results_payload(payload: bytes) -> List[ResultRecord]:
+    """Decodes a PAYLOAD_RESULTS payload written by TestHost::SaveResults."""
+    version, count = struct.unpack_from("<II", payload, 0)
+    if version not in (1, 2):
+        raise ValueError(f"Unsupported results payload version {version}")
+
+    offset = 8
+    ret = []
+    for _ in range(count):
+        (title_len,) = struct.unpack_from("<I", payload, offset)
+        offset += 4
+        title = payload[offset : offset + title_len].decode("utf-8")
+        offset += title_len
+        input_hash = 0
+        if version >= 2:
+            (input_hash,) = struct.unpack_from("<Q", payload, offset)
+            offset += 8
+        (mask,) = struct.unpack_from("<I", payload, offset)
+        offset += 4
+
+        outputs = {}
+        for i in range(32):
+            if mask & (1 << i):
+                outputs[i] = struct.unpack_from("<IIII", payload, offset)
+                offset += 16
+        ret.append(ResultRecord(title, mask, outputs, input_hash))
+    return ret
+
+
+def serialize_results_payload(records: List[ResultRecord]) -> bytes:
+    """Encodes records in the PAYLOAD_RESULTS format written by TestHost::SaveResults."""
+    ret = bytearray(struct.pack("<II", 2, len(records)))
+    for record in records:
+        title = record.title.encode("utf-8")
+        ret += struct.pack("<I", len(title))
+        ret += title
+        ret += struct.pack("<QI", record.input_hash, record.results_mask)
+        for index in range(32):
+            if record.results_mask & (1 << index):
+                ret += struct.pack("<IIII", *record.outputs[index])
+    return bytes(ret)
+
+
+def write_archive(path: str, entries: Iterable[Tuple[int, str, str, bytes]]):
+    """Writes a complete archive containing the given (type, suite, test, payload) entries."""
+    index = []
+    with open(path, "wb") as outfile:
+        outfile.write(_FILE_HEADER.pack(FILE_MAGIC, VERSION, 0))
+        offset = _FILE_HEADER.size
+        for entry_type, suite, test, payload in entries:
+            suite_bytes = suite.encode("utf-8")
+            test_bytes = test.encode("utf-8")
+            index.append((entry_type, offset, len(payload), suite_bytes, test_bytes))
+            outfile.write(
+                _ENTRY_HEADER.pack(
+                    ENTRY_MAGIC, entry_type, len(payload), len(suite_bytes), len(test_bytes)
+                )
+            )
+            outfile.write(suite_bytes)
+            outfile.write(test_bytes)
+            outfile.write(payload)
+            offset += _ENTRY_HEADER.size + len(suite_bytes) + len(test_bytes) + len(payload)
+
+        for entry_type, entry_offset, payload_size, suite_bytes, test_bytes in index:
+            outfile.write(
+                _INDEX_ENTRY.pack(
+                    entry_type, entry_offset, payload_size, len(suite_bytes), len(test_bytes)
+                )
+            )
+            outfile.write(suite_bytes)
+            outfile.write(test_bytes)
+        outfile.write(_FOOTER.pack(offset, len(index), FOOTER_MAGIC))
+
+
+def _bits_to_float(bits: int) -> float:
+    return struct.unpack("<f", struct.pack("<I", bits))[0]
+
+
+def _format_results(records: List[ResultRecord]) -> str:
+    lines = []
+    for record in records:
+        lines.append(f"{record.title}:")
+        for index, values in sorted(record.outputs.items()):
+            floats = ", ".join(f"{_bits_to_float(v):g}" for v in values)
+            hexes = ", ".join(f"0x{v:08X}" for v in values)
+            lines.append(f"  [{index}] {floats}  ({hexes})")
+    return "\n".join(lines) + "\n"
+
+
+def _list(args) -> int:
+    archive = Archive(args.archive)
+    if not archive.complete:
+        print("Archive index is missing, entries were recovered by scanning.")
+    for entry in archive.entries:
+        print(
+            f"{entry.offset:10d} {entry.payload_size:10d} {entry.type_name:8s} {entry.suite}/{entry.test}"
+        )
+    return 0
+
+
+def _extract(args) -> int:
+    archive = Archive(args.archive)
+    for entry in archive.entries:
+        target = os.path.join(args.output_dir, entry.relative_path)
+        os.makedirs(os.path.dirname(target) or ".", exist_ok=True)
+        payload = archive.payload(entry)
+
+        if entry.type == PAYLOAD_RESULTS and args.text_results:
+            with open(target + ".txt", "w", encoding="utf-8") as outfile:
+                outfile.write(_format_results(parse_results_payload(payload)))
+            continue
+
+        with open(target, "wb") as outfile:
+            outfile.write(payload)
+    return 0
+
+
+def _diff(args) -> int:
+    old = Archive(args.old)
+    new = Archive(args.new)
+
+    def _digests(archive: Archive) -> Dict[Tuple[int, str, str], str]:
+        return {
+            entry.key: hashlib.sha1(archive.payload(entry)).hexdigest()
+            for entry in archive.entries
+            if entry.type != PAYLOAD_LOG or args.include_logs
+        }
+
+    old_digests = _digests(old)
+    new_digests = _digests(new)
+
+    def _name(key: Tuple[int, str, str]) -> str:
+        entry_type, suite, test = key
+        return f"{suite}/{test} ({PAYLOAD_NAMES.get(entry_type, entry_type)})"
+
+    differences = 0
+    for key in sorted(old_digests.keys() - new_digests.keys()):
+        print(f"- {_name(key)}")
+        differences += 1
+    for key in sorted(new_digests.keys() - old_digests.keys()):
+        print(f"+ {_name(key)}")
+        differences += 1
+    for key in sorted(old_digests.keys() & new_digests.keys()):
+        if old_digests[key] != new_digests[key]:
+            print(f"M {_name(key)}")
+            differences += 1
+
+    print(f"{differences} difference(s)")
+    return 1 if differences else 0
+
+
+def _merge(args) -> int:
+    """Combines the archives produced by several shards of a run."""
+    entries = []
+    seen = {}
+    for index, path in enumerate(args.archives):
+        archive = Archive(path)
+        if not archive.complete:
+            print(f"Warning: {path} has no index, merging the recovered entries.", file=sys.stderr)
+        for entry in archive.entries:
+            test = entry.test
+            if entry.key in seen:
+                if entry.type != PAYLOAD_LOG:
+                    print(
+                        f"{entry.suite}/{entry.test} ({entry.type_name}) is present in both {seen[entry.key]} and {path}",
+                        file=sys.stderr,
+                    )
+                    return 1
+                # Every shard writes its own progress log, keep them all.
+                test = f"{index}_{entry.test}"
+            seen[(entry.type, entry.suite, test)] = path
+            entries.append((entry.type, entry.suite, test, archive.payload(entry)))
+
+    write_archive(args.output, entries)
+    print(f"Wrote {len(entries)} entries to {args.output}")
+    return 0
+
+
+def _main(args) -> int:
+    return args.func(args)
+
+
+if __name__ == "__main__":
+
+    def _parse_args():
+        parser = argparse.ArgumentParser(description=__doc__)
+        subparsers = parser.add_subparsers(required=True)
+
+        list_parser = subparsers.add_parser("list", help="List the archive contents.")
+        list_parser.add_argument("archive", help="Path to the archive.")
+        list_parser.set_defaults(func=_list)
+
+        extract_parser = subparsers.add_parser(
+            "extract",
+            help="Extract the archive into the directory layout used by non-archived runs.",
+        )
+        extract_parser.add_argument("archive", help="Path to the archive.")
+        extract_parser.add_argument("output_dir", help="Directory to extract into.")
+        extract_parser.add_argument(
+            "--text-results",
+            action="store_true",
+            help="Write structured results as human readable text.",
+        )
+        extract_parser.set_defaults(func=_extract)
+
+        diff_parser = subparsers.add_parser(
+            "diff", help="Report entries that differ between two archives."
+        )
+        diff_parser.add_argument("old", help="Path to the baseline archive.")
+        diff_parser.add_argument("new", help="Path to the archive to compare.")
+        diff_parser.add_argument(
+            "--include-logs",
+            action="store_true",
+            help="Also compare log payloads, which almost always differ.",
+        )
+        diff_parser.set_defaults(func=_diff)
+
+        merge_parser = subparsers.add_parser(
+            "merge", help="Combine the archives written by the shards of a run into a single archive."
+        )
+        merge_parser.add_argument("output", help="Path of the archive to write.")
+        merge_parser.add_argument("archives", nargs="+", help="Paths to the archives to merge.")
+        merge_parser.set_defaults(func=_merge)
+
+        return parser.parse_args()
+
+    sys.exit(_main(_parse_args()))
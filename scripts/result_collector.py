@@ -0,0 +1,356 @@
+#!/usr/bin/env python3
+
+"""Collects results streamed from any number of consoles and checks them against goldens as they arrive.
+
+Clients may upload over FTP (as done by builds configured with ENABLE_FTP_UPLOAD, see ftp_receiver.py) or over a simple
+TCP framing. All connections are served from a single asyncio event loop.
+
+FTP uploads are indexed by path: `<run id>/<suite>/<test>.<png|results>`, so each console should be configured with a
+distinct FTP_REMOTE_PATH (e.g., the shard or console name) to act as its run ID.
+
+TCP frames are:
+  "VSHF" | u32 header_length | u32 payload_length | header (UTF-8 JSON) | payload
+where the header is `{"run": str, "suite": str, "test": str, "type": int}` and type is a result_archive.PAYLOAD_* value.
+Each frame is acknowledged with a single byte: 1 on success, 0 on failure.
+
+Received files are written to `<output>/<run id>/<suite>/` and every received entry is appended to
+`<output>/<run id>/index.jsonl` along with its comparison status. A per-run summary is printed when the collector exits.
+
+`simulate` replays an archive as several concurrent clients to exercise the collector locally.
+"""
+
+from __future__ import annotations
+
+import argparse
+import asyncio
+import ftplib
+import json
+import os
+import struct
+import sys
+import time
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Tuple
+
+import compare_results
+import result_archive
+from ftp_receiver import FTPReceiver
+
+FRAME_MAGIC = b"VSHF"
+_FRAME_HEADER = struct.Struct("<4sII")
+
+# Sanity limits applied to incoming TCP frames.
+_MAX_HEADER_LENGTH = 64 * 1024
+_MAX_PAYLOAD_LENGTH = 64 * 1024 * 1024
+
+_EXTENSION_TYPES = {extension: payload_type for payload_type, extension in result_archive.PAYLOAD_EXTENSIONS.items()}
+
+
+@dataclass
+class RunStatus:
+    """Incrementally updated outcome of a single run."""
+
+    received: int = 0
+    passed: int = 0
+    failed: int = 0
+    # Structured results that have no counterpart in the goldens.
+    unchecked: int = 0
+    failures: List[str] = field(default_factory=list)
+    first_seen: float = field(default_factory=time.time)
+    last_seen: float = field(default_factory=time.time)
+
+
+def _validate_name(name: str):
+    """Rejects client supplied names that would escape the output directory."""
+    if not name or name in (".", "..") or "/" in name or "\\" in name:
+        raise ValueError(f"Invalid name {name!r}")
+
+
+class Collector:
+    """Indexes incoming entries by run, suite and test and compares structured results against the goldens."""
+
+    def __init__(self, output_dir: str, goldens: compare_results.ResultSet, max_ulps: int, verbose: bool = False):
+        self.output_dir = output_dir
+        self.max_ulps = max_ulps
+        self.verbose = verbose
+        self.runs: Dict[str, RunStatus] = {}
+
+        # (suite, test) -> {key: outputs}, so that each arriving payload is checked without scanning every golden.
+        self._goldens: Dict[Tuple[str, str], Dict[compare_results.ResultKey, dict]] = {}
+        for key, outputs in goldens.items():
+            self._goldens.setdefault((key[0], key[1]), {})[key] = outputs
+
+    def store_path(self, run_id: str, suite: str, test: str, payload_type: int) -> str:
+        extension = result_archive.PAYLOAD_EXTENSIONS.get(payload_type, f".type{payload_type}")
+        return os.path.join(self.output_dir, run_id, suite, test + extension)
+
+    def on_entry(self, run_id: str, suite: str, test: str, payload_type: int, payload: bytes, already_stored=False):
+        for name in (run_id, suite, test):
+            _validate_name(name)
+
+        status = self.runs.setdefault(run_id, RunStatus())
+        status.received += 1
+        status.last_seen = time.time()
+
+        if not already_stored:
+            path = self.store_path(run_id, suite, test, payload_type)
+            os.makedirs(os.path.dirname(path), exist_ok=True)
+            with open(path, "wb") as outfile:
+                outfile.write(payload)
+
+        index_entry = {
+            "suite": suite,
+            "test": test,
+            "type": result_archive.PAYLOAD_NAMES.get(payload_type, payload_type),
+            "size": len(payload),
+            "time": status.last_seen,
+        }
+
+        if payload_type == result_archive.PAYLOAD_RESULTS:
+            outcome, detail = self._check(suite, test, payload)
+            index_entry["status"] = outcome
+            if outcome == "pass":
+                status.passed += 1
+            elif outcome == "fail":
+                status.failed += 1
+                status.failures.append(f"{suite}/{test}")
+                index_entry["detail"] = detail
+            else:
+                status.unchecked += 1
+
+            if self.verbose or outcome == "fail":
+                print(f"[{run_id}] {outcome.upper():9s} {suite}/{test} {detail}")
+
+        with open(os.path.join(self.output_dir, run_id, "index.jsonl"), "a", encoding="utf-8") as outfile:
+            outfile.write(json.dumps(index_entry, sort_keys=True))
+            outfile.write("\n")
+
+    def _check(self, suite: str, test: str, payload: bytes) -> Tuple[str, str]:
+        goldens = self._goldens.get((suite, test))
+        if not goldens:
+            return "unchecked", ""
+
+        received: compare_results.ResultSet = {}
+        try:
+            compare_results.add_records(received, suite, test, result_archive.parse_results_payload(payload))
+        except (ValueError, struct.error) as err:
+            return "fail", f"malformed payload: {err}"
+
+        matched = [(key, goldens[key], received[key]) for key in sorted(goldens.keys() & received.keys())]
+        diffs = compare_results.compare_chunk((matched, self.max_ulps))
+        missing = len(goldens.keys() - received.keys())
+        if diffs or missing:
+            return "fail", f"{len(diffs)} lane difference(s), {missing} missing"
+        return "pass", ""
+
+    def on_ftp_upload(self, relative_path: str, payload: bytes):
+        parts = relative_path.replace(os.sep, "/").split("/")
+        if len(parts) != 3:
+            print(f"Ignoring upload with unexpected path {relative_path}", file=sys.stderr)
+            return
+        run_id, suite, filename = parts
+        test, extension = os.path.splitext(filename)
+        payload_type = _EXTENSION_TYPES.get(extension)
+        if payload_type is None:
+            print(f"Ignoring upload with unknown type {relative_path}", file=sys.stderr)
+            return
+        try:
+            self.on_entry(run_id, suite, test, payload_type, payload, already_stored=True)
+        except ValueError as err:
+            print(f"Ignoring upload {relative_path}: {err}", file=sys.stderr)
+
+    async def handle_tcp_client(self, reader: asyncio.StreamReader, writer: asyncio.StreamWriter):
+        peer = writer.get_extra_info("peername")
+        try:
+            while True:
+                try:
+                    header = await reader.readexactly(_FRAME_HEADER.size)
+                except asyncio.IncompleteReadError as err:
+                    if err.partial:
+                        print(f"{peer}: truncated frame header", file=sys.stderr)
+                    break
+
+                magic, header_length, payload_length = _FRAME_HEADER.unpack(header)
+                if (
+                    magic != FRAME_MAGIC
+                    or header_length > _MAX_HEADER_LENGTH
+                    or payload_length > _MAX_PAYLOAD_LENGTH
+                ):
+                    print(f"{peer}: invalid frame, closing connection", file=sys.stderr)
+                    break
+
+                metadata = await reader.readexactly(header_length)
+                payload = await reader.readexactly(payload_length)
+                try:
+                    info = json.loads(metadata.decode("utf-8"))
+                    self.on_entry(info["run"], info["suite"], info["test"], int(info["type"]), payload)
+                except (ValueError, KeyError) as err:
+                    print(f"{peer}: rejected frame: {err}", file=sys.stderr)
+                    writer.write(b"\x00")
+                else:
+                    writer.write(b"\x01")
+                await writer.drain()
+        except (ConnectionError, asyncio.IncompleteReadError):
+            print(f"{peer}: connection lost", file=sys.stderr)
+        finally:
+            writer.close()
+
+    def summary(self) -> str:
+        lines = []
+        for run_id, status in sorted(self.runs.items()):
+            lines.append(
+                f"{run_id}: {status.received} received, {status.passed} passed, {status.failed} failed, "
+                f"{status.unchecked} unchecked"
+            )
+            for failure in status.failures:
+                lines.append(f"  FAIL {failure}")
+        return "\n".join(lines)
+
+
+def encode_frame(run_id: str, suite: str, test: str, payload_type: int, payload: bytes) -> bytes:
+    header = json.dumps({"run": run_id, "suite": suite, "test": test, "type": payload_type}).encode("utf-8")
+    return _FRAME_HEADER.pack(FRAME_MAGIC, len(header), len(payload)) + header + payload
+
+
+def _serve(args) -> int:
+    goldens = compare_results.load_results(args.golden) if args.golden else {}
+    os.makedirs(args.output_dir, exist_ok=True)
+    collector = Collector(args.output_dir, goldens, args.ulps, args.verbose)
+
+    async def _run():
+        tasks = []
+        if args.tcp_port >= 0:
+            tcp_server = await asyncio.start_server(collector.handle_tcp_client, args.host, args.tcp_port)
+            tasks.append(tcp_server.serve_forever())
+            print(f"Accepting framed TCP uploads on {args.host}:{tcp_server.sockets[0].getsockname()[1]}")
+
+        if args.ftp_port >= 0:
+            ftp_receiver = FTPReceiver(
+                args.output_dir, host=args.host, port=args.ftp_port, on_upload=collector.on_ftp_upload
+            )
+            await ftp_receiver.start()
+            tasks.append(ftp_receiver.serve_forever())
+            print(f"Accepting FTP uploads on {args.host}:{ftp_receiver.port}")
+
+        print(f"Writing results to {args.output_dir}, {len(goldens)} golden result(s) loaded")
+        await asyncio.gather(*tasks)
+
+    try:
+        asyncio.run(_run())
+    except KeyboardInterrupt:
+        pass
+
+    print(collector.summary())
+    return 1 if any(status.failed for status in collector.runs.values()) else 0
+
+
+def _simulate(args) -> int:
+    archive = result_archive.Archive(args.archive)
+    entries = [(entry, archive.payload(entry)) for entry in archive.entries if entry.type != result_archive.PAYLOAD_LOG]
+
+    async def _tcp_client(run_id: str) -> int:
+        reader, writer = await asyncio.open_connection(args.host, args.port)
+        rejected = 0
+        for entry, payload in entries:
+            writer.write(encode_frame(run_id, entry.suite, entry.test, entry.type, payload))
+            await writer.drain()
+            ack = await reader.readexactly(1)
+            rejected += ack != b"\x01"
+        writer.close()
+        await writer.wait_closed()
+        return rejected
+
+    def _ftp_client(run_id: str) -> int:
+        with ftplib.FTP() as ftp:
+            ftp.connect(args.host, args.port)
+            ftp.login("simulated", "simulated")
+            created = set()
+            for entry, payload in entries:
+                directory = f"{run_id}/{entry.suite}"
+                for path in (run_id, directory):
+                    if path not in created:
+                        try:
+                            ftp.mkd(path)
+                        except ftplib.error_perm:
+                            pass
+                        created.add(path)
+                extension = result_archive.PAYLOAD_EXTENSIONS[entry.type]
+                ftp.storbinary(f"STOR {directory}/{entry.test}{extension}", _BytesReader(payload))
+        return 0
+
+    async def _run() -> int:
+        run_ids = [f"{args.run_prefix}{index}" for index in range(args.clients)]
+        if args.protocol == "tcp":
+            results = await asyncio.gather(*(_tcp_client(run_id) for run_id in run_ids))
+        else:
+            results = await asyncio.gather(*(asyncio.to_thread(_ftp_client, run_id) for run_id in run_ids))
+        return sum(results)
+
+    start = time.perf_counter()
+    rejected = asyncio.run(_run())
+    elapsed = time.perf_counter() - start
+    print(
+        f"Sent {len(entries) * args.clients} entries from {args.clients} client(s) in {elapsed * 1000:.1f}ms, "
+        f"{rejected} rejected"
+    )
+    return 1 if rejected else 0
+
+
+class _BytesReader:
+    """Minimal file-like wrapper used to hand payloads to ftplib."""
+
+    def __init__(self, data: bytes):
+        self._data = data
+        self._offset = 0
+
+    def read(self, size: int = -1) -> bytes:
+        if size < 0:
+            size = len(self._data) - self._offset
+        ret = self._data[self._offset : self._offset + size]
+        self._offset += len(ret)
+        return ret
+
+
+def _main(args) -> int:
+    return args.func(args)
+
+
+if __name__ == "__main__":
+
+    def _parse_args():
+        parser = argparse.ArgumentParser(
+            description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+        )
+        subparsers = parser.add_subparsers(required=True)
+
+        serve_parser = subparsers.add_parser("serve", help="Run the collector.")
+        serve_parser.add_argument("output_dir", help="Directory into which received results are written.")
+        serve_parser.add_argument("--golden", help="Result archive or extracted directory to check results against.")
+        serve_parser.add_argument("--host", default="0.0.0.0", help="Address to listen on.")
+        serve_parser.add_argument(
+            "--tcp-port", type=int, default=2120, help="Port for framed TCP uploads, -1 to disable."
+        )
+        serve_parser.add_argument("--ftp-port", type=int, default=2121, help="Port for FTP uploads, -1 to disable.")
+        serve_parser.add_argument(
+            "--ulps",
+            type=int,
+            default=compare_results.DEFAULT_ULPS,
+            help="Maximum number of units in the last place that values may differ by.",
+        )
+        serve_parser.add_argument("-v", "--verbose", action="store_true", help="Report every checked result.")
+        serve_parser.set_defaults(func=_serve)
+
+        simulate_parser = subparsers.add_parser(
+            "simulate", help="Replay an archive as several concurrent clients."
+        )
+        simulate_parser.add_argument("archive", help="Result archive to replay.")
+        simulate_parser.add_argument("--host", default="127.0.0.1", help="Address of the collector.")
+        simulate_parser.add_argument("--port", type=int, default=2120, help="Port of the collector.")
+        simulate_parser.add_argument("--protocol", choices=("tcp", "ftp"), default="tcp", help="Upload protocol.")
+        simulate_parser.add_argument("--clients", type=int, default=4, help="Number of concurrent clients.")
+        simulate_parser.add_argument("--run-prefix", default="sim", help="Prefix of the simulated run IDs.")
+        simulate_parser.set_defaults(func=_simulate)
+
+        return parser.parse_args()
+
+    sys.exit(_main(_parse_args()))
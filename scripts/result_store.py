@@ -0,0 +1,314 @@
+#!/usr/bin/env python3
+
+"""Content-addressed store for nxdk_vsh_tests run outputs.
+
+Each payload in a result archive is stored once as a blob named by its SHA-256 digest. A run is recorded as a manifest
+listing the digest of every output, so ingesting a run that matches a previous one only writes the manifest and
+answering "did anything change?" is a manifest comparison.
+
+Structured results are split into one blob per TestHost::Results entry. The blob covers the input hash (shader
+microcode and constants, see TestHost::HashInputs) and the output registers but not the title, so renaming a test does
+not invalidate its stored results.
+
+Layout:
+  <store>/objects/<first two hex digits>/<sha256>
+  <store>/manifests/<run id>.jsonl
+"""
+
+from __future__ import annotations
+
+import argparse
+import datetime
+import hashlib
+import json
+import os
+import struct
+import sys
+from dataclasses import asdict, dataclass
+from typing import Dict, Iterator, List, Optional, Tuple
+
+import result_archive
+
+_OBJECTS_DIR = "objects"
+_MANIFESTS_DIR = "manifests"
+_MANIFEST_EXTENSION = ".jsonl"
+
+_RECORD_HEADER = struct.Struct("<QI")
+
+
+@dataclass
+class ManifestEntry:
+    """A single stored output of a run."""
+
+    type: int
+    suite: str
+    test: str
+    # Title of the TestHost::Results entry for PAYLOAD_RESULTS, empty otherwise.
+    title: str
+    # Distinguishes entries that share the same type, suite, test and title.
+    occurrence: int
+    hash: str
+
+    @property
+    def key(self) -> Tuple[int, str, str, str, int]:
+        return self.type, self.suite, self.test, self.title, self.occurrence
+
+    @property
+    def name(self) -> str:
+        ret = f"{self.suite}/{self.test}"
+        if self.title:
+            ret += f": {self.title.replace(chr(10), ' ')}"
+        if self.occurrence:
+            ret += f"#{self.occurrence}"
+        return f"{ret} ({result_archive.PAYLOAD_NAMES.get(self.type, self.type)})"
+
+
+def _encode_record(record: result_archive.ResultRecord) -> bytes:
+    ret = bytearray(_RECORD_HEADER.pack(record.input_hash, record.results_mask))
+    for index in range(32):
+        if record.results_mask & (1 << index):
+            ret += struct.pack("<IIII", *record.outputs[index])
+    return bytes(ret)
+
+
+def _decode_record(title: str, blob: bytes) -> result_archive.ResultRecord:
+    input_hash, mask = _RECORD_HEADER.unpack_from(blob, 0)
+    offset = _RECORD_HEADER.size
+    outputs = {}
+    for index in range(32):
+        if mask & (1 << index):
+            outputs[index] = struct.unpack_from("<IIII", blob, offset)
+            offset += 16
+    return result_archive.ResultRecord(title, mask, outputs, input_hash)
+
+
+class Store:
+    """A directory of content-addressed blobs and run manifests."""
+
+    def __init__(self, root: str):
+        self.root = root
+
+    def _object_path(self, digest: str) -> str:
+        return os.path.join(self.root, _OBJECTS_DIR, digest[:2], digest)
+
+    def _manifest_path(self, run_id: str) -> str:
+        return os.path.join(self.root, _MANIFESTS_DIR, run_id + _MANIFEST_EXTENSION)
+
+    def put(self, blob: bytes) -> Tuple[str, bool]:
+        """Stores the blob if it is not already present. Returns its digest and whether it was newly written."""
+        digest = hashlib.sha256(blob).hexdigest()
+        path = self._object_path(digest)
+        if os.path.exists(path):
+            return digest, False
+
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        # Write to a temporary file first so an interrupted ingest never leaves a truncated blob behind.
+        temp_path = path + ".tmp"
+        with open(temp_path, "wb") as outfile:
+            outfile.write(blob)
+        os.replace(temp_path, path)
+        return digest, True
+
+    def get(self, digest: str) -> bytes:
+        with open(self._object_path(digest), "rb") as infile:
+            return infile.read()
+
+    def runs(self) -> List[str]:
+        manifests_dir = os.path.join(self.root, _MANIFESTS_DIR)
+        if not os.path.isdir(manifests_dir):
+            return []
+        return sorted(
+            filename[: -len(_MANIFEST_EXTENSION)]
+            for filename in os.listdir(manifests_dir)
+            if filename.endswith(_MANIFEST_EXTENSION)
+        )
+
+    def has_run(self, run_id: str) -> bool:
+        return os.path.isfile(self._manifest_path(run_id))
+
+    def write_manifest(self, run_id: str, entries: List[ManifestEntry]):
+        path = self._manifest_path(run_id)
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        temp_path = path + ".tmp"
+        with open(temp_path, "w", encoding="utf-8") as outfile:
+            for entry in entries:
+                outfile.write(json.dumps(asdict(entry), sort_keys=True))
+                outfile.write("\n")
+        os.replace(temp_path, path)
+
+    def read_manifest(self, run_id: str) -> List[ManifestEntry]:
+        with open(self._manifest_path(run_id), encoding="utf-8") as infile:
+            return [ManifestEntry(**json.loads(line)) for line in infile if line.strip()]
+
+
+def _split_archive(archive: result_archive.Archive) -> Iterator[Tuple[ManifestEntry, bytes]]:
+    """Yields a manifest entry (with an empty hash) and blob for every storable unit in the archive."""
+    occurrences: Dict[Tuple[int, str, str, str], int] = {}
+
+    def _entry(entry_type: int, suite: str, test: str, title: str) -> ManifestEntry:
+        key = (entry_type, suite, test, title)
+        occurrence = occurrences.get(key, 0)
+        occurrences[key] = occurrence + 1
+        return ManifestEntry(entry_type, suite, test, title, occurrence, "")
+
+    for entry in archive.entries:
+        payload = archive.payload(entry)
+        if entry.type != result_archive.PAYLOAD_RESULTS:
+            yield _entry(entry.type, entry.suite, entry.test, ""), payload
+            continue
+
+        for record in result_archive.parse_results_payload(payload):
+            yield _entry(entry.type, entry.suite, entry.test, record.title), _encode_record(record)
+
+
+def _ingest(args) -> int:
+    store = Store(args.store)
+    run_id = args.run_id or datetime.datetime.now().strftime("%Y%m%d-%H%M%S")
+    if store.has_run(run_id) and not args.force:
+        print(f"Run {run_id} already exists in {args.store}, use --force to replace it.", file=sys.stderr)
+        return 1
+
+    archive = result_archive.Archive(args.archive)
+    if not archive.complete:
+        print(f"Warning: {args.archive} has no index, ingesting the recovered entries.", file=sys.stderr)
+
+    manifest = []
+    new_blobs = 0
+    new_bytes = 0
+    total_bytes = 0
+    for entry, blob in _split_archive(archive):
+        entry.hash, is_new = store.put(blob)
+        manifest.append(entry)
+        total_bytes += len(blob)
+        if is_new:
+            new_blobs += 1
+            new_bytes += len(blob)
+
+    store.write_manifest(run_id, manifest)
+    print(
+        f"Ingested {run_id}: {len(manifest)} entries, {new_blobs} new blob(s), "
+        f"{new_bytes} of {total_bytes} bytes written"
+    )
+    return 0
+
+
+def _runs(args) -> int:
+    for run_id in Store(args.store).runs():
+        print(run_id)
+    return 0
+
+
+def _diff(args) -> int:
+    store = Store(args.store)
+
+    def _hashes(run_id: str) -> Dict[Tuple[int, str, str, str, int], ManifestEntry]:
+        return {
+            entry.key: entry
+            for entry in store.read_manifest(run_id)
+            if entry.type != result_archive.PAYLOAD_LOG or args.include_logs
+        }
+
+    old = _hashes(args.old)
+    new = _hashes(args.new)
+
+    differences = 0
+    for key in sorted(old.keys() - new.keys()):
+        print(f"- {old[key].name}")
+        differences += 1
+    for key in sorted(new.keys() - old.keys()):
+        print(f"+ {new[key].name}")
+        differences += 1
+    for key in sorted(old.keys() & new.keys()):
+        if old[key].hash != new[key].hash:
+            print(f"M {new[key].name}")
+            differences += 1
+
+    print(f"{differences} difference(s)")
+    return 1 if differences else 0
+
+
+def _export(args) -> int:
+    """Reassembles a run into a result archive that the other tools can consume."""
+    store = Store(args.store)
+    manifest = store.read_manifest(args.run_id)
+
+    entries: List[Tuple[int, str, str, bytes]] = []
+    pending_records: List[result_archive.ResultRecord] = []
+    pending_key: Optional[Tuple[str, str]] = None
+
+    def _flush_records():
+        if pending_key is not None:
+            entries.append(
+                (
+                    result_archive.PAYLOAD_RESULTS,
+                    pending_key[0],
+                    pending_key[1],
+                    result_archive.serialize_results_payload(pending_records),
+                )
+            )
+
+    for entry in manifest:
+        blob = store.get(entry.hash)
+        if entry.type != result_archive.PAYLOAD_RESULTS:
+            _flush_records()
+            pending_key = None
+            pending_records = []
+            entries.append((entry.type, entry.suite, entry.test, blob))
+            continue
+
+        if pending_key != (entry.suite, entry.test):
+            _flush_records()
+            pending_key = (entry.suite, entry.test)
+            pending_records = []
+        pending_records.append(_decode_record(entry.title, blob))
+    _flush_records()
+
+    result_archive.write_archive(args.output, entries)
+    print(f"Wrote {len(entries)} entries to {args.output}")
+    return 0
+
+
+def _main(args) -> int:
+    return args.func(args)
+
+
+if __name__ == "__main__":
+
+    def _parse_args():
+        parser = argparse.ArgumentParser(
+            description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+        )
+        parser.add_argument("--store", required=True, help="Root directory of the store.")
+        subparsers = parser.add_subparsers(required=True)
+
+        ingest_parser = subparsers.add_parser("ingest", help="Add the contents of a result archive to the store.")
+        ingest_parser.add_argument("archive", help="Path to the archive.")
+        ingest_parser.add_argument(
+            "--run-id", help="Name of the run. Defaults to the current date and time."
+        )
+        ingest_parser.add_argument(
+            "--force", action="store_true", help="Replace the manifest if the run already exists."
+        )
+        ingest_parser.set_defaults(func=_ingest)
+
+        runs_parser = subparsers.add_parser("runs", help="List the runs in the store.")
+        runs_parser.set_defaults(func=_runs)
+
+        diff_parser = subparsers.add_parser("diff", help="Report outputs that differ between two runs.")
+        diff_parser.add_argument("old", help="ID of the baseline run.")
+        diff_parser.add_argument("new", help="ID of the run to compare.")
+        diff_parser.add_argument(
+            "--include-logs",
+            action="store_true",
+            help="Also compare log payloads, which almost always differ.",
+        )
+        diff_parser.set_defaults(func=_diff)
+
+        export_parser = subparsers.add_parser("export", help="Rebuild a result archive from a stored run.")
+        export_parser.add_argument("run_id", help="ID of the run to export.")
+        export_parser.add_argument("output", help="Path of the archive to write.")
+        export_parser.set_defaults(func=_export)
+
+        return parser.parse_args()
+
+    sys.exit(_main(_parse_args()))
@@ -0,0 +1,307 @@
+#!/usr/bin/env python3
+
+"""Maintains a history of test runtimes across builds and flags statistically significant slowdowns.
+
+Builds configured with ENABLE_RUNTIME_HISTORY append "build,run,suite,test,metric,microseconds" rows to
+runtime_history.csv as each test ends (see src/runtime_history.h). `ingest` merges those files, or result archives
+containing them, into a single deduplicated history. `check` compares the runs of one build against the runs of a
+baseline build:
+
+  * Each test and metric is compared with a one-sided Mann-Whitney U test over the per-run samples, which needs a few
+    runs of each build to become significant.
+  * Each suite and metric is compared with a one-sided Wilcoxon signed-rank test over the per-test ratios of the
+    median runtimes, which detects a suite-wide slowdown (e.g., after a harness change) from a single run of each build.
+
+Findings are reported with a confidence of 1 - p and the command exits with a non-zero status if any slowdown exceeds
+both the confidence and the minimum slowdown thresholds.
+"""
+
+from __future__ import annotations
+
+import argparse
+import collections
+import csv
+import io
+import itertools
+import math
+import os
+import statistics
+import sys
+from dataclasses import dataclass
+from typing import Dict, Iterable, List, Optional, Sequence, Tuple
+
+import result_archive
+
+_HISTORY_NAME = "runtime_history.csv"
+_FIELDS = ["build", "run", "suite", "test", "metric", "microseconds"]
+
+# Exact null distributions are used up to these sizes, normal approximations beyond them.
+_MAX_EXACT_COMBINATIONS = 20000
+_MAX_EXACT_SIGNED_RANKS = 30
+
+Row = Tuple[str, str, str, str, str]
+
+
+def _read_history(path: str) -> Iterable[Dict[str, str]]:
+    with open(path, "rb") as infile:
+        is_archive = infile.read(len(result_archive.FILE_MAGIC)) == result_archive.FILE_MAGIC
+
+    if not is_archive:
+        with open(path, encoding="utf-8") as infile:
+            yield from csv.DictReader(infile)
+        return
+
+    archive = result_archive.Archive(path)
+    for entry in archive.entries:
+        if entry.type == result_archive.PAYLOAD_LOG and entry.test == _HISTORY_NAME:
+            yield from csv.DictReader(io.StringIO(archive.payload(entry).decode("utf-8")))
+
+
+def load(path: str) -> Dict[Row, int]:
+    """Returns a map of (build, run, suite, test, metric) to microseconds."""
+    history = {}
+    for row in _read_history(path):
+        history[(row["build"], row["run"], row["suite"], row["test"], row["metric"])] = int(row["microseconds"])
+    return history
+
+
+def _save(path: str, history: Dict[Row, int]):
+    temp_path = path + ".tmp"
+    with open(temp_path, "w", encoding="utf-8", newline="") as outfile:
+        writer = csv.writer(outfile, lineterminator="\n")
+        writer.writerow(_FIELDS)
+        for key in sorted(history, key=lambda k: (int(k[1]), k[0], k[2], k[3], k[4])):
+            writer.writerow([*key, history[key]])
+    os.replace(temp_path, path)
+
+
+def _build_order(history: Dict[Row, int]) -> List[str]:
+    """Returns builds ordered by the start of their first run."""
+    first_run: Dict[str, int] = {}
+    for build, run, *_ in history:
+        first_run[build] = min(first_run.get(build, int(run)), int(run))
+    return sorted(first_run, key=lambda build: first_run[build])
+
+
+def _samples(history: Dict[Row, int], build: str) -> Dict[Tuple[str, str, str], List[int]]:
+    """Returns the per-run samples of every (suite, test, metric) of the given build."""
+    ret: Dict[Tuple[str, str, str], List[int]] = {}
+    for (row_build, _run, suite, test, metric), value in history.items():
+        if row_build == build:
+            ret.setdefault((suite, test, metric), []).append(value)
+    return ret
+
+
+def _normal_sf(z: float) -> float:
+    return 0.5 * math.erfc(z / math.sqrt(2.0))
+
+
+def _midranks(values: Sequence[float]) -> List[float]:
+    order = sorted(range(len(values)), key=lambda i: values[i])
+    ranks = [0.0] * len(values)
+    i = 0
+    while i < len(order):
+        j = i
+        while j + 1 < len(order) and values[order[j + 1]] == values[order[i]]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[order[k]] = (i + j) / 2.0 + 1.0
+        i = j + 1
+    return ranks
+
+
+def mann_whitney_greater(current: Sequence[float], baseline: Sequence[float]) -> float:
+    """Returns the one-sided p-value that `current` tends to be larger than `baseline`."""
+    n1, n2 = len(current), len(baseline)
+    ranks = _midranks([*current, *baseline])
+    observed = sum(ranks[:n1])
+
+    if math.comb(n1 + n2, n1) <= _MAX_EXACT_COMBINATIONS:
+        at_least = total = 0
+        for chosen in itertools.combinations(ranks, n1):
+            total += 1
+            if sum(chosen) >= observed - 1e-9:
+                at_least += 1
+        return at_least / total
+
+    u = observed - n1 * (n1 + 1) / 2.0
+    ties = collections.Counter(ranks).values()
+    n = n1 + n2
+    variance = n1 * n2 / 12.0 * ((n + 1) - sum(t**3 - t for t in ties) / (n * (n - 1)))
+    if variance <= 0:
+        return 1.0
+    return _normal_sf((u - n1 * n2 / 2.0 - 0.5) / math.sqrt(variance))
+
+
+def wilcoxon_greater(differences: Sequence[float]) -> float:
+    """Returns the one-sided p-value that the differences are centered above zero."""
+    nonzero = [d for d in differences if d != 0.0]
+    n = len(nonzero)
+    if not n:
+        return 1.0
+
+    ranks = _midranks([abs(d) for d in nonzero])
+    observed = sum(rank for rank, d in zip(ranks, nonzero) if d > 0)
+
+    if n <= _MAX_EXACT_SIGNED_RANKS:
+        # Count the sign assignments by the sum of their positive ranks, in half rank units to keep ties integral.
+        counts = {0: 1}
+        for rank in ranks:
+            step = round(rank * 2)
+            updated = dict(counts)
+            for total, count in counts.items():
+                updated[total + step] = updated.get(total + step, 0) + count
+            counts = updated
+        threshold = round(observed * 2)
+        return sum(count for total, count in counts.items() if total >= threshold) / 2**n
+
+    ties = collections.Counter(ranks).values()
+    variance = n * (n + 1) * (2 * n + 1) / 24.0 - sum(t**3 - t for t in ties) / 48.0
+    return _normal_sf((observed - n * (n + 1) / 4.0 - 0.5) / math.sqrt(variance))
+
+
+@dataclass
+class Finding:
+    name: str
+    metric: str
+    baseline_us: float
+    current_us: float
+    samples: str
+    confidence: float
+
+    @property
+    def ratio(self) -> float:
+        return self.current_us / self.baseline_us if self.baseline_us else math.inf
+
+
+def compare(
+    history: Dict[Row, int], build: str, baseline: str, min_microseconds: int
+) -> List[Finding]:
+    current_samples = _samples(history, build)
+    baseline_samples = _samples(history, baseline)
+
+    findings = []
+    suite_ratios: Dict[Tuple[str, str], List[float]] = {}
+    suite_totals: Dict[Tuple[str, str], List[float]] = {}
+    for key in sorted(current_samples.keys() & baseline_samples.keys()):
+        suite, test, metric = key
+        current, previous = current_samples[key], baseline_samples[key]
+        previous_median = statistics.median(previous)
+        current_median = statistics.median(current)
+        if max(previous_median, current_median) < min_microseconds or not previous_median or not current_median:
+            continue
+
+        findings.append(
+            Finding(
+                f"{suite}::{test}",
+                metric,
+                previous_median,
+                current_median,
+                f"{len(previous)}->{len(current)} runs",
+                1.0 - mann_whitney_greater(current, previous),
+            )
+        )
+        suite_ratios.setdefault((suite, metric), []).append(math.log(current_median / previous_median))
+        totals = suite_totals.setdefault((suite, metric), [0.0, 0.0])
+        totals[0] += previous_median
+        totals[1] += current_median
+
+    for (suite, metric), log_ratios in sorted(suite_ratios.items()):
+        previous_total, current_total = suite_totals[(suite, metric)]
+        findings.append(
+            Finding(
+                f"{suite}::*",
+                metric,
+                previous_total,
+                current_total,
+                f"{len(log_ratios)} tests",
+                1.0 - wilcoxon_greater(log_ratios),
+            )
+        )
+
+    return findings
+
+
+def _ingest(args) -> int:
+    history = load(args.history) if os.path.exists(args.history) else {}
+    before = len(history)
+    for path in args.inputs:
+        history.update(load(path))
+    _save(args.history, history)
+    print(f"Added {len(history) - before} rows, {len(history)} total")
+    return 0
+
+
+def _check(args) -> int:
+    history = load(args.history)
+    builds = _build_order(history)
+    build: Optional[str] = args.build or (builds[-1] if builds else None)
+    if build not in builds:
+        print(f"No runs of build {build}", file=sys.stderr)
+        return 1
+
+    baseline = args.baseline
+    if not baseline:
+        index = builds.index(build)
+        if not index:
+            print(f"No build precedes {build}", file=sys.stderr)
+            return 1
+        baseline = builds[index - 1]
+
+    findings = compare(history, build, baseline, args.min_us)
+    slower = [
+        f
+        for f in findings
+        if f.confidence >= args.confidence and f.ratio >= 1.0 + args.min_slowdown
+    ]
+    slower.sort(key=lambda f: (-f.confidence, -f.ratio))
+
+    print(f"Comparing {build} against {baseline}: {len(findings)} comparisons")
+    for finding in slower:
+        print(
+            f"SLOWER {finding.name} {finding.metric}: {finding.baseline_us / 1000.0:.2f}ms -> "
+            f"{finding.current_us / 1000.0:.2f}ms ({(finding.ratio - 1.0) * 100.0:+.1f}%, {finding.samples}), "
+            f"confidence {finding.confidence:.3f}"
+        )
+
+    if not slower:
+        print("No significant slowdowns")
+        return 0
+    return 1
+
+
+def _main(args) -> int:
+    return args.func(args)
+
+
+if __name__ == "__main__":
+
+    def _parse_args():
+        parser = argparse.ArgumentParser(
+            description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+        )
+        parser.add_argument(
+            "--history", default=_HISTORY_NAME, help="Merged history file to read and update."
+        )
+        subparsers = parser.add_subparsers(required=True)
+
+        ingest = subparsers.add_parser("ingest", help="Merge runtime histories into the history file.")
+        ingest.add_argument("inputs", nargs="+", help="runtime_history.csv files or result archives.")
+        ingest.set_defaults(func=_ingest)
+
+        check = subparsers.add_parser("check", help="Report slowdowns of one build relative to another.")
+        check.add_argument("--build", help="Build to check, defaults to the most recently run build.")
+        check.add_argument("--baseline", help="Build to compare against, defaults to the build run before --build.")
+        check.add_argument(
+            "--confidence", type=float, default=0.95, help="Minimum confidence (1 - p) to report a slowdown."
+        )
+        check.add_argument(
+            "--min-slowdown", type=float, default=0.05, help="Minimum fractional slowdown to report, e.g. 0.05 = 5%%."
+        )
+        check.add_argument(
+            "--min-us", type=int, default=100, help="Ignore metrics whose medians are below this many microseconds."
+        )
+        check.set_defaults(func=_check)
+        return parser.parse_args()
+
+    sys.exit(_main(_parse_args()))
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+
+"""Generates the test duration history used to balance shards (see src/test_sharder.h).
+
+Reads progress logs (log.txt files written by builds configured with ENABLE_PROGRESS_LOG, or result archives containing
+them) and writes the median duration of each test as lines of the form "<milliseconds> <suite>::<test>". Copy the
+output to the XBE directory as test_durations.txt, or point at it with a "!durations" directive in the config file.
+"""
+
+from __future__ import annotations
+
+import argparse
+import re
+import statistics
+import sys
+from typing import Dict, Iterable, List
+
+import result_archive
+
+_START_RE = re.compile(r"^Starting (.+)::(.+)$")
+_END_RE = re.compile(r"^\s+Completed (.+) (\d+)ms$")
+
+
+def parse_log(lines: Iterable[str], durations: Dict[str, List[int]]):
+    current = None
+    for line in lines:
+        line = line.rstrip("\r\n")
+        match = _START_RE.match(line)
+        if match:
+            current = match.groups()
+            continue
+
+        match = _END_RE.match(line)
+        if match and current and match.group(1) == current[1]:
+            durations.setdefault(f"{current[0]}::{current[1]}", []).append(int(match.group(2)))
+            current = None
+
+
+def _load(path: str, durations: Dict[str, List[int]]):
+    with open(path, "rb") as infile:
+        is_archive = infile.read(len(result_archive.FILE_MAGIC)) == result_archive.FILE_MAGIC
+
+    if not is_archive:
+        with open(path, encoding="utf-8", errors="replace") as infile:
+            parse_log(infile, durations)
+        return
+
+    archive = result_archive.Archive(path)
+    for entry in archive.entries:
+        if entry.type == result_archive.PAYLOAD_LOG:
+            parse_log(archive.payload(entry).decode("utf-8", errors="replace").splitlines(), durations)
+
+
+def _main(args) -> int:
+    durations: Dict[str, List[int]] = {}
+    for path in args.inputs:
+        _load(path, durations)
+
+    if not durations:
+        print("No test durations found", file=sys.stderr)
+        return 1
+
+    with open(args.output, "w", encoding="utf-8") if args.output != "-" else sys.stdout as outfile:
+        outfile.write("# Median test durations, see scripts/shard_durations.py\n")
+        for key, values in sorted(durations.items()):
+            outfile.write(f"{int(statistics.median(values))} {key}\n")
+    return 0
+
+
+if __name__ == "__main__":
+
+    def _parse_args():
+        parser = argparse.ArgumentParser(
+            description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+        )
+        parser.add_argument("inputs", nargs="+", help="Progress logs or result archives to read.")
+        parser.add_argument(
+            "-o", "--output", default="test_durations.txt", help="File to write, '-' for stdout."
+        )
+        return parser.parse_args()
+
+    sys.exit(_main(_parse_args()))
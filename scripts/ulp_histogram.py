@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+
+"""Summarizes the ulp_histogram.csv written by CPU Shader Tests in builds configured with ENABLE_ULP_HISTOGRAMS.
+
+For every opcode and output lane, prints the number of comparisons, the fraction that matched exactly, the ULP distance
+at several quantiles (as the upper bound of the power of two bucket that contains the quantile) and the number of
+sign and NaN disagreements. The tolerance column is the smallest bucket bound covering --quantile of the comparisons,
+a data-driven starting point for kUnitsInLastPlace. With --by-exponent, the maximum bucket is broken down by the sign
+and exponent of the input instead.
+
+The CSV itself is in long format ("opcode,lane,input_sign,input_exponent,bucket,count") for plotting with other tools.
+"""
+
+from __future__ import annotations
+
+import argparse
+import csv
+import io
+import sys
+from typing import Dict, Iterable, List, Tuple
+
+import result_archive
+
+_HISTOGRAM_NAME = "ulp_histogram.csv"
+_SPECIAL_BUCKETS = ("sign", "nan")
+_QUANTILES = (0.5, 0.99, 0.999)
+
+
+def _read(path: str) -> Iterable[Dict[str, str]]:
+    with open(path, "rb") as infile:
+        is_archive = infile.read(len(result_archive.FILE_MAGIC)) == result_archive.FILE_MAGIC
+
+    if not is_archive:
+        with open(path, encoding="utf-8") as infile:
+            yield from csv.DictReader(infile)
+        return
+
+    archive = result_archive.Archive(path)
+    for entry in archive.entries:
+        if entry.type == result_archive.PAYLOAD_LOG and entry.test == _HISTOGRAM_NAME:
+            yield from csv.DictReader(io.StringIO(archive.payload(entry).decode("utf-8")))
+
+
+def bucket_max_ulps(bucket: int) -> int:
+    """Returns the largest ULP distance counted in the given power of two bucket."""
+    return (1 << bucket) - 1
+
+
+def _quantile_bucket(buckets: Dict[int, int], total: int, quantile: float) -> int:
+    covered = 0
+    for bucket in sorted(buckets):
+        covered += buckets[bucket]
+        if covered >= quantile * total:
+            return bucket
+    return max(buckets) if buckets else 0
+
+
+def _summarize(rows: Iterable[Dict[str, str]], quantile: float):
+    histograms: Dict[Tuple[str, str], Dict[str, int]] = {}
+    for row in rows:
+        buckets = histograms.setdefault((row["opcode"], row["lane"]), {})
+        buckets[row["bucket"]] = buckets.get(row["bucket"], 0) + int(row["count"])
+
+    headers = ["opcode", "lane", "count", "exact", *(f"p{q * 100:g}" for q in _QUANTILES), "max", "tolerance", "sign", "nan"]
+    table: List[List[str]] = []
+    for (opcode, lane), buckets in sorted(histograms.items()):
+        numeric = {int(bucket): count for bucket, count in buckets.items() if bucket not in _SPECIAL_BUCKETS}
+        total = sum(buckets.values())
+        quantiles = [bucket_max_ulps(_quantile_bucket(numeric, total, q)) for q in _QUANTILES]
+        table.append(
+            [
+                opcode,
+                lane,
+                str(total),
+                f"{numeric.get(0, 0) / total:.1%}",
+                *(str(q) for q in quantiles),
+                str(bucket_max_ulps(max(numeric))) if numeric else "-",
+                str(bucket_max_ulps(_quantile_bucket(numeric, total, quantile))),
+                str(buckets.get("sign", 0)),
+                str(buckets.get("nan", 0)),
+            ]
+        )
+    return headers, table
+
+
+def _by_exponent(rows: Iterable[Dict[str, str]], opcode: str):
+    worst: Dict[Tuple[int, str], Dict[str, str]] = {}
+    lanes = set()
+    for row in rows:
+        if row["opcode"] != opcode:
+            continue
+        lanes.add(row["lane"])
+        key = (int(row["input_exponent"]), row["input_sign"])
+        cell = worst.setdefault(key, {})
+        bucket = row["bucket"]
+        previous = cell.get(row["lane"])
+        if bucket in _SPECIAL_BUCKETS:
+            cell[row["lane"]] = bucket if previous in (None, *_SPECIAL_BUCKETS) else f"{previous}+{bucket}"
+        elif previous is None or (previous not in _SPECIAL_BUCKETS and int(bucket) > int(previous)):
+            cell[row["lane"]] = bucket
+
+    ordered_lanes = [lane for lane in "xyzw" if lane in lanes]
+    headers = ["sign", "exponent", *ordered_lanes]
+    table = []
+    for (exponent, sign), cell in sorted(worst.items(), key=lambda item: (item[0][1], item[0][0])):
+        values = []
+        for lane in ordered_lanes:
+            value = cell.get(lane, "")
+            values.append(str(bucket_max_ulps(int(value))) if value.isdigit() else value)
+        table.append([sign, str(exponent - 127), *values])
+    return headers, table
+
+
+def _print_table(headers: List[str], table: List[List[str]]):
+    widths = [max(len(h), *(len(row[i]) for row in table)) for i, h in enumerate(headers)]
+    print("  ".join(h.rjust(widths[i]) for i, h in enumerate(headers)))
+    for row in table:
+        print("  ".join(v.rjust(widths[i]) for i, v in enumerate(row)))
+
+
+def _main(args) -> int:
+    rows = list(_read(args.histogram))
+    if not rows:
+        print("No histogram data found", file=sys.stderr)
+        return 1
+
+    if args.by_exponent:
+        headers, table = _by_exponent(rows, args.by_exponent)
+    else:
+        headers, table = _summarize(rows, args.quantile)
+
+    if not table:
+        print("No matching histogram data", file=sys.stderr)
+        return 1
+    _print_table(headers, table)
+    return 0
+
+
+if __name__ == "__main__":
+
+    def _parse_args():
+        parser = argparse.ArgumentParser(
+            description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+        )
+        parser.add_argument("histogram", help="ulp_histogram.csv or a result archive containing it.")
+        parser.add_argument(
+            "--quantile", type=float, default=0.999, help="Fraction of comparisons the suggested tolerance must cover."
+        )
+        parser.add_argument(
+            "--by-exponent",
+            metavar="OPCODE",
+            help="Print the maximum ULP distance of OPCODE by input sign and unbiased exponent.",
+        )
+        return parser.parse_args()
+
+    sys.exit(_main(_parse_args()))
@@ -0,0 +1,135 @@
+// Checks FloatMath::Log2 and FloatMath::Exp2 (src/float_math.cpp) against the host C library for every float input.
+//
+// Build and run on the host from the repository root:
+//
+//   c++ -O2 -std=c++17 -pthread -Isrc scripts/validate_float_math.cpp src/float_math.cpp -o validate_float_math
+//   ./validate_float_math
+//
+// The reference is the double precision log2 or exp2 of the input rounded to float, which is the correctly rounded
+// result for all but a vanishing number of inputs. Prints, for each function, how many results differ from the
+// reference and the largest difference in ULPs, and exits with a non-zero status if any result is more than 1 ULP away
+// or is not NaN where the reference is (or vice versa). Run it after regenerating the tables with
+// scripts/float_math_tables.py; it takes about a minute and a half per function on a single core.
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "float_math.h"
+
+namespace {
+
+struct Report {
+  uint64_t inexact = 0;
+  uint64_t max_ulps = 0;
+  uint32_t worst_input = 0;
+  uint64_t nan_mismatches = 0;
+  uint32_t first_nan_mismatch = 0;
+
+  void Merge(const Report &other) {
+    inexact += other.inexact;
+    if (other.max_ulps > max_ulps) {
+      max_ulps = other.max_ulps;
+      worst_input = other.worst_input;
+    }
+    if (other.nan_mismatches && !nan_mismatches) {
+      first_nan_mismatch = other.first_nan_mismatch;
+    }
+    nan_mismatches += other.nan_mismatches;
+  }
+};
+
+uint32_t BitsOf(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+float FloatOf(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Maps the bit pattern of a non-NaN float to an integer that is ordered like the float, with -0 and +0 adjacent.
+int64_t Ordinal(float value) {
+  uint32_t bits = BitsOf(value);
+  return (bits & 0x80000000) ? -static_cast<int64_t>(bits & 0x7FFFFFFF) - 1 : static_cast<int64_t>(bits);
+}
+
+template <typename Function, typename Reference>
+void Check(Function function, Reference reference, uint64_t begin, uint64_t end, Report *report) {
+  for (uint64_t input = begin; input < end; ++input) {
+    float x = FloatOf(static_cast<uint32_t>(input));
+    float actual = function(x);
+    auto expected = static_cast<float>(reference(static_cast<double>(x)));
+
+    if (std::isnan(actual) || std::isnan(expected)) {
+      if (std::isnan(actual) != std::isnan(expected)) {
+        if (!report->nan_mismatches) {
+          report->first_nan_mismatch = static_cast<uint32_t>(input);
+        }
+        ++report->nan_mismatches;
+      }
+      continue;
+    }
+
+    int64_t difference = Ordinal(actual) - Ordinal(expected);
+    auto ulps = static_cast<uint64_t>(difference < 0 ? -difference : difference);
+    if (!ulps) {
+      continue;
+    }
+    ++report->inexact;
+    if (ulps > report->max_ulps) {
+      report->max_ulps = ulps;
+      report->worst_input = static_cast<uint32_t>(input);
+    }
+  }
+}
+
+template <typename Function, typename Reference>
+bool Validate(const char *name, Function function, Reference reference) {
+  unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
+  constexpr uint64_t kNumInputs = 1ULL << 32;
+
+  std::vector<Report> reports(num_threads);
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < num_threads; ++i) {
+    uint64_t begin = kNumInputs * i / num_threads;
+    uint64_t end = kNumInputs * (i + 1) / num_threads;
+    threads.emplace_back(Check<Function, Reference>, function, reference, begin, end, &reports[i]);
+  }
+
+  Report total;
+  for (unsigned i = 0; i < num_threads; ++i) {
+    threads[i].join();
+    total.Merge(reports[i]);
+  }
+
+  printf("%s: %" PRIu64 " of %" PRIu64 " results differ from the reference, max %" PRIu64 " ULP", name, total.inexact,
+         kNumInputs, total.max_ulps);
+  if (total.max_ulps) {
+    float x = FloatOf(total.worst_input);
+    printf(" (input 0x%08X %a)", total.worst_input, static_cast<double>(x));
+  }
+  printf("\n");
+  if (total.nan_mismatches) {
+    printf("%s: %" PRIu64 " results disagree with the reference on NaN, first for input 0x%08X\n", name,
+           total.nan_mismatches, total.first_nan_mismatch);
+  }
+
+  return total.max_ulps <= 1 && !total.nan_mismatches;
+}
+
+}  // namespace
+
+int main() {
+  bool ok = Validate("Log2", FloatMath::Log2, [](double x) { return std::log2(x); });
+  ok = Validate("Exp2", FloatMath::Exp2, [](double x) { return std::exp2(x); }) && ok;
+  return ok ? 0 : 1;
+}
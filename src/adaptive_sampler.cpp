@@ -0,0 +1,92 @@
+#include "adaptive_sampler.h"
+
+#include "debug_output.h"
+
+AdaptiveSampler::AdaptiveSampler(uint32_t num_strata, uint32_t batch_size, uint32_t tolerance_ulps,
+                                 const Budget &budget)
+    : batch_size_(batch_size), budget_(budget), strata_(num_strata) {
+  ASSERT(num_strata && batch_size && "Sampler needs at least one stratum and one vector per batch");
+  ASSERT(budget.min_batches <= budget.max_batches && "Invalid sampling budget");
+
+  // Bucket k holds distances in [2^(k-1), 2^k - 1], so the tolerance itself falls in bucket `tolerance_bucket`.
+  const uint32_t tolerance_bucket = tolerance_ulps ? 32 - __builtin_clz(tolerance_ulps) : 0;
+  near_miss_bucket_ = tolerance_bucket > 1 ? tolerance_bucket - 1 : 1;
+  relaxed_bucket_ = tolerance_bucket > 2 ? tolerance_bucket - 2 : 0;
+  plan_.reserve(batch_size);
+}
+
+bool AdaptiveSampler::Done() const {
+  if (batches_ >= budget_.max_batches) {
+    return true;
+  }
+  if (batches_ < budget_.min_batches || mismatches_ || strata_covered_ < strata_.size()) {
+    return false;
+  }
+
+  const float target = max_bucket_ <= relaxed_bucket_ ? budget_.relaxed_mismatch_rate : budget_.target_mismatch_rate;
+  return 3.0f / static_cast<float>(samples_) <= target;
+}
+
+float AdaptiveSampler::ErrorRate(const StratumStats &stats) const {
+  if (!stats.samples) {
+    return 0.0f;
+  }
+  // Mismatches are what the run is looking for, near misses only hint at them.
+  return static_cast<float>(4 * stats.mismatches + stats.near_misses) / static_cast<float>(stats.samples);
+}
+
+const std::vector<uint32_t> &AdaptiveSampler::PlanBatch() {
+  ++batches_;
+  plan_.clear();
+
+  const uint32_t focus_slots = FoundErrors() ? batch_size_ / 2 : 0;
+  while (plan_.size() < batch_size_ - focus_slots) {
+    plan_.push_back(rotation_);
+    rotation_ = (rotation_ + 1) % strata_.size();
+  }
+
+  if (!focus_slots) {
+    return plan_;
+  }
+
+  // Apportion the remaining slots by error rate with the D'Hondt method, so that a single bad stratum does not take
+  // every slot from others that are also failing.
+  std::vector<uint32_t> allocated(strata_.size(), 0);
+  for (uint32_t slot = 0; slot < focus_slots; ++slot) {
+    uint32_t best = 0;
+    float best_quotient = -1.0f;
+    for (uint32_t i = 0; i < strata_.size(); ++i) {
+      const float quotient = ErrorRate(strata_[i]) / static_cast<float>(allocated[i] + 1);
+      if (quotient > best_quotient) {
+        best = i;
+        best_quotient = quotient;
+      }
+    }
+    ++allocated[best];
+    plan_.push_back(best);
+  }
+
+  return plan_;
+}
+
+void AdaptiveSampler::Record(uint32_t index, bool mismatch, uint32_t ulp_bucket) {
+  ASSERT(index < plan_.size() && "Result recorded outside of the planned batch");
+  auto &stats = strata_[plan_[index]];
+
+  if (!stats.samples) {
+    ++strata_covered_;
+  }
+  ++stats.samples;
+  ++samples_;
+
+  if (mismatch) {
+    ++stats.mismatches;
+    ++mismatches_;
+  } else if (ulp_bucket >= near_miss_bucket_) {
+    ++stats.near_misses;
+    ++near_misses_;
+  }
+  if (ulp_bucket > max_bucket_) {
+    max_bucket_ = ulp_bucket;
+  }
+}
@@ -0,0 +1,76 @@
+#ifndef NXDK_VSH_TESTS_ADAPTIVE_SAMPLER_H
+#define NXDK_VSH_TESTS_ADAPTIVE_SAMPLER_H
+
+#include <cstdint>
+#include <vector>
+
+//! Decides how many batches of random inputs an operation is tested with and which input strata (see
+//! StratifiedFloatGenerator) each batch concentrates on, based on the errors observed so far.
+//!
+//! Every batch assigns one stratum to each input vector. By default the strata are visited in rotation so that all of
+//! them are covered every ceil(strata / batch size) batches. Once a stratum produces a mismatch or a near miss (a
+//! result within a factor of two of the tolerance), half of each batch is instead given to the strata with the highest
+//! rate of such errors.
+//!
+//! After a mismatch, sampling continues up to the maximum number of batches. Otherwise, it stops after the minimum
+//! number of batches once every stratum has been covered and enough vectors have passed that the 95% upper confidence
+//! bound on the mismatch rate (3 / n, the "rule of three") is below the target. The target is relaxed when every error
+//! observed is at most a quarter of the tolerance.
+class AdaptiveSampler {
+ public:
+  struct Budget {
+    uint32_t min_batches;
+    uint32_t max_batches;
+    //! Mismatch rate that must be excluded with 95% confidence before stopping.
+    float target_mismatch_rate;
+    //! Target used when all observed errors are far within the tolerance.
+    float relaxed_mismatch_rate;
+  };
+
+ public:
+  AdaptiveSampler(uint32_t num_strata, uint32_t batch_size, uint32_t tolerance_ulps, const Budget &budget);
+
+  //! Returns true once no further batches should be run.
+  bool Done() const;
+
+  //! Starts the next batch and returns the stratum of each of its input vectors.
+  const std::vector<uint32_t> &PlanBatch();
+
+  //! Records the outcome of the `index`th input vector of the current batch. `ulp_bucket` is the largest
+  //! UlpHistogram::Bucket of the lanes of the result.
+  void Record(uint32_t index, bool mismatch, uint32_t ulp_bucket);
+
+  uint32_t Batches() const { return batches_; }
+
+  //! Returns true if any mismatch or near miss has been recorded.
+  bool FoundErrors() const { return mismatches_ || near_misses_; }
+
+ private:
+  struct StratumStats {
+    uint32_t samples{0};
+    uint32_t mismatches{0};
+    uint32_t near_misses{0};
+  };
+
+  //! Returns the weight of the stratum for concentrated sampling, 0 if it has not produced any errors.
+  float ErrorRate(const StratumStats &stats) const;
+
+ private:
+  uint32_t batch_size_;
+  Budget budget_;
+  // Buckets at or above which a result is a near miss, and at or below which it is far within the tolerance.
+  uint32_t near_miss_bucket_;
+  uint32_t relaxed_bucket_;
+
+  std::vector<StratumStats> strata_;
+  std::vector<uint32_t> plan_;
+  uint32_t batches_{0};
+  uint32_t rotation_{0};
+  uint32_t strata_covered_{0};
+  uint32_t samples_{0};
+  uint32_t mismatches_{0};
+  uint32_t near_misses_{0};
+  uint32_t max_bucket_{0};
+};
+
+#endif  // NXDK_VSH_TESTS_ADAPTIVE_SAMPLER_H
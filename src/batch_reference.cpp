@@ -0,0 +1,328 @@
+#include "batch_reference.h"
+
+#include <cmath>
+#include <cstring>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "debug_output.h"
+
+static constexpr uint32_t kComponents = 4;
+
+std::map<BatchReference::Kernel, bool> BatchReference::self_test_results_;
+
+// Values paired with one another at the start of the self test, chosen to exercise signed zeroes, infinities, NaN,
+// subnormals, overflow and ties.
+static constexpr uint32_t kSpecialValues[] = {
+    0x00000000, 0x80000000, 0x3F800000, 0xBF800000, 0x7F800000, 0xFF800000, 0x7FC00000, 0xFFC00000,
+    0x00000001, 0x80000001, 0x00800000, 0x7F7FFFFF, 0xFF7FFFFF, 0x3F000000, 0x40400000, 0x5F800000,
+};
+static constexpr uint32_t kNumSpecialValues = sizeof(kSpecialValues) / sizeof(kSpecialValues[0]);
+
+static bool same_result(const float *a, const float *b) {
+  for (uint32_t component = 0; component < kComponents; ++component) {
+    if (std::isnan(a[component]) && std::isnan(b[component])) {
+      continue;
+    }
+    if (memcmp(&a[component], &b[component], sizeof(float))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void BatchReference::Evaluate(uint32_t num_inputs, const std::list<std::vector<float>> &inputs,
+                              std::vector<float> &results) {
+  results.resize(inputs.size() * kComponents);
+  if (kernel_ && !SelfTest(num_inputs)) {
+    kernel_ = nullptr;
+  }
+
+  if (kernel_) {
+    EvaluateKernel(num_inputs, inputs, results);
+  } else {
+    EvaluateScalar(inputs, results);
+  }
+}
+
+void BatchReference::EvaluateScalar(const std::list<std::vector<float>> &inputs, std::vector<float> &results) const {
+  float *out = results.data();
+  for (auto &input : inputs) {
+    scalar_(out, input.data());
+    out += kComponents;
+  }
+}
+
+void BatchReference::EvaluateKernel(uint32_t num_inputs, const std::list<std::vector<float>> &inputs,
+                                    std::vector<float> &results) {
+  const auto count = static_cast<uint32_t>(inputs.size());
+  const uint32_t num_columns = num_inputs * kComponents;
+  input_columns_.resize(num_columns * count);
+  output_columns_.resize(kComponents * count);
+
+  const float *input_pointers[3 * kComponents];
+  float *output_pointers[kComponents];
+  ASSERT(num_columns <= sizeof(input_pointers) / sizeof(input_pointers[0]) && "Too many inputs");
+  for (uint32_t column = 0; column < num_columns; ++column) {
+    input_pointers[column] = &input_columns_[column * count];
+  }
+  for (uint32_t component = 0; component < kComponents; ++component) {
+    output_pointers[component] = &output_columns_[component * count];
+  }
+
+  uint32_t item = 0;
+  for (auto &input : inputs) {
+    ASSERT(input.size() == num_columns);
+    for (uint32_t column = 0; column < num_columns; ++column) {
+      input_columns_[column * count + item] = input[column];
+    }
+    ++item;
+  }
+
+  kernel_(input_pointers, output_pointers, count);
+
+  for (item = 0; item < count; ++item) {
+    for (uint32_t component = 0; component < kComponents; ++component) {
+      results[item * kComponents + component] = output_columns_[component * count + item];
+    }
+  }
+}
+
+bool BatchReference::SelfTest(uint32_t num_inputs) {
+  // Each kernel matches exactly one nv2a_vsh_cpu function, so the verdict can be keyed by the kernel alone.
+  auto verdict = self_test_results_.find(kernel_);
+  if (verdict != self_test_results_.end()) {
+    return verdict->second;
+  }
+
+  // The first items pair every special value with every other in the first two inputs, rotated per component so that
+  // the components of one item differ. The rest are random bit patterns from a fixed seed.
+  const uint32_t num_columns = num_inputs * kComponents;
+  std::list<std::vector<float>> inputs;
+  uint32_t state = 0x9E3779B9;
+  for (uint32_t item = 0; item < kSelfTestItems; ++item) {
+    std::vector<float> input(num_columns);
+    for (uint32_t column = 0; column < num_columns; ++column) {
+      uint32_t bits;
+      if (item < kNumSpecialValues * kNumSpecialValues) {
+        const uint32_t value = column < kComponents ? item % kNumSpecialValues : item / kNumSpecialValues;
+        bits = kSpecialValues[(value + column) % kNumSpecialValues];
+      } else {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        bits = state;
+      }
+      memcpy(&input[column], &bits, sizeof(bits));
+    }
+    inputs.emplace_back(std::move(input));
+  }
+
+  std::vector<float> kernel_results(kSelfTestItems * kComponents);
+  std::vector<float> scalar_results(kSelfTestItems * kComponents);
+  EvaluateKernel(num_inputs, inputs, kernel_results);
+  EvaluateScalar(inputs, scalar_results);
+
+  bool passed = true;
+  uint32_t item = 0;
+  for (auto &input : inputs) {
+    if (!same_result(&kernel_results[item * kComponents], &scalar_results[item * kComponents])) {
+      uint32_t bits;
+      memcpy(&bits, input.data(), sizeof(bits));
+      PrintMsg("Batch reference kernel disagrees with the scalar reference for input 0x%08X, disabling it\n", bits);
+      passed = false;
+      break;
+    }
+    ++item;
+  }
+
+  self_test_results_[kernel_] = passed;
+  return passed;
+}
+
+#ifdef __SSE__
+// Loads four items of `column` starting at `i`, padding past `count` with zeroes so that the remainder of a batch goes
+// through the same single precision SSE operations as the rest.
+static __m128 load(const float *column, uint32_t i, uint32_t count) {
+  if (i + 4 <= count) {
+    return _mm_loadu_ps(column + i);
+  }
+  float padded[4] = {};
+  memcpy(padded, column + i, (count - i) * sizeof(float));
+  return _mm_loadu_ps(padded);
+}
+
+static void store(float *column, uint32_t i, uint32_t count, __m128 value) {
+  if (i + 4 <= count) {
+    _mm_storeu_ps(column + i, value);
+    return;
+  }
+  float padded[4];
+  _mm_storeu_ps(padded, value);
+  memcpy(column + i, padded, (count - i) * sizeof(float));
+}
+#endif
+
+// Applies `op` to each component of two input columns. Where SSE is available `vector_op` processes four items at a
+// time, otherwise `op` processes one. Both must perform the same single precision operations as the scalar function.
+template <typename Op, typename VectorOp>
+static void binary_kernel(const float *const *inputs, float *const *outputs, uint32_t count, Op op,
+                          VectorOp vector_op) {
+  for (uint32_t component = 0; component < kComponents; ++component) {
+    const float *a = inputs[component];
+    const float *b = inputs[kComponents + component];
+    float *out = outputs[component];
+#ifdef __SSE__
+    (void)op;
+    for (uint32_t i = 0; i < count; i += 4) {
+      store(out, i, count, vector_op(load(a, i, count), load(b, i, count)));
+    }
+#else
+    (void)vector_op;
+    for (uint32_t i = 0; i < count; ++i) {
+      out[i] = op(a[i], b[i]);
+    }
+#endif
+  }
+}
+
+// Computes the dot product of the first `terms` components of the two inputs, accumulated in component order, adds the
+// w component of the second input if `homogeneous` and writes the sum to every output component.
+template <uint32_t terms, bool homogeneous>
+static void dot_kernel(const float *const *inputs, float *const *outputs, uint32_t count) {
+  const float *const *a = inputs;
+  const float *const *b = inputs + kComponents;
+#ifdef __SSE__
+  for (uint32_t i = 0; i < count; i += 4) {
+    __m128 sum = _mm_mul_ps(load(a[0], i, count), load(b[0], i, count));
+    for (uint32_t component = 1; component < terms; ++component) {
+      sum = _mm_add_ps(sum, _mm_mul_ps(load(a[component], i, count), load(b[component], i, count)));
+    }
+    if (homogeneous) {
+      sum = _mm_add_ps(sum, load(b[3], i, count));
+    }
+    for (uint32_t component = 0; component < kComponents; ++component) {
+      store(outputs[component], i, count, sum);
+    }
+  }
+#else
+  for (uint32_t i = 0; i < count; ++i) {
+    float sum = a[0][i] * b[0][i];
+    for (uint32_t component = 1; component < terms; ++component) {
+      float product = a[component][i] * b[component][i];
+      sum = sum + product;
+    }
+    if (homogeneous) {
+      sum = sum + b[3][i];
+    }
+    for (uint32_t component = 0; component < kComponents; ++component) {
+      outputs[component][i] = sum;
+    }
+  }
+#endif
+}
+
+#ifdef __SSE__
+#define VECTOR_OP(...) [](__m128 a, __m128 b) { return __VA_ARGS__; }
+#else
+#define VECTOR_OP(...) nullptr
+#endif
+
+void BatchReference::Add(const float *const *inputs, float *const *outputs, uint32_t count) {
+  binary_kernel(
+      inputs, outputs, count, [](float a, float b) { return a + b; }, VECTOR_OP(_mm_add_ps(a, b)));
+}
+
+void BatchReference::Mul(const float *const *inputs, float *const *outputs, uint32_t count) {
+  binary_kernel(
+      inputs, outputs, count, [](float a, float b) { return a * b; }, VECTOR_OP(_mm_mul_ps(a, b)));
+}
+
+// MINPS and MAXPS return their second operand unless the comparison with the first holds, so NaN in either input
+// yields `b`, and for equal inputs (e.g., +0 and -0) `b` is returned as well.
+void BatchReference::Min(const float *const *inputs, float *const *outputs, uint32_t count) {
+  binary_kernel(
+      inputs, outputs, count, [](float a, float b) { return a < b ? a : b; }, VECTOR_OP(_mm_min_ps(a, b)));
+}
+
+void BatchReference::Max(const float *const *inputs, float *const *outputs, uint32_t count) {
+  binary_kernel(
+      inputs, outputs, count, [](float a, float b) { return a > b ? a : b; }, VECTOR_OP(_mm_max_ps(a, b)));
+}
+
+// Comparisons with NaN are false, so SGE and SLT both yield 0 for NaN inputs.
+void BatchReference::Sge(const float *const *inputs, float *const *outputs, uint32_t count) {
+  binary_kernel(
+      inputs, outputs, count, [](float a, float b) { return a >= b ? 1.0f : 0.0f; },
+      VECTOR_OP(_mm_and_ps(_mm_cmpge_ps(a, b), _mm_set1_ps(1.0f))));
+}
+
+void BatchReference::Slt(const float *const *inputs, float *const *outputs, uint32_t count) {
+  binary_kernel(
+      inputs, outputs, count, [](float a, float b) { return a < b ? 1.0f : 0.0f; },
+      VECTOR_OP(_mm_and_ps(_mm_cmplt_ps(a, b), _mm_set1_ps(1.0f))));
+}
+
+#undef VECTOR_OP
+
+void BatchReference::Dp3(const float *const *inputs, float *const *outputs, uint32_t count) {
+  dot_kernel<3, false>(inputs, outputs, count);
+}
+
+void BatchReference::Dp4(const float *const *inputs, float *const *outputs, uint32_t count) {
+  dot_kernel<4, false>(inputs, outputs, count);
+}
+
+void BatchReference::Dph(const float *const *inputs, float *const *outputs, uint32_t count) {
+  dot_kernel<3, true>(inputs, outputs, count);
+}
+
+// The product is rounded to single precision before the addition, matching a multiply followed by an add rather than a
+// fused multiply-add.
+void BatchReference::Mad(const float *const *inputs, float *const *outputs, uint32_t count) {
+  for (uint32_t component = 0; component < kComponents; ++component) {
+    const float *a = inputs[component];
+    const float *b = inputs[kComponents + component];
+    const float *c = inputs[2 * kComponents + component];
+    float *out = outputs[component];
+#ifdef __SSE__
+    for (uint32_t i = 0; i < count; i += 4) {
+      __m128 product = _mm_mul_ps(load(a, i, count), load(b, i, count));
+      store(out, i, count, _mm_add_ps(product, load(c, i, count)));
+    }
+#else
+    for (uint32_t i = 0; i < count; ++i) {
+      float product = a[i] * b[i];
+      out[i] = product + c[i];
+    }
+#endif
+  }
+}
+
+// DST computes (1, a.y * b.y, a.z, b.w).
+void BatchReference::Dst(const float *const *inputs, float *const *outputs, uint32_t count) {
+  const float *a_y = inputs[1];
+  const float *b_y = inputs[kComponents + 1];
+#ifdef __SSE__
+  for (uint32_t i = 0; i < count; i += 4) {
+    store(outputs[1], i, count, _mm_mul_ps(load(a_y, i, count), load(b_y, i, count)));
+  }
+#else
+  for (uint32_t i = 0; i < count; ++i) {
+    outputs[1][i] = a_y[i] * b_y[i];
+  }
+#endif
+  for (uint32_t i = 0; i < count; ++i) {
+    outputs[0][i] = 1.0f;
+  }
+  memcpy(outputs[2], inputs[2], count * sizeof(float));
+  memcpy(outputs[3], inputs[kComponents + 3], count * sizeof(float));
+}
+
+void BatchReference::Mov(const float *const *inputs, float *const *outputs, uint32_t count) {
+  for (uint32_t component = 0; component < kComponents; ++component) {
+    memcpy(outputs[component], inputs[component], count * sizeof(float));
+  }
+}
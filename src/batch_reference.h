@@ -0,0 +1,77 @@
+#ifndef NXDK_VSH_TESTS_BATCH_REFERENCE_H
+#define NXDK_VSH_TESTS_BATCH_REFERENCE_H
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <vector>
+
+//! Evaluates a CPU reference operation over a whole batch of inputs at once.
+//!
+//! Operations are always available as a scalar function that computes the four component result for one set of inputs.
+//! Operations may additionally provide a kernel that works on a structure of arrays block, i.e., one array per
+//! component of each input and of the output, which lets it process four items at a time with SSE.
+//!
+//! A kernel must reproduce its scalar function bit for bit, except that any NaN matches any NaN as in the comparison
+//! with the GPU. As the scalar functions come from nv2a_vsh_cpu, each kernel is checked against its scalar function
+//! once per process, on first use, over kSelfTestItems generated inputs that pair special values with one another and
+//! then continue with random bit patterns. A kernel that disagrees is never used and its scalar function is used
+//! instead.
+class BatchReference {
+ public:
+  typedef std::function<void(float *, const float *)> ScalarOp;
+
+  //! Evaluates `count` items. `inputs[input * 4 + component]` and `outputs[component]` each point to `count` floats.
+  typedef void (*Kernel)(const float *const *inputs, float *const *outputs, uint32_t count);
+
+  static constexpr uint32_t kSelfTestItems = 4096;
+
+ public:
+  BatchReference(ScalarOp scalar, Kernel kernel = nullptr) : scalar_(std::move(scalar)), kernel_(kernel) {}
+  BatchReference(void (*scalar)(float *, const float *), Kernel kernel = nullptr)
+      : BatchReference(ScalarOp(scalar), kernel) {}
+
+  const ScalarOp &Scalar() const { return scalar_; }
+
+  //! Computes the result for each item of `inputs`, each of which holds `num_inputs` four component vectors, into
+  //! `results`, four floats per item.
+  void Evaluate(uint32_t num_inputs, const std::list<std::vector<float>> &inputs, std::vector<float> &results);
+
+  //! Kernels matching the nv2a_vsh_cpu function of the same name.
+  static void Add(const float *const *inputs, float *const *outputs, uint32_t count);
+  static void Dp3(const float *const *inputs, float *const *outputs, uint32_t count);
+  static void Dp4(const float *const *inputs, float *const *outputs, uint32_t count);
+  static void Dph(const float *const *inputs, float *const *outputs, uint32_t count);
+  static void Dst(const float *const *inputs, float *const *outputs, uint32_t count);
+  static void Mad(const float *const *inputs, float *const *outputs, uint32_t count);
+  static void Max(const float *const *inputs, float *const *outputs, uint32_t count);
+  static void Min(const float *const *inputs, float *const *outputs, uint32_t count);
+  static void Mov(const float *const *inputs, float *const *outputs, uint32_t count);
+  static void Mul(const float *const *inputs, float *const *outputs, uint32_t count);
+  static void Sge(const float *const *inputs, float *const *outputs, uint32_t count);
+  static void Slt(const float *const *inputs, float *const *outputs, uint32_t count);
+
+ private:
+  //! Computes `results` with the scalar function.
+  void EvaluateScalar(const std::list<std::vector<float>> &inputs, std::vector<float> &results) const;
+
+  //! Computes `results` with the kernel.
+  void EvaluateKernel(uint32_t num_inputs, const std::list<std::vector<float>> &inputs, std::vector<float> &results);
+
+  //! Returns true if the kernel reproduces the scalar function, running the self test on the first call in the process.
+  bool SelfTest(uint32_t num_inputs);
+
+ private:
+  ScalarOp scalar_;
+  Kernel kernel_;
+
+  // Structure of arrays storage, reused across batches.
+  std::vector<float> input_columns_;
+  std::vector<float> output_columns_;
+
+  //! Self test verdict of each kernel used so far.
+  static std::map<Kernel, bool> self_test_results_;
+};
+
+#endif  // NXDK_VSH_TESTS_BATCH_REFERENCE_H
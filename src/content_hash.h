@@ -0,0 +1,23 @@
+#ifndef NXDK_VSH_TESTS_CONTENT_HASH_H
+#define NXDK_VSH_TESTS_CONTENT_HASH_H
+
+#include <cstdint>
+
+//! Seed value for ContentHash.
+constexpr uint64_t kContentHashSeed = 0xCBF29CE484222325ULL;
+
+//! Folds `size` bytes into the given 64-bit FNV-1a hash.
+//!
+//! Used to fingerprint the inputs of a computation so that identical results can be deduplicated across runs.
+inline uint64_t ContentHash(const void *data, uint32_t size, uint64_t hash = kContentHashSeed) {
+  static constexpr uint64_t kFNVPrime = 0x100000001B3ULL;
+
+  auto bytes = static_cast<const uint8_t *>(data);
+  for (uint32_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= kFNVPrime;
+  }
+  return hash;
+}
+
+#endif  // NXDK_VSH_TESTS_CONTENT_HASH_H
@@ -0,0 +1,77 @@
+#include "counter_rng.h"
+
+#include <cstring>
+
+#include "content_hash.h"
+
+uint64_t CounterRng::run_seed_ = 0;
+
+static constexpr uint32_t kPhiloxM0 = 0xD2511F53;
+static constexpr uint32_t kPhiloxM1 = 0xCD9E8D57;
+static constexpr uint32_t kPhiloxW0 = 0x9E3779B9;
+static constexpr uint32_t kPhiloxW1 = 0xBB67AE85;
+static constexpr uint32_t kPhiloxRounds = 10;
+
+uint64_t CounterRng::StreamId(const std::string &suite, const std::string &name) {
+  // The separator keeps ("ab", "c") and ("a", "bc") apart.
+  auto hash = ContentHash(suite.c_str(), suite.size() + 1);
+  return ContentHash(name.c_str(), name.size(), hash);
+}
+
+void CounterRng::Philox(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]) {
+  uint32_t c0 = counter[0];
+  uint32_t c1 = counter[1];
+  uint32_t c2 = counter[2];
+  uint32_t c3 = counter[3];
+  uint32_t k0 = key[0];
+  uint32_t k1 = key[1];
+
+  for (uint32_t round = 0; round < kPhiloxRounds; ++round) {
+    const uint64_t product0 = static_cast<uint64_t>(kPhiloxM0) * c0;
+    const uint64_t product1 = static_cast<uint64_t>(kPhiloxM1) * c2;
+    c0 = static_cast<uint32_t>(product1 >> 32) ^ c1 ^ k0;
+    c1 = static_cast<uint32_t>(product1);
+    c2 = static_cast<uint32_t>(product0 >> 32) ^ c3 ^ k1;
+    c3 = static_cast<uint32_t>(product0);
+    k0 += kPhiloxW0;
+    k1 += kPhiloxW1;
+  }
+
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+}
+
+CounterRng::CounterRng(uint64_t stream, uint32_t batch) {
+  key_[0] = static_cast<uint32_t>(run_seed_);
+  key_[1] = static_cast<uint32_t>(run_seed_ >> 32);
+  counter_[1] = batch;
+  counter_[2] = static_cast<uint32_t>(stream);
+  counter_[3] = static_cast<uint32_t>(stream >> 32);
+  Seek(0);
+}
+
+uint32_t CounterRng::NextUint32() {
+  if (index_ == 4) {
+    ++counter_[0];
+    Refill();
+    index_ = 0;
+  }
+  return block_[index_++];
+}
+
+float CounterRng::NextBitsFloat() {
+  uint32_t bits = NextUint32();
+  float ret;
+  memcpy(&ret, &bits, sizeof(ret));
+  return ret;
+}
+
+void CounterRng::Seek(uint32_t position) {
+  counter_[0] = position / 4;
+  index_ = position % 4;
+  Refill();
+}
+
+void CounterRng::Refill() { Philox(counter_, key_, block_); }
@@ -0,0 +1,52 @@
+#ifndef NXDK_VSH_TESTS_COUNTER_RNG_H
+#define NXDK_VSH_TESTS_COUNTER_RNG_H
+
+#include <cstdint>
+#include <string>
+
+//! Counter-based random number generator (Philox4x32-10).
+//!
+//! Each 128-bit block of output is a pure function of the run seed, a stream id derived from a suite and a name (e.g.,
+//! a test or opcode), a batch index and the position within the batch. Any batch can therefore be regenerated on its
+//! own without replaying the ones before it, and the values a test sees do not depend on which tests ran first, so
+//! sharded, resumed and replayed runs with the same seed produce identical inputs.
+class CounterRng {
+ public:
+  //! Sets the seed that every stream of the run is derived from.
+  static void SetRunSeed(uint64_t seed) { run_seed_ = seed; }
+  static uint64_t RunSeed() { return run_seed_; }
+
+  //! Returns the id of the stream for `name` within `suite`.
+  static uint64_t StreamId(const std::string &suite, const std::string &name);
+
+  //! Computes one Philox4x32-10 block.
+  static void Philox(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]);
+
+  CounterRng(const std::string &suite, const std::string &name, uint32_t batch = 0)
+      : CounterRng(StreamId(suite, name), batch) {}
+  CounterRng(uint64_t stream, uint32_t batch);
+
+  uint32_t NextUint32();
+
+  //! Returns a float with uniformly random bits, including NaNs, infinities and subnormals.
+  float NextBitsFloat();
+
+  //! Moves to the given 0-based position within the batch.
+  void Seek(uint32_t position);
+  uint32_t Position() const { return counter_[0] * 4 + index_; }
+
+ private:
+  void Refill();
+
+ private:
+  static uint64_t run_seed_;
+
+  uint32_t key_[2];
+  // Block within the batch, batch index and stream id.
+  uint32_t counter_[4];
+  // Output of the current block and the index of the next word to return from it.
+  uint32_t block_[4];
+  uint32_t index_{0};
+};
+
+#endif  // NXDK_VSH_TESTS_COUNTER_RNG_H
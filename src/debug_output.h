@@ -14,7 +14,14 @@
 
 template <typename... VarArgs>
 inline void PrintMsg(const char *fmt, VarArgs &&...args) {
-  int string_length = snprintf_(nullptr, 0, fmt, args...);
+  // Format short messages on the stack so that logging does not allocate.
+  char stack_buf[256];
+  int string_length = snprintf_(stack_buf, sizeof(stack_buf), fmt, args...);
+  if (string_length < static_cast<int>(sizeof(stack_buf))) {
+    DbgPrint("%s", stack_buf);
+    return;
+  }
+
   std::string buf;
   buf.resize(string_length);
 
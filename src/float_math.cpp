@@ -0,0 +1,169 @@
+#include "float_math.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+static constexpr uint32_t kSignBit = 0x80000000;
+static constexpr uint32_t kPositiveInfinity = 0x7F800000;
+static constexpr uint32_t kMinNormal = 0x00800000;
+static constexpr uint32_t kExponentShift = 23;
+
+// Log2 splits the significand into 16 subintervals starting at kLog2Offset (about 0.7), so that the reduced argument
+// z / c - 1 stays small on both sides of 1.
+static constexpr uint32_t kLog2TableBits = 4;
+static constexpr uint32_t kLog2Offset = 0x3F330000;
+
+struct Log2Entry {
+  // 1 / c for the center c of the subinterval, a float so that z * inverse is exact in double precision.
+  double inverse;
+  // log2(c).
+  double log_c;
+};
+
+// Relative error of the log2(1 + r) / r polynomial: 2.41e-10
+static constexpr Log2Entry kLog2Table[] = {
+    {0x1.661ec80000000p+0, -0x1.efec674739402p-2},
+    {0x1.571ed40000000p+0, -0x1.b0b6804d30924p-2},
+    {0x1.4953a00000000p+0, -0x1.7418b4db0f9e4p-2},
+    {0x1.3c995c0000000p+0, -0x1.39de961bbfc39p-2},
+    {0x1.30d1900000000p+0, -0x1.01d9bb7350ffbp-2},
+    {0x1.25e2280000000p+0, -0x1.97c1d4d0c206ap-3},
+    {0x1.1bb4a40000000p+0, -0x1.2f9e32a7954e4p-3},
+    {0x1.1235900000000p+0, -0x1.960cd0c952063p-4},
+    {0x1.0953f40000000p+0, -0x1.a6f9d6f1d16afp-5},
+    {0x1.0000000000000p+0, 0x0.0p+0},
+    {0x1.e573ae0000000p-1, 0x1.3aa2ec545f082p-4},
+    {0x1.ca4b320000000p-1, 0x1.476a94dd5b49dp-3},
+    {0x1.b203660000000p-1, 0x1.e840b105841ecp-3},
+    {0x1.9c2d160000000p-1, 0x1.40645fdca7eb9p-2},
+    {0x1.886e600000000p-1, 0x1.88e9c392b7fbbp-2},
+    {0x1.767dd00000000p-1, 0x1.ce0a42495459dp-2},
+};
+// Coefficients of r to r^5.
+static constexpr double kLog2Poly[] = {
+    0x1.71547652b8301p+0,
+    -0x1.71547460d7949p-1,
+    0x1.ec709a6df1044p-2,
+    -0x1.7199adc4359bdp-2,
+    0x1.27b21a707c0a8p-2,
+};
+
+// Exp2 rounds x to a multiple of 1 / 32. kExp2Shift places that multiple in the low bits of a double.
+static constexpr uint32_t kExp2TableBits = 5;
+static constexpr double kExp2Shift = 0x1.8p+52 / (1 << kExp2TableBits);
+
+// Top 12 bits of 128.0f and of infinity, for the range check of Exp2.
+static constexpr uint32_t kExp2OverflowTop = 0x430;
+static constexpr uint32_t kInfinityTop = 0x7F8;
+
+// Relative error of the (2^r - 1) / r polynomial: 1.33e-08
+static constexpr uint64_t kExp2Table[] = {
+    0x3FF0000000000000, 0x3FEFD9B0D3158574, 0x3FEFB5586CF9890F, 0x3FEF9301D0125B51,
+    0x3FEF72B83C7D517B, 0x3FEF54873168B9AA, 0x3FEF387A6E756238, 0x3FEF1E9DF51FDEE1,
+    0x3FEF06FE0A31B715, 0x3FEEF1A7373AA9CB, 0x3FEEDEA64C123422, 0x3FEECE086061892D,
+    0x3FEEBFDAD5362A27, 0x3FEEB42B569D4F82, 0x3FEEAB07DD485429, 0x3FEEA47EB03A5585,
+    0x3FEEA09E667F3BCD, 0x3FEE9F75E8EC5F74, 0x3FEEA11473EB0187, 0x3FEEA589994CCE13,
+    0x3FEEACE5422AA0DB, 0x3FEEB737B0CDC5E5, 0x3FEEC49182A3F090, 0x3FEED503B23E255D,
+    0x3FEEE89F995AD3AD, 0x3FEEFF76F2FB5E47, 0x3FEF199BDD85529C, 0x3FEF3720DCEF9069,
+    0x3FEF5818DCFBA487, 0x3FEF7C97337B9B5F, 0x3FEFA4AFA2A490DA, 0x3FEFD0765B6E4540,
+};
+// Coefficients of r, r^2 and r^3.
+static constexpr double kExp2Poly[] = {
+    0x1.62e42fefa39efp-1,
+    0x1.ebfccc586302fp-3,
+    0x1.c6b110835b776p-5,
+};
+
+static uint32_t as_uint(float value) {
+  uint32_t ret;
+  memcpy(&ret, &value, sizeof(ret));
+  return ret;
+}
+
+static float as_float(uint32_t bits) {
+  float ret;
+  memcpy(&ret, &bits, sizeof(ret));
+  return ret;
+}
+
+static uint64_t as_uint64(double value) {
+  uint64_t ret;
+  memcpy(&ret, &value, sizeof(ret));
+  return ret;
+}
+
+static double as_double(uint64_t bits) {
+  double ret;
+  memcpy(&ret, &bits, sizeof(ret));
+  return ret;
+}
+
+float FloatMath::Log2(float x) {
+  uint32_t bits = as_uint(x);
+
+  // Anything other than a positive normal number.
+  if (bits - kMinNormal >= kPositiveInfinity - kMinNormal) {
+    if (!(bits << 1)) {
+      return -std::numeric_limits<float>::infinity();
+    }
+    if (bits == kPositiveInfinity) {
+      return x;
+    }
+    if ((bits << 1) > (kPositiveInfinity << 1)) {
+      return x;
+    }
+    if (bits & kSignBit) {
+      return std::numeric_limits<float>::quiet_NaN();
+    }
+    // Subnormals are scaled into the normal range.
+    bits = as_uint(x * 0x1p23f) - (23 << kExponentShift);
+  }
+
+  // Split x into 2^k * z with z in [kLog2Offset, 2 * kLog2Offset), where the top bits of z select the subinterval.
+  const uint32_t offset = bits - kLog2Offset;
+  const uint32_t index = (offset >> (kExponentShift - kLog2TableBits)) % (1 << kLog2TableBits);
+  const int32_t k = static_cast<int32_t>(offset) >> kExponentShift;
+  const double z = as_float(bits - (offset & 0xFF800000));
+
+  const Log2Entry &entry = kLog2Table[index];
+  const double r = z * entry.inverse - 1.0;
+  double poly = kLog2Poly[4];
+  poly = poly * r + kLog2Poly[3];
+  poly = poly * r + kLog2Poly[2];
+  poly = poly * r + kLog2Poly[1];
+  poly = poly * r + kLog2Poly[0];
+  return static_cast<float>(poly * r + (entry.log_c + k));
+}
+
+float FloatMath::Exp2(float x) {
+  const uint32_t top = (as_uint(x) >> 20) & 0x7FF;
+  if (top >= kExp2OverflowTop) {
+    if (as_uint(x) == (kSignBit | kPositiveInfinity)) {
+      return 0.0f;
+    }
+    if (top >= kInfinityTop) {
+      return x + x;
+    }
+    if (x > 0.0f) {
+      return std::numeric_limits<float>::infinity();
+    }
+    if (x <= -150.0f) {
+      return 0.0f;
+    }
+  }
+
+  // x = k / 32 + r with |r| <= 1 / 64. The rounded sum is read back from memory so that extended precision
+  // intermediates (i.e., on the x87) cannot make k and r disagree.
+  const double xd = x;
+  const uint64_t ki = as_uint64(xd + kExp2Shift);
+  const double kd = as_double(ki) - kExp2Shift;
+  const double r = xd - kd;
+
+  // 2^(k / 32) from the table entry for the low bits of k, with the high bits added to the exponent.
+  const double scale = as_double(kExp2Table[ki % (1 << kExp2TableBits)] + (ki << (52 - kExp2TableBits)));
+  double poly = kExp2Poly[2];
+  poly = poly * r + kExp2Poly[1];
+  poly = poly * r + kExp2Poly[0];
+  return static_cast<float>((poly * r + 1.0) * scale);
+}
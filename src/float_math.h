@@ -0,0 +1,20 @@
+#ifndef NXDK_VSH_TESTS_FLOAT_MATH_H
+#define NXDK_VSH_TESTS_FLOAT_MATH_H
+
+//! Self-contained single precision base 2 logarithm and exponential, for use where the C library lacks (or asserts in)
+//! log2f and exp2f, as nxdk does.
+//!
+//! Both reduce the argument with a small table and evaluate a polynomial in double precision, so their results are
+//! within 1 ULP of the correctly rounded result (in practice almost always exactly it) for every input, including
+//! subnormals. The main path is straight-line code on the bit pattern of the input with every special input handled by
+//! a single rarely taken branch. The tables and coefficients are generated by scripts/float_math_tables.py.
+class FloatMath {
+ public:
+  //! Returns log2(x): -inf for +/-0, +inf for +inf and NaN for negative inputs and NaN.
+  static float Log2(float x);
+
+  //! Returns 2^x: +inf if x >= 128, 0 if x <= -150 and NaN for NaN. Integral x gives exact powers of two.
+  static float Exp2(float x);
+};
+
+#endif  // NXDK_VSH_TESTS_FLOAT_MATH_H
@@ -0,0 +1,89 @@
+#include "gpu_watchdog.h"
+
+#include <pbkit/pbkit.h>
+#include <windows.h>
+
+#include "configure.h"
+#include "debug_output.h"
+#include "logger.h"
+#include "nxdk_ext.h"
+#include "pushbuffer.h"
+#include "trace_recorder.h"
+
+static bool pbkit_is_busy() { return pb_busy(); }
+
+static bool pbkit_try_finish() { return pb_finished(); }
+
+static void pbkit_read_dma_pointers(uint32_t &put, uint32_t &get) {
+  put = VIDEOREG(NV2A_PFIFO_CACHE1_DMA_PUT);
+  get = VIDEOREG(NV2A_PFIFO_CACHE1_DMA_GET);
+}
+
+static void pbkit_reset() {
+  pb_kill();
+  if (pb_init()) {
+    ASSERT(!"Failed to reinitialize pbkit after GPU hang");
+  }
+  pb_show_front_screen();
+}
+
+const GpuWatchdog::Backend GpuWatchdog::kPBKitBackend = {
+    pbkit_is_busy,
+    pbkit_try_finish,
+    pbkit_read_dma_pointers,
+    pbkit_reset,
+};
+
+const GpuWatchdog::Backend *GpuWatchdog::backend_ = &GpuWatchdog::kPBKitBackend;
+uint32_t GpuWatchdog::timeout_milliseconds_ = GpuWatchdog::kDefaultTimeoutMilliseconds;
+bool GpuWatchdog::fired_ = false;
+std::string GpuWatchdog::current_test_;
+
+bool GpuWatchdog::WaitForIdle(const char *location) { return Wait(backend_->is_busy, location); }
+
+bool GpuWatchdog::WaitForFlip(const char *location) { return Wait(backend_->try_finish, location); }
+
+void GpuWatchdog::SetCurrentTest(const std::string &suite, const std::string &test) {
+  current_test_ = suite + "::" + test;
+}
+
+const GpuWatchdog::Backend *GpuWatchdog::SetBackend(const Backend *backend) {
+  auto previous = backend_;
+  backend_ = backend ? backend : &kPBKitBackend;
+  return previous;
+}
+
+bool GpuWatchdog::Wait(bool (*condition)(), const char *location) {
+  if (!condition()) {
+    return true;
+  }
+
+  // Only waits that actually block are traced to keep the timeline readable.
+  TraceRecorder::Scope trace("gpu_wait", location);
+  const auto start = GetTickCount();
+  while (condition()) {
+    auto elapsed = GetTickCount() - start;
+    if (elapsed >= timeout_milliseconds_) {
+      Fire(location, elapsed);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void GpuWatchdog::Fire(const char *location, uint32_t elapsed) {
+  uint32_t put, get;
+  backend_->read_dma_pointers(put, get);
+
+  PrintMsg("WATCHDOG: %s hung in %s for %ums, DMA put 0x%08X get 0x%08X. Resetting GPU.\n", current_test_.c_str(),
+           location, elapsed, put, get);
+#ifdef ENABLE_PROGRESS_LOG
+  Logger::Log() << "  WATCHDOG " << current_test_ << " hung in " << location << " for " << elapsed
+                << "ms, DMA put 0x" << std::hex << put << " get 0x" << get << std::dec << std::endl;
+#endif
+
+  fired_ = true;
+  backend_->reset();
+  Pushbuffer::Discard();
+}
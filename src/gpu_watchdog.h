@@ -0,0 +1,63 @@
+#ifndef NXDK_VSH_TESTS_GPU_WATCHDOG_H
+#define NXDK_VSH_TESTS_GPU_WATCHDOG_H
+
+#include <cstdint>
+#include <string>
+
+//! Puts a deadline on every wait for the GPU so that a hung shader costs one test rather than the whole run.
+//!
+//! When a wait times out the watchdog records the test, the call site and the pushbuffer DMA pointers, then resets pbkit
+//! and returns false. TestHost stops submitting the rest of the batch and restores its render state. The test
+//! continues (its results are discarded rather than compared or saved) and TestSuite::Run restores the state again
+//! before the next test.
+class GpuWatchdog {
+ public:
+  //! Primitive GPU operations used by the watchdog. Replaced by tests to simulate hangs.
+  struct Backend {
+    //! Returns true while the GPU is still processing the pushbuffer (pb_busy).
+    bool (*is_busy)();
+    //! Attempts to queue a flip, returning true if it could not be queued yet (pb_finished).
+    bool (*try_finish)();
+    //! Reads the current DMA put and get addresses.
+    void (*read_dma_pointers)(uint32_t &put, uint32_t &get);
+    //! Tears down and reinitializes pbkit.
+    void (*reset)();
+  };
+
+  static constexpr uint32_t kDefaultTimeoutMilliseconds = 5000;
+
+ public:
+  //! Waits for the GPU to go idle. Returns false if the deadline expired and the GPU was reset.
+  static bool WaitForIdle(const char *location);
+
+  //! Waits for a pb_finished flip to be queued. Returns false if the deadline expired and the GPU was reset.
+  static bool WaitForFlip(const char *location);
+
+  //! Sets the name of the test that subsequent timeouts should be attributed to.
+  static void SetCurrentTest(const std::string &suite, const std::string &test);
+
+  //! Returns true if the watchdog fired since the last call to ClearFired.
+  static bool HasFired() { return fired_; }
+  static void ClearFired() { fired_ = false; }
+
+  static uint32_t Timeout() { return timeout_milliseconds_; }
+  static void SetTimeout(uint32_t milliseconds) { timeout_milliseconds_ = milliseconds; }
+
+  //! Replaces the backend, returning the previous one. Passing nullptr restores the pbkit backend.
+  static const Backend *SetBackend(const Backend *backend);
+
+  //! The pbkit backend used outside of tests.
+  static const Backend kPBKitBackend;
+
+ private:
+  static bool Wait(bool (*condition)(), const char *location);
+  static void Fire(const char *location, uint32_t elapsed);
+
+ private:
+  static const Backend *backend_;
+  static uint32_t timeout_milliseconds_;
+  static bool fired_;
+  static std::string current_test_;
+};
+
+#endif  // NXDK_VSH_TESTS_GPU_WATCHDOG_H
@@ -0,0 +1,208 @@
+#include "heap_tracker.h"
+
+#include <windows.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <new>
+
+#include "configure.h"
+#include "debug_output.h"
+
+HeapTracker *HeapTracker::singleton_ = nullptr;
+const char *HeapTracker::hot_path_location_ = nullptr;
+
+void HeapTracker::Initialize() {
+  ASSERT(!singleton_ && "Invalid attempt to initialize heap tracker twice.");
+
+  auto tracker = new HeapTracker();
+  tracker->thread_id_ = GetCurrentThreadId();
+  singleton_ = tracker;
+}
+
+void HeapTracker::BeginTest(const std::string &suite, const std::string &test) {
+  if (!singleton_) {
+    return;
+  }
+
+  singleton_->busy_ = true;
+  singleton_->current_suite_ = suite;
+  singleton_->current_test_ = test;
+  singleton_->current_ = TestCounters();
+  singleton_->current_.peak_live_bytes = singleton_->live_bytes_;
+  singleton_->busy_ = false;
+}
+
+void HeapTracker::EndTest() {
+  if (!singleton_ || singleton_->current_test_.empty()) {
+    return;
+  }
+
+  singleton_->busy_ = true;
+  singleton_->current_.runs = 1;
+  singleton_->totals_[singleton_->current_suite_][singleton_->current_test_].Add(singleton_->current_);
+
+#ifdef ENABLE_STRICT_HOT_PATH_ALLOCATIONS
+  // Checked once the test has finished so that every hot path allocation it makes has been logged.
+  uint32_t hot_path_allocations = 0;
+  for (auto &phase : singleton_->current_.phases) {
+    hot_path_allocations += phase.hot_path_allocations;
+  }
+  if (hot_path_allocations) {
+    PrintMsg("HEAP: %s::%s made %u hot path allocations\n", singleton_->current_suite_.c_str(),
+             singleton_->current_test_.c_str(), hot_path_allocations);
+    ASSERT(!"Heap allocation in hot path");
+  }
+#endif
+
+  singleton_->current_test_.clear();
+  singleton_->busy_ = false;
+}
+
+void HeapTracker::OnAllocate(size_t size) {
+  if (!singleton_ || singleton_->busy_ || GetCurrentThreadId() != singleton_->thread_id_) {
+    return;
+  }
+
+  singleton_->live_bytes_ += size;
+  if (singleton_->live_bytes_ > singleton_->current_.peak_live_bytes) {
+    singleton_->current_.peak_live_bytes = singleton_->live_bytes_;
+  }
+
+  auto &counters = singleton_->current_.phases[PhaseTimer::CurrentPhase()];
+  ++counters.allocations;
+  counters.bytes += size;
+
+  if (hot_path_location_) {
+    ++counters.hot_path_allocations;
+
+    // Report through the allocation-free path of PrintMsg and don't recurse if it allocates anyway.
+    singleton_->busy_ = true;
+    PrintMsg("HEAP: %u byte allocation in hot path %s during %s::%s (%s)\n", static_cast<uint32_t>(size),
+             hot_path_location_, singleton_->current_suite_.c_str(), singleton_->current_test_.c_str(),
+             PhaseTimer::PhaseName(PhaseTimer::CurrentPhase()));
+    singleton_->busy_ = false;
+  }
+}
+
+void HeapTracker::OnFree(size_t size) {
+  if (!singleton_ || singleton_->busy_ || GetCurrentThreadId() != singleton_->thread_id_) {
+    return;
+  }
+
+  singleton_->live_bytes_ -= size < singleton_->live_bytes_ ? size : singleton_->live_bytes_;
+  ++singleton_->current_.phases[PhaseTimer::CurrentPhase()].frees;
+}
+
+void HeapTracker::Counters::Add(const Counters &other) {
+  allocations += other.allocations;
+  bytes += other.bytes;
+  frees += other.frees;
+  hot_path_allocations += other.hot_path_allocations;
+}
+
+void HeapTracker::TestCounters::Add(const TestCounters &other) {
+  runs += other.runs;
+  if (other.peak_live_bytes > peak_live_bytes) {
+    peak_live_bytes = other.peak_live_bytes;
+  }
+  for (uint32_t i = 0; i <= PhaseTimer::PHASE_COUNT; ++i) {
+    phases[i].Add(other.phases[i]);
+  }
+}
+
+void HeapTracker::WriteCSV(const std::string &path) {
+  if (!singleton_) {
+    return;
+  }
+
+  singleton_->busy_ = true;
+
+  std::ofstream csv(path.c_str(), std::ios_base::out | std::ios_base::trunc);
+  if (!csv) {
+    PrintMsg("Failed to open heap tracking output %s\n", path.c_str());
+    singleton_->busy_ = false;
+    return;
+  }
+
+  auto write_rows = [&csv](const std::string &suite, const std::string &test, const TestCounters &counters) {
+    for (uint32_t i = 0; i <= PhaseTimer::PHASE_COUNT; ++i) {
+      auto &phase = counters.phases[i];
+      if (!phase.allocations && !phase.frees) {
+        continue;
+      }
+      csv << suite << "," << test << "," << counters.runs << "," << counters.peak_live_bytes << ","
+          << PhaseTimer::PhaseName(static_cast<PhaseTimer::Phase>(i)) << "," << phase.allocations << ","
+          << phase.bytes << "," << phase.frees << "," << phase.hot_path_allocations << "\n";
+    }
+  };
+
+  csv << "suite,test,runs,peak_live_bytes,phase,allocations,bytes,frees,hot_path_allocations" << std::endl;
+  for (auto &suite : singleton_->totals_) {
+    for (auto &test : suite.second) {
+      write_rows(suite.first, test.first, test.second);
+    }
+  }
+
+  for (auto &suite : singleton_->totals_) {
+    TestCounters suite_totals;
+    for (auto &test : suite.second) {
+      suite_totals.Add(test.second);
+    }
+    write_rows(suite.first, "*", suite_totals);
+  }
+
+  csv.close();
+  singleton_->busy_ = false;
+}
+
+#ifdef ENABLE_HEAP_TRACKING
+
+// Every block is prefixed with its size so that delete can report the bytes released. The header keeps the maximum
+// fundamental alignment.
+static constexpr size_t kHeaderSize = alignof(std::max_align_t);
+
+static void *tracked_allocate(size_t size) {
+  auto block = static_cast<uint8_t *>(malloc(size + kHeaderSize));
+  if (!block) {
+    return nullptr;
+  }
+
+  *reinterpret_cast<size_t *>(block) = size;
+  HeapTracker::OnAllocate(size);
+  return block + kHeaderSize;
+}
+
+static void tracked_free(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+
+  auto block = static_cast<uint8_t *>(ptr) - kHeaderSize;
+  HeapTracker::OnFree(*reinterpret_cast<size_t *>(block));
+  free(block);
+}
+
+void *operator new(size_t size) {
+  auto ret = tracked_allocate(size);
+  ASSERT(ret && "Out of memory");
+  return ret;
+}
+
+void *operator new[](size_t size) {
+  auto ret = tracked_allocate(size);
+  ASSERT(ret && "Out of memory");
+  return ret;
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return tracked_allocate(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return tracked_allocate(size); }
+
+void operator delete(void *ptr) noexcept { tracked_free(ptr); }
+void operator delete[](void *ptr) noexcept { tracked_free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { tracked_free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { tracked_free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { tracked_free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { tracked_free(ptr); }
+
+#endif  // ENABLE_HEAP_TRACKING
@@ -0,0 +1,83 @@
+#ifndef NXDK_VSH_TESTS_HEAP_TRACKER_H
+#define NXDK_VSH_TESTS_HEAP_TRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "phase_timer.h"
+
+//! Counts heap allocations made through operator new for each test and PhaseTimer phase.
+//!
+//! When built with ENABLE_HEAP_TRACKING the global operator new and delete are replaced so that every allocation made on
+//! the main thread is counted. Code marked with a HotPathScope (e.g., TestHost::Compute) is expected not to allocate at
+//! all: each allocation inside it is logged and counted as a hot path allocation and, with
+//! ENABLE_STRICT_HOT_PATH_ALLOCATIONS, the run halts at the end of any test that made one. Direct calls to malloc are
+//! not tracked.
+class HeapTracker {
+ public:
+  //! Marks code that must not allocate.
+  class HotPathScope {
+   public:
+    explicit HotPathScope(const char *location) : previous_(hot_path_location_) { hot_path_location_ = location; }
+    ~HotPathScope() { hot_path_location_ = previous_; }
+
+   private:
+    const char *previous_;
+  };
+
+ public:
+  //! Starts tracking allocations made by the calling thread.
+  static void Initialize();
+
+  static bool IsEnabled() { return singleton_ != nullptr; }
+
+  static void BeginTest(const std::string &suite, const std::string &test);
+  static void EndTest();
+
+  //! Writes one row per test and phase followed by one row per suite and phase (test "*").
+  static void WriteCSV(const std::string &path);
+
+  //! Called by the replacement operator new and delete.
+  static void OnAllocate(size_t size);
+  static void OnFree(size_t size);
+
+ private:
+  struct Counters {
+    uint32_t allocations{0};
+    uint64_t bytes{0};
+    uint32_t frees{0};
+    uint32_t hot_path_allocations{0};
+
+    void Add(const Counters &other);
+  };
+
+  struct TestCounters {
+    uint32_t runs{0};
+    uint64_t peak_live_bytes{0};
+    // Indexed by PhaseTimer::Phase, with PHASE_COUNT holding allocations outside of any phase.
+    Counters phases[PhaseTimer::PHASE_COUNT + 1];
+
+    void Add(const TestCounters &other);
+  };
+
+  HeapTracker() = default;
+
+ private:
+  uint32_t thread_id_{0};
+  // Set while the tracker itself allocates so that its bookkeeping is not counted.
+  bool busy_{false};
+
+  uint64_t live_bytes_{0};
+  std::string current_suite_;
+  std::string current_test_;
+  TestCounters current_;
+
+  std::map<std::string, std::map<std::string, TestCounters>> totals_;
+
+  static HeapTracker *singleton_;
+  static const char *hot_path_location_;
+};
+
+#endif  // NXDK_VSH_TESTS_HEAP_TRACKER_H
@@ -0,0 +1,140 @@
+#include "ilu_table_model.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "debug_output.h"
+
+static constexpr uint32_t kSignBit = 0x80000000;
+static constexpr uint32_t kMantissaMask = 0x007FFFFF;
+static constexpr uint32_t kExponentShift = 23;
+static constexpr int32_t kExponentBias = 127;
+
+// Reduced argument width of each function, see IluTableModel.
+static constexpr uint32_t kKeyBits[] = {23, 24};
+static constexpr char kOpcodes[][4] = {{'R', 'C', 'P', 0}, {'R', 'S', 'Q', 0}};
+
+// Fixed point scale of the coefficients, see IluTableModel.
+static constexpr uint32_t kCoefficientShift = 24;
+static constexpr uint32_t kConstantShift = 17;
+
+// Upper bound on segment_bits, to reject corrupt files before allocating.
+static constexpr uint32_t kMaxSegmentBits = 16;
+// Upper bound on the width of the offset within a segment, so that the quadratic term fits in 64 bits.
+static constexpr uint32_t kMaxOffsetBits = 16;
+
+bool IluTableModel::Load(const std::string &path) {
+  for (auto &table : tables_) {
+    table = Table();
+  }
+
+  std::ifstream file(path.c_str(), std::ios_base::in | std::ios_base::binary);
+  if (!file) {
+    PrintMsg("Failed to open ILU table %s\n", path.c_str());
+    return false;
+  }
+
+  auto read = [&file](void *data, uint32_t size) {
+    file.read(reinterpret_cast<char *>(data), size);
+    return static_cast<bool>(file);
+  };
+
+  uint32_t header[3];
+  if (!read(header, sizeof(header)) || header[0] != kMagic || header[1] != kVersion) {
+    PrintMsg("%s is not a version %u ILU table\n", path.c_str(), kVersion);
+    return false;
+  }
+
+  for (uint32_t i = 0; i < header[2]; ++i) {
+    char opcode[4];
+    uint32_t table_header[4];
+    if (!read(opcode, sizeof(opcode)) || !read(table_header, sizeof(table_header))) {
+      PrintMsg("ILU table %s is truncated\n", path.c_str());
+      return false;
+    }
+
+    uint32_t function = 0;
+    while (function < FUNCTION_COUNT && memcmp(opcode, kOpcodes[function], sizeof(opcode))) {
+      ++function;
+    }
+    const uint32_t key_bits = table_header[0];
+    const uint32_t segment_bits = table_header[1];
+    const uint32_t captured_keys = table_header[2];
+    if (function == FUNCTION_COUNT || key_bits != kKeyBits[function] || segment_bits > kMaxSegmentBits ||
+        segment_bits + kMaxOffsetBits < key_bits || captured_keys > (1u << key_bits)) {
+      PrintMsg("ILU table %s has an unsupported %.4s table\n", path.c_str(), opcode);
+      return false;
+    }
+
+    auto &table = tables_[function];
+    table.key_bits = key_bits;
+    table.segment_bits = segment_bits;
+    table.captured_keys = captured_keys;
+    table.segments.resize(1 << segment_bits);
+    table.exceptions.resize(table_header[3]);
+    if (!read(table.segments.data(), table.segments.size() * sizeof(Segment)) ||
+        !read(table.exceptions.data(), table.exceptions.size() * sizeof(Exception))) {
+      PrintMsg("ILU table %s is truncated\n", path.c_str());
+      table = Table();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int32_t IluTableModel::Significand(const Table &table, uint32_t key) {
+  auto exception = std::lower_bound(table.exceptions.begin(), table.exceptions.end(), key,
+                                    [](const Exception &entry, uint32_t value) { return entry.key < value; });
+  if (exception != table.exceptions.end() && exception->key == key) {
+    return exception->s;
+  }
+
+  const uint32_t offset_bits = table.key_bits - table.segment_bits;
+  const Segment &segment = table.segments[key >> offset_bits];
+  const int64_t d = key & ((1u << offset_bits) - 1);
+  // Right shifts of negative values round toward negative infinity, as they do in the fitting script.
+  const int64_t quadratic = (static_cast<int64_t>(segment.c2) * d * d) >> kCoefficientShift;
+  const int64_t sum = (static_cast<int64_t>(segment.c0) << kConstantShift) + segment.c1 * d + quadratic;
+  return static_cast<int32_t>(sum >> kCoefficientShift);
+}
+
+bool IluTableModel::Evaluate(Function function, float in, float &out) const {
+  const Table &table = tables_[function];
+  if (table.segments.empty()) {
+    return false;
+  }
+
+  uint32_t bits;
+  memcpy(&bits, &in, sizeof(bits));
+  const int32_t exponent = static_cast<int32_t>((bits >> kExponentShift) & 0xFF);
+  if (!exponent || exponent == 0xFF) {
+    return false;
+  }
+
+  // The significand of both results is in (0.5, 1], so the result exponent is that of the largest result below 1.
+  uint32_t key = bits & kMantissaMask;
+  int32_t result_exponent;
+  uint32_t sign = 0;
+  if (function == FUNCTION_RCP) {
+    result_exponent = 2 * kExponentBias - 1 - exponent;
+    sign = bits & kSignBit;
+  } else {
+    // The input is split into 2^(2 * half + parity) * (1 + mantissa); the sign is ignored.
+    const int32_t unbiased = exponent - kExponentBias;
+    const int32_t half = unbiased >> 1;
+    key |= static_cast<uint32_t>(unbiased & 1) << kExponentShift;
+    result_exponent = kExponentBias - 1 - half;
+  }
+
+  const int32_t s = Significand(table, key);
+  // Results that are not normal are left to the fallback, as is any significand that leaves the (0.5, 1] range.
+  if (result_exponent < 1 || result_exponent > 0xFD || s < 0 || s > static_cast<int32_t>(1 << kExponentShift)) {
+    return false;
+  }
+
+  const uint32_t result = sign | ((static_cast<uint32_t>(result_exponent) << kExponentShift) + s);
+  memcpy(&out, &result, sizeof(out));
+  return true;
+}
@@ -0,0 +1,88 @@
+#ifndef NXDK_VSH_TESTS_ILU_TABLE_MODEL_H
+#define NXDK_VSH_TESTS_ILU_TABLE_MODEL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! Reproduces the ILU reciprocal (RCP) and reciprocal square root (RSQ) bit for bit from tables fitted to hardware
+//! captures by scripts/fit_ilu_table.py.
+//!
+//! Both functions are evaluated on a reduced argument, the "key": the 23 mantissa bits of the input for RCP, and the
+//! mantissa plus the parity of the unbiased exponent for RSQ. The exponent of the result follows directly from the
+//! exponent of the input, so the table only has to model the significand `s` of the result, which is added to the
+//! result exponent with a carry into it when `s` reaches 2^23 (i.e., for a power of two). The key range is split into
+//! 2^segment_bits segments, each of which holds a quadratic in the offset `d` of the key from the start of the segment:
+//!
+//!   s = ((c0 << 17) + c1 * d + ((c2 * d * d) >> 24)) >> 24
+//!
+//! i.e., c0 has 7 fractional bits and c1 and c2 have 24 and 48. Offsets are at most 16 bits wide so that every term
+//! fits in 64 bits.
+//!
+//! Captured keys that the quadratic does not reproduce are stored as exceptions, so every captured input is exact. Keys
+//! that were not captured are only as exact as the quadratic, so each table records how many distinct keys were
+//! captured and is only Complete() if that is all of them. Zero, subnormal and non-finite inputs and results that would
+//! not be normal are outside of the model.
+//!
+//! File layout (all values are little endian):
+//!   uint32_t magic ("VSIT"), uint32_t version, uint32_t num_tables
+//!   { char opcode[4], uint32_t key_bits, uint32_t segment_bits, uint32_t captured_keys, uint32_t num_exceptions,
+//!     { int32_t c0, int32_t c1, int32_t c2 }[1 << segment_bits], { uint32_t key, int32_t s }[num_exceptions] }*
+//!
+//! Exceptions are sorted by key.
+class IluTableModel {
+ public:
+  static constexpr uint32_t kMagic = 0x54495356;  // "VSIT"
+  static constexpr uint32_t kVersion = 2;
+
+  enum Function {
+    FUNCTION_RCP,
+    FUNCTION_RSQ,
+    FUNCTION_COUNT,
+  };
+
+ public:
+  //! Loads the tables at the given path, replacing any loaded before. Returns false if the file is missing or invalid.
+  bool Load(const std::string &path);
+
+  //! Returns true if a table for the given function has been loaded.
+  bool Has(Function function) const { return !tables_[function].segments.empty(); }
+
+  //! Returns true if the table for the given function was fitted to captures of every key, so that it reproduces the
+  //! hardware for every input within the model.
+  bool Complete(Function function) const {
+    return Has(function) && tables_[function].captured_keys == 1u << tables_[function].key_bits;
+  }
+
+  //! Sets `out` to the modeled hardware result for `in`. Returns false if `in` is outside of the model, in which case
+  //! the caller should fall back to another reference.
+  bool Evaluate(Function function, float in, float &out) const;
+
+ private:
+  struct Segment {
+    int32_t c0;
+    int32_t c1;
+    int32_t c2;
+  };
+
+  struct Exception {
+    uint32_t key;
+    int32_t s;
+  };
+
+  struct Table {
+    uint32_t key_bits{0};
+    uint32_t segment_bits{0};
+    uint32_t captured_keys{0};
+    std::vector<Segment> segments;
+    std::vector<Exception> exceptions;
+  };
+
+  //! Returns the modeled significand for the given key.
+  static int32_t Significand(const Table &table, uint32_t key);
+
+ private:
+  Table tables_[FUNCTION_COUNT];
+};
+
+#endif  // NXDK_VSH_TESTS_ILU_TABLE_MODEL_H
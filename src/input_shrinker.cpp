@@ -0,0 +1,145 @@
+#include "input_shrinker.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "debug_output.h"
+
+static constexpr uint32_t kSignBit = 0x80000000;
+static constexpr uint32_t kExponentMask = 0x7F800000;
+static constexpr uint32_t kMantissaMask = 0x007FFFFF;
+static constexpr uint32_t kExponentShift = 23;
+static constexpr uint32_t kExponentBias = 127;
+
+static uint32_t as_uint(float value) {
+  uint32_t ret;
+  memcpy(&ret, &value, sizeof(ret));
+  return ret;
+}
+
+static float as_float(uint32_t bits) {
+  float ret;
+  memcpy(&ret, &bits, sizeof(ret));
+  return ret;
+}
+
+std::vector<float> InputShrinker::Shrink(const std::vector<float> &input) {
+  std::vector<float> current = input;
+  std::list<std::vector<float>> candidates;
+
+  for (rounds_ = 0; rounds_ < max_rounds_; ++rounds_) {
+    candidates.clear();
+    GenerateCandidates(current, candidates);
+    if (candidates.empty()) {
+      break;
+    }
+
+    auto failed = evaluate_(candidates);
+    ASSERT(failed.size() == candidates.size() && "Evaluator must return one result per candidate");
+    evaluations_ += candidates.size();
+
+    auto candidate = candidates.begin();
+    bool reduced = false;
+    for (auto still_fails : failed) {
+      if (still_fails) {
+        current = *candidate;
+        reduced = true;
+        break;
+      }
+      ++candidate;
+    }
+    if (!reduced) {
+      break;
+    }
+  }
+
+  return current;
+}
+
+void InputShrinker::GenerateCandidates(const std::vector<float> &input, std::list<std::vector<float>> &candidates) {
+  auto add = [&input, &candidates](uint32_t index, uint32_t bits) {
+    if (bits == as_uint(input[index])) {
+      return;
+    }
+    candidates.push_back(input);
+    candidates.back()[index] = as_float(bits);
+  };
+
+  // Every pass is tried for every component before moving on to a less aggressive one.
+  for (uint32_t i = 0; i < input.size(); ++i) {
+    if (input[i] != 0.0f || std::signbit(input[i])) {
+      add(i, 0);
+    }
+  }
+
+  for (uint32_t i = 0; i < input.size(); ++i) {
+    const uint32_t bits = as_uint(input[i]);
+    if (bits & ~kSignBit) {
+      add(i, (bits & kSignBit) | (kExponentBias << kExponentShift));
+    }
+  }
+
+  for (uint32_t i = 0; i < input.size(); ++i) {
+    const uint32_t bits = as_uint(input[i]);
+    const uint32_t exponent = (bits & kExponentMask) >> kExponentShift;
+    // Subnormals become the nearest normal power of two.
+    if (exponent != 0xFF && (bits & ~kSignBit)) {
+      add(i, (bits & kSignBit) | ((exponent ? exponent : 1) << kExponentShift));
+    }
+  }
+
+  for (uint32_t i = 0; i < input.size(); ++i) {
+    const uint32_t bits = as_uint(input[i]);
+    const uint32_t exponent = (bits & kExponentMask) >> kExponentShift;
+    if (exponent == 0xFF || exponent == kExponentBias || !(bits & ~kSignBit)) {
+      continue;
+    }
+    const uint32_t halved = exponent > kExponentBias ? kExponentBias + (exponent - kExponentBias) / 2
+                                                     : kExponentBias - (kExponentBias - exponent) / 2;
+    add(i, (bits & (kSignBit | kMantissaMask)) | (halved << kExponentShift));
+  }
+
+  for (uint32_t i = 0; i < input.size(); ++i) {
+    const uint32_t bits = as_uint(input[i]);
+    const uint32_t mantissa = bits & kMantissaMask;
+    if ((bits & kExponentMask) == kExponentMask || !mantissa) {
+      continue;
+    }
+    // Keep the upper half of the bits between the implicit leading one and the lowest set bit.
+    const uint32_t significant = kExponentShift - __builtin_ctz(mantissa);
+    const uint32_t keep = significant / 2;
+    const uint32_t truncated = mantissa & ~((1u << (kExponentShift - keep)) - 1);
+    // A subnormal whose only bits would be dropped is left to the zeroing pass.
+    if (truncated || (bits & kExponentMask)) {
+      add(i, (bits & ~kMantissaMask) | truncated);
+    }
+  }
+}
+
+std::string InputShrinker::FormatExplicitTest(const std::vector<float> &input) {
+  std::string ret = "{";
+  char buffer[32];
+  for (uint32_t i = 0; i < input.size(); ++i) {
+    if (i) {
+      ret += ", ";
+    }
+
+    const float value = input[i];
+    if (std::isnan(value)) {
+      ret += "NAN";
+    } else if (std::isinf(value)) {
+      ret += value < 0.0f ? "-INFINITY" : "INFINITY";
+    } else {
+      // 9 significant digits round-trip any float.
+      snprintf(buffer, sizeof(buffer), "%.9g", value);
+      ret += buffer;
+      if (!strpbrk(buffer, ".e")) {
+        ret += ".0";
+      }
+      ret += "f";
+    }
+  }
+  ret += "},";
+  return ret;
+}
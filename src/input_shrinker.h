@@ -0,0 +1,49 @@
+#ifndef NXDK_VSH_TESTS_INPUT_SHRINKER_H
+#define NXDK_VSH_TESTS_INPUT_SHRINKER_H
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <string>
+#include <vector>
+
+//! Reduces a failing input to a simpler one that still fails, in the manner of delta debugging.
+//!
+//! Each round generates every single-component simplification of the current input, from most to least aggressive:
+//! zeroing the component, replacing it with +/-1, clearing its mantissa, halving the distance of its exponent from
+//! 2^0 and dropping the lower half of its significant mantissa bits. All candidates of a round are evaluated together
+//! (i.e., in one batch on the GPU) and the first one that still fails becomes the current input. Shrinking ends when
+//! no candidate fails or after the maximum number of rounds. Every candidate is strictly simpler than its parent, so
+//! the process terminates.
+class InputShrinker {
+ public:
+  //! Evaluates each candidate input, returning true for those that still fail.
+  using Evaluator = std::function<std::vector<bool>(const std::list<std::vector<float>> &)>;
+
+  static constexpr uint32_t kDefaultMaxRounds = 64;
+
+ public:
+  explicit InputShrinker(Evaluator evaluate, uint32_t max_rounds = kDefaultMaxRounds)
+      : evaluate_(std::move(evaluate)), max_rounds_(max_rounds) {}
+
+  //! Returns the simplest failing variant of `input` that was found, which is `input` itself if nothing simpler fails.
+  std::vector<float> Shrink(const std::vector<float> &input);
+
+  uint32_t Rounds() const { return rounds_; }
+  uint32_t Evaluations() const { return evaluations_; }
+
+  //! Formats `input` as an entry for an `explicit_tests` list, e.g. "{1.0f, 0.0f, -2.5e-08f, 0.0f},".
+  static std::string FormatExplicitTest(const std::vector<float> &input);
+
+ private:
+  //! Appends every single-component simplification of `input` to `candidates`.
+  static void GenerateCandidates(const std::vector<float> &input, std::list<std::vector<float>> &candidates);
+
+ private:
+  Evaluator evaluate_;
+  uint32_t max_rounds_;
+  uint32_t rounds_{0};
+  uint32_t evaluations_{0};
+};
+
+#endif  // NXDK_VSH_TESTS_INPUT_SHRINKER_H
@@ -12,28 +12,43 @@
 #include <windows.h>
 
 #include <algorithm>
+#include <cstdlib>
 #include <fstream>
 #include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
-#include "SDL_test_fuzzer.h"
+#include "configure.h"
+#include "counter_rng.h"
 #include "debug_output.h"
+#include "heap_tracker.h"
 #include "logger.h"
+#include "progress_journal.h"
 #include "pbkit_sdl_gpu.h"
+#include "phase_timer.h"
 #include "pushbuffer.h"
+#include "pushbuffer_stats.h"
+#include "result_archive.h"
+#include "result_uploader.h"
+#include "run_planner.h"
+#include "runtime_history.h"
 #include "test_driver.h"
 #include "test_host.h"
+#include "test_sharder.h"
+#include "trace_recorder.h"
 #include "tests/americasarmyshader.h"
 #include "tests/cpu_shader_tests.h"
 #include "tests/exceptional_float_tests.h"
+#include "tests/harness_benchmarks.h"
+#include "tests/ilu_characterization_tests.h"
 #include "tests/ilu_rcp_tests.h"
 #include "tests/mac_add_tests.h"
 #include "tests/mac_mov_tests.h"
 #include "tests/paired_ilu_tests.h"
 #include "tests/spyvsspymenu.h"
 #include "tests/vertex_data_array_format_tests.h"
+#include "tests/watchdog_tests.h"
 #include "text_overlay.h"
 
 #ifndef FALLBACK_OUTPUT_ROOT_PATH
@@ -44,6 +59,33 @@ static constexpr uint32_t kTextInsetX = 10;
 static constexpr uint32_t kTextInsetY = 20;
 
 static constexpr const char* kLogFileName = "log.txt";
+static constexpr const char* kProgressJournalFileName = "progress.journal";
+static constexpr const char* kResultArchiveFileName = "results.vsharc";
+static constexpr const char* kPhaseTimingFileName = "phase_timing.csv";
+static constexpr const char* kTraceFileName = "trace.json";
+static constexpr const char* kPushbufferStatsFileName = "pushbuffer_stats.csv";
+static constexpr const char* kHeapStatsFileName = "heap_stats.csv";
+static constexpr const char* kDryRunReportFileName = "dry_run.csv";
+static constexpr const char* kRuntimeHistoryFileName = "runtime_history.csv";
+// Historical test durations used to balance shards, see scripts/shard_durations.py.
+static constexpr const char* kDefaultShardDurationsPath = "D:\\test_durations.txt";
+
+struct RuntimeConfig {
+  // Map of suite name to the names of tests within that suite that should be disabled.
+  std::map<std::string, std::vector<std::string>> test_config;
+
+  // 1-based index of the shard to run, 0 if sharding is disabled.
+  uint32_t shard_index{0};
+  uint32_t shard_count{0};
+  std::string shard_durations_path{kDefaultShardDurationsPath};
+
+  // Count the work each test would submit instead of running it, see RunPlanner.
+  bool dry_run{false};
+
+  // Seed of the random test inputs, see CounterRng. Taken from the clock unless set by the config file.
+  bool has_seed{false};
+  uint64_t seed{0};
+};
 
 static void register_suites(TestHost& host, std::vector<std::shared_ptr<TestSuite>>& test_suites,
                             const std::string& output_directory);
@@ -51,7 +93,8 @@ static bool get_writable_output_directory(std::string& xbe_root_directory);
 static bool get_test_output_path(std::string& test_output_directory);
 static void dump_config_file(const std::string& config_file_path,
                              const std::vector<std::shared_ptr<TestSuite>>& test_suites);
-static void process_config(const char* config_file_path, std::vector<std::shared_ptr<TestSuite>>& test_suites);
+static void load_config(const char* config_file_path, RuntimeConfig& config);
+static void apply_config(const RuntimeConfig& config, std::vector<std::shared_ptr<TestSuite>>& test_suites);
 
 extern "C" __cdecl int automount_d_drive(void);
 
@@ -104,6 +147,24 @@ int main() {
     return 1;
   };
 
+  RuntimeConfig config;
+  TestSharder::ParsePath(std::string(XeImageFileName->Buffer, XeImageFileName->Length), config.shard_index,
+                         config.shard_count);
+#ifdef RUNTIME_CONFIG_PATH
+  load_config(RUNTIME_CONFIG_PATH, config);
+#endif
+
+  std::unique_ptr<TestSharder> sharder;
+  if (config.shard_count > 1) {
+    sharder = std::make_unique<TestSharder>(config.shard_index, config.shard_count);
+    sharder->LoadDurations(config.shard_durations_path);
+    test_output_directory += "\\" + sharder->FolderName();
+  }
+  if (config.dry_run) {
+    // Keep the journal and log of the dry run away from those of real runs, whose durations feed the estimates.
+    test_output_directory += "\\dry_run";
+  }
+
   pb_show_front_screen();
   debugClearScreen();
 
@@ -111,12 +172,19 @@ int main() {
                       kFramebufferHeight - 2 * kTextInsetY, kTextInsetX, kTextInsetY);
   GPU_Flip(gpu_target);
 
-  {
+  if (!config.has_seed) {
     auto now = std::chrono::high_resolution_clock::now();
-    auto seed = std::chrono::time_point_cast<std::chrono::milliseconds>(now).time_since_epoch().count();
-    SDLTest_FuzzerInit(seed);
+    config.seed = std::chrono::time_point_cast<std::chrono::milliseconds>(now).time_since_epoch().count();
   }
+  CounterRng::SetRunSeed(config.seed);
+  PrintMsg("Run seed 0x%llX\n", config.seed);
+  // TestHost and the shader programs submit through the Pushbuffer singleton.
+  Pushbuffer::Initialize();
   TestHost host;
+  if (config.dry_run) {
+    host.SetDryRun();
+    RunPlanner::Initialize(config.shard_durations_path);
+  }
 
   std::vector<std::shared_ptr<TestSuite>> test_suites;
   register_suites(host, test_suites, test_output_directory);
@@ -124,26 +192,136 @@ int main() {
   TestHost::EnsureFolderExists(test_output_directory);
 
 #ifdef ENABLE_PROGRESS_LOG
+  ProgressJournal::Initialize(test_output_directory + "\\" + kProgressJournalFileName);
   {
+    // Keep appending to the log of an interrupted run that is being resumed.
+    bool resuming = ProgressJournal::IsResuming();
     std::string log_file = test_output_directory + "\\" + kLogFileName;
-    DeleteFile(log_file.c_str());
+    if (!resuming) {
+      DeleteFile(log_file.c_str());
+    }
 
-    Logger::Initialize(log_file, true);
+    Logger::Initialize(log_file, !resuming);
+    if (resuming) {
+      Logger::Log() << "Resuming interrupted run, attempt " << ProgressJournal::Attempt() << std::endl;
+    }
+    Logger::Log() << "Run seed 0x" << std::hex << std::uppercase << config.seed << std::dec << std::nouppercase
+                  << std::endl;
   }
 #endif
 
-#ifdef DUMP_CONFIG_FILE
-  dump_config_file(test_output_directory + "\\config.cnf", test_suites);
+#ifdef ENABLE_RESULT_ARCHIVE
+  {
+    // Each attempt of a resumed run writes its own archive, see `result_archive.py merge`.
+    std::string archive_file = kResultArchiveFileName;
+    if (ProgressJournal::IsResuming()) {
+      archive_file = "results_attempt" + std::to_string(ProgressJournal::Attempt()) + ".vsharc";
+    }
+    ResultArchive::Initialize(test_output_directory + "\\" + archive_file);
+  }
 #endif
 
-#ifdef RUNTIME_CONFIG_PATH
-  process_config(RUNTIME_CONFIG_PATH, test_suites);
+#ifdef ENABLE_PHASE_TIMING
+  PhaseTimer::Initialize();
 #endif
 
-  Pushbuffer::Initialize();
+#ifdef ENABLE_RUNTIME_HISTORY
+  // Dry runs do not execute the tests, so their timings would only pollute the history.
+  if (!config.dry_run) {
+    RuntimeHistory::Initialize(test_output_directory + "\\" + kRuntimeHistoryFileName, BUILD_ID);
+  }
+#endif
+
+#ifdef ENABLE_PUSHBUFFER_STATS
+  PushbufferStats::Initialize();
+#endif
+
+#ifdef ENABLE_HEAP_TRACKING
+  HeapTracker::Initialize();
+#endif
+
+#ifdef ENABLE_TRACE_EXPORT
+  TraceRecorder::Initialize(test_output_directory + "\\" + kTraceFileName);
+#endif
+
+#ifdef ENABLE_FTP_UPLOAD
+  ResultUploader::Initialize({FTP_SERVER_IP, FTP_SERVER_PORT, FTP_USER, FTP_PASSWORD, FTP_REMOTE_PATH});
+#endif
+
+#ifdef DUMP_CONFIG_FILE
+  dump_config_file(test_output_directory + "\\config.cnf", test_suites);
+#endif
+
+  apply_config(config, test_suites);
+  if (sharder) {
+    sharder->Apply(test_suites);
+  }
+  ProgressJournal::SkipFinishedTests(test_suites);
 
   TestDriver driver(host, test_suites, kFramebufferWidth, kFramebufferHeight);
-  driver.Run();
+  if (config.dry_run) {
+    driver.RunAllTestsNonInteractive();
+  } else {
+    driver.Run();
+  }
+  ProgressJournal::Finish();
+
+  bool history_recorded = RuntimeHistory::IsEnabled();
+  RuntimeHistory::Close();
+
+  if (RunPlanner::IsEnabled()) {
+    RunPlanner::WriteReport(test_output_directory + "\\" + kDryRunReportFileName);
+  }
+
+  if (PhaseTimer::IsEnabled()) {
+    PhaseTimer::WriteCSV(test_output_directory + "\\" + kPhaseTimingFileName);
+  }
+
+  if (PushbufferStats::IsEnabled()) {
+    PushbufferStats::WriteCSV(test_output_directory + "\\" + kPushbufferStatsFileName);
+  }
+
+  if (HeapTracker::IsEnabled()) {
+    HeapTracker::WriteCSV(test_output_directory + "\\" + kHeapStatsFileName);
+  }
+
+  bool trace_recorded = TraceRecorder::IsEnabled();
+  TraceRecorder::Close();
+
+  if (ResultArchive::IsEnabled()) {
+#ifdef ENABLE_PROGRESS_LOG
+    Logger::Log().flush();
+    ResultArchive::AppendFile(ResultArchive::PAYLOAD_LOG, "", kLogFileName,
+                              test_output_directory + "\\" + kLogFileName);
+#endif
+    if (PhaseTimer::IsEnabled()) {
+      ResultArchive::AppendFile(ResultArchive::PAYLOAD_LOG, "", kPhaseTimingFileName,
+                                test_output_directory + "\\" + kPhaseTimingFileName);
+    }
+    if (PushbufferStats::IsEnabled()) {
+      ResultArchive::AppendFile(ResultArchive::PAYLOAD_LOG, "", kPushbufferStatsFileName,
+                                test_output_directory + "\\" + kPushbufferStatsFileName);
+    }
+    if (HeapTracker::IsEnabled()) {
+      ResultArchive::AppendFile(ResultArchive::PAYLOAD_LOG, "", kHeapStatsFileName,
+                                test_output_directory + "\\" + kHeapStatsFileName);
+    }
+    if (history_recorded) {
+      ResultArchive::AppendFile(ResultArchive::PAYLOAD_LOG, "", kRuntimeHistoryFileName,
+                                test_output_directory + "\\" + kRuntimeHistoryFileName);
+    }
+    if (RunPlanner::IsEnabled()) {
+      ResultArchive::AppendFile(ResultArchive::PAYLOAD_LOG, "", kDryRunReportFileName,
+                                test_output_directory + "\\" + kDryRunReportFileName);
+    }
+    if (trace_recorded) {
+      ResultArchive::AppendFile(ResultArchive::PAYLOAD_LOG, "", kTraceFileName,
+                                test_output_directory + "\\" + kTraceFileName);
+    }
+    ResultArchive::Close();
+  }
+
+  ResultUploader::Close();
 
 #ifdef ENABLE_SHUTDOWN
   HalInitiateShutdown();
@@ -224,6 +402,16 @@ static void dump_config_file(const std::string& config_file_path,
   config_file << "# To disable a single test within a suite, add the name of the test prefixed with" << std::endl;
   config_file << "#  a '-' after the uncommented suite. E.g.," << std::endl;
   config_file << "# -NoNormal" << std::endl;
+  config_file << "# To run only one shard of the enabled tests (e.g., when splitting a run across consoles), add" << std::endl;
+  config_file << "# !shard <index>/<count>" << std::endl;
+  config_file << "# Shards are balanced using the durations in " << kDefaultShardDurationsPath << " unless overridden via"
+              << std::endl;
+  config_file << "# !durations <path>" << std::endl;
+  config_file << "# To estimate the cost of the enabled tests without submitting any computations, add" << std::endl;
+  config_file << "# !dry_run" << std::endl;
+  config_file << "# To replay the random inputs of a previous run, add the seed it logged (decimal or 0x-prefixed hex)"
+              << std::endl;
+  config_file << "# !seed <value>" << std::endl;
   config_file << std::endl;
 
   for (auto& suite : test_suites) {
@@ -235,19 +423,24 @@ static void dump_config_file(const std::string& config_file_path,
   }
 }
 
-static void process_config(const char* config_file_path, std::vector<std::shared_ptr<TestSuite>>& test_suites) {
+static void load_config(const char* config_file_path, RuntimeConfig& config) {
   if (!ensure_drive_mounted(config_file_path[0])) {
     ASSERT(!"Failed to mount config path")
   }
 
   std::string dos_style_path = config_file_path;
   std::replace(dos_style_path.begin(), dos_style_path.end(), '/', '\\');
-  std::map<std::string, std::vector<std::string>> test_config;
   std::ifstream config_file(dos_style_path.c_str());
   ASSERT(config_file && "Failed to open config file");
 
   // The config file is a list of test suite names (one per line), each optionally followed by lines containing a test
   // name prefixed with '-' (indicating that test should be disabled).
+  //
+  // Lines starting with '!' are directives:
+  //   !shard <index>/<count> - Only run the 1-based <index>th of <count> shards of the enabled tests.
+  //   !durations <path> - Historical test durations used to balance shards.
+  //   !dry_run - Write a cost report for the enabled tests instead of running them.
+  //   !seed <value> - Seed for the random test inputs (decimal or 0x-prefixed hex), to replay a previous run.
   std::string last_test_suite;
   std::string line;
   while (std::getline(config_file, line)) {
@@ -256,26 +449,52 @@ static void process_config(const char* config_file_path, std::vector<std::shared
     }
     if (line.front() == '-') {
       line.erase(0, 1);
-      test_config[last_test_suite].push_back(line);
+      config.test_config[last_test_suite].push_back(line);
       continue;
     }
     if (line.front() == '#') {
       continue;
     }
+    if (line.front() == '!') {
+      auto separator = line.find(' ');
+      auto directive = line.substr(1, separator - 1);
+      auto value = separator == std::string::npos ? std::string() : line.substr(separator + 1);
+      if (directive == "shard") {
+        if (!TestSharder::ParseSpec(value, config.shard_index, config.shard_count)) {
+          ASSERT(!"Invalid !shard directive in config file");
+        }
+      } else if (directive == "durations") {
+        config.shard_durations_path = value;
+      } else if (directive == "dry_run") {
+        config.dry_run = true;
+      } else if (directive == "seed") {
+        char* end = nullptr;
+        config.seed = strtoull(value.c_str(), &end, 0);
+        if (value.empty() || *end) {
+          ASSERT(!"Invalid !seed directive in config file");
+        }
+        config.has_seed = true;
+      } else {
+        ASSERT(!"Unknown directive in config file");
+      }
+      continue;
+    }
 
-    test_config[line] = {};
+    config.test_config[line] = {};
     last_test_suite = line;
   }
+}
 
+static void apply_config(const RuntimeConfig& config, std::vector<std::shared_ptr<TestSuite>>& test_suites) {
   std::vector<std::shared_ptr<TestSuite>> filtered_tests;
   for (auto& suite : test_suites) {
-    auto config = test_config.find(suite->Name());
-    if (config == test_config.end()) {
+    auto suite_config = config.test_config.find(suite->Name());
+    if (suite_config == config.test_config.end()) {
       continue;
     }
 
-    if (!config->second.empty()) {
-      suite->DisableTests(config->second);
+    if (!suite_config->second.empty()) {
+      suite->DisableTests(suite_config->second);
     }
     filtered_tests.push_back(suite);
   }
@@ -300,12 +519,21 @@ static void register_suites(TestHost& host, std::vector<std::shared_ptr<TestSuit
   REG_TEST(Americasarmyshader)
   REG_TEST(CpuShaderTests)
   REG_TEST(ExceptionalFloatTests)
+#ifdef ENABLE_HARNESS_BENCHMARKS
+  REG_TEST(HarnessBenchmarks)
+#endif
+#ifdef ENABLE_ILU_CHARACTERIZATION
+  REG_TEST(IluCharacterizationTests)
+#endif
   REG_TEST(IluRcpTests)
   REG_TEST(MACMovTests)
   REG_TEST(MacAddTests)
   REG_TEST(PairedIluTests)
   REG_TEST(Spyvsspymenu)
   REG_TEST(VertexDataArrayFormatTests)
+#ifdef ENABLE_WATCHDOG_TESTS
+  REG_TEST(WatchdogTests)
+#endif
 
     // -- End REG_TEST --
 
@@ -5,6 +5,7 @@
 #include <chrono>
 #include <utility>
 
+#include "gpu_watchdog.h"
 #include "pbkit_ext.h"
 #include "tests/test_suite.h"
 #include "text_overlay.h"
@@ -43,8 +44,7 @@ void MenuItem::PrepareDraw(uint32_t background_color) const {
 
 void MenuItem::Swap() {
   TextOverlay::Render();
-  while (pb_finished()) {
-  }
+  GpuWatchdog::WaitForFlip(__func__);
 }
 
 void MenuItem::Draw() {
@@ -0,0 +1,84 @@
+#include "mismatch_log.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "debug_output.h"
+
+MismatchLog::MismatchLog(const std::string &path, bool append) {
+  if (append) {
+    // Only append to a log of this version, anything else is replaced.
+    std::ifstream existing(path.c_str(), std::ios_base::in | std::ios_base::binary);
+    uint32_t header[2] = {0, 0};
+    existing.read(reinterpret_cast<char *>(header), sizeof(header));
+    append = existing && header[0] == kMagic && header[1] == kVersion;
+  }
+
+  auto mode = std::ios_base::out | std::ios_base::binary | (append ? std::ios_base::app : std::ios_base::trunc);
+  log_.open(path.c_str(), mode);
+  ASSERT(log_ && "Failed to open mismatch log for output");
+
+  if (!append) {
+    const uint32_t header[] = {kMagic, kVersion};
+    Write(header, sizeof(header));
+    Flush();
+  }
+}
+
+void MismatchLog::Flush() {
+  if (pending_.empty()) {
+    return;
+  }
+  log_.write(pending_.data(), static_cast<std::streamsize>(pending_.size()));
+  log_.flush();
+  pending_.clear();
+}
+
+void MismatchLog::Record(const char *opcode, uint32_t num_inputs, const float *inputs, const float *hw_result,
+                         const float *cpu_result) {
+  char tag[4] = {0};
+  strncpy(tag, opcode, sizeof(tag));
+  Write(tag, sizeof(tag));
+  Write(&num_inputs, sizeof(num_inputs));
+  Write(inputs, num_inputs * 4 * sizeof(float));
+  Write(hw_result, 4 * sizeof(float));
+  Write(cpu_result, 4 * sizeof(float));
+}
+
+void MismatchLog::Count(const char *opcode, uint32_t tests, uint32_t mismatches) {
+  auto &counts = summary_[opcode];
+  counts.tests += tests;
+  counts.mismatches += mismatches;
+}
+
+void MismatchLog::WriteSummary(const std::string &path) const {
+  std::ofstream csv(path.c_str(), std::ios_base::out | std::ios_base::trunc);
+  if (!csv) {
+    PrintMsg("Failed to open mismatch summary output %s\n", path.c_str());
+    return;
+  }
+
+  csv << "opcode,tests,mismatches" << std::endl;
+  for (auto &item : summary_) {
+    csv << item.first << "," << item.second.tests << "," << item.second.mismatches << "\n";
+  }
+}
+
+void MismatchLog::LoadSummary(const std::string &path) {
+  std::ifstream csv(path.c_str());
+  std::string line;
+  // Skips the header row.
+  if (!std::getline(csv, line)) {
+    return;
+  }
+
+  while (std::getline(csv, line)) {
+    auto tests = line.find(',');
+    auto mismatches = tests == std::string::npos ? tests : line.find(',', tests + 1);
+    if (mismatches == std::string::npos) {
+      continue;
+    }
+    Count(line.substr(0, tests).c_str(), strtoul(line.c_str() + tests + 1, nullptr, 10),
+          strtoul(line.c_str() + mismatches + 1, nullptr, 10));
+  }
+}
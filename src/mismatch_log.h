@@ -0,0 +1,61 @@
+#ifndef NXDK_VSH_TESTS_MISMATCH_LOG_H
+#define NXDK_VSH_TESTS_MISMATCH_LOG_H
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+
+//! Streams every mismatch between the hardware and the CPU reference to a compact binary file so that a single run
+//! captures the complete set of errors instead of stopping at the first one.
+//!
+//! Layout (all values are little endian):
+//!   uint32_t magic ("VSHM"), uint32_t version
+//!   { char opcode[4], uint32_t num_inputs, uint32_t inputs[num_inputs][4], uint32_t hw[4], uint32_t cpu[4] }*
+//!
+//! Records are buffered and written by Flush(), so the file always ends with a whole record and a crash loses at most
+//! the current batch. See scripts/mismatch_log.py.
+class MismatchLog {
+ public:
+  static constexpr uint32_t kMagic = 0x4D485356;  // "VSHM"
+  static constexpr uint32_t kVersion = 1;
+
+  struct Counts {
+    uint32_t tests{0};
+    uint32_t mismatches{0};
+  };
+
+ public:
+  //! Creates (or truncates) the log at the given path. If `append` is set and a log already exists there, new records
+  //! are appended to it instead, e.g., to keep the records of an interrupted run that is being resumed.
+  explicit MismatchLog(const std::string &path, bool append = false);
+  ~MismatchLog() { Flush(); }
+
+  //! Appends a record. `inputs` holds `num_inputs` vectors of four floats.
+  void Record(const char *opcode, uint32_t num_inputs, const float *inputs, const float *hw_result,
+              const float *cpu_result);
+
+  //! Adds the outcome of `tests` comparisons of `opcode` to the per-opcode summary.
+  void Count(const char *opcode, uint32_t tests, uint32_t mismatches);
+
+  //! Writes the records added since the last call.
+  void Flush();
+
+  [[nodiscard]] const std::map<std::string, Counts> &Summary() const { return summary_; }
+
+  //! Writes the per-opcode summary as "opcode,tests,mismatches" rows.
+  void WriteSummary(const std::string &path) const;
+
+  //! Adds the counts of a summary written by WriteSummary, if one exists at the given path.
+  void LoadSummary(const std::string &path);
+
+ private:
+  void Write(const void *data, uint32_t size) { pending_.append(reinterpret_cast<const char *>(data), size); }
+
+ private:
+  std::ofstream log_;
+  std::string pending_;
+  std::map<std::string, Counts> summary_;
+};
+
+#endif  // NXDK_VSH_TESTS_MISMATCH_LOG_H
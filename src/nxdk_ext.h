@@ -173,4 +173,8 @@
 #define NV097_SET_SWATH_WIDTH_V_04 0x04
 #define NV097_SET_SWATH_WIDTH_V_OFF 0x0F
 
+// Absolute VIDEOREG offsets of the PFIFO DMA pointers, used to report where the GPU stopped when it hangs.
+#define NV2A_PFIFO_CACHE1_DMA_PUT 0x00003240
+#define NV2A_PFIFO_CACHE1_DMA_GET 0x00003244
+
 #endif  // NXDK_EXT_H__
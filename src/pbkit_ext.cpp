@@ -3,6 +3,7 @@
 #include <pbkit/pbkit.h>
 
 #include "debug_output.h"
+#include "gpu_watchdog.h"
 
 uint16_t float_to_z16(float val) {
   if (val == 0.0f) {
@@ -61,9 +62,8 @@ void pb_print_with_floats(const char *format, ...) {
 void pb_fetch_pgraph_registers(uint8_t *registers) {
   // See https://github.com/XboxDev/nv2a-trace/blob/65bdd2369a5b216cfc47c9545f870c49d118276b/Trace.py#L32
 
-  while (pb_busy()) {
-    /* Wait for any pending pgraph commands to be flushed */
-  }
+  // Wait for any pending pgraph commands to be flushed.
+  GpuWatchdog::WaitForIdle(__func__);
 
   constexpr uint32_t kPGRAPHRegisterEnd = PGRAPH_REGISTER_BASE + PGRAPH_REGISTER_ARRAY_SIZE;
 
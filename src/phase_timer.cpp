@@ -0,0 +1,119 @@
+#include "phase_timer.h"
+
+#include <fstream>
+
+#include "debug_output.h"
+
+PhaseTimer *PhaseTimer::singleton_ = nullptr;
+PhaseTimer::Phase PhaseTimer::current_phase_ = PhaseTimer::PHASE_COUNT;
+
+static constexpr const char *kPhaseNames[PhaseTimer::PHASE_COUNT + 1] = {
+    "program_upload", "constant_upload", "draw_submit", "idle_wait", "readback",
+    "cpu_reference",  "overlay_render",  "save",        "other",
+};
+
+const char *PhaseTimer::PhaseName(Phase phase) { return kPhaseNames[phase < PHASE_COUNT ? phase : PHASE_COUNT]; }
+
+void PhaseTimer::Initialize() {
+  ASSERT(!singleton_ && "Invalid attempt to initialize phase timer twice.");
+
+  // Calibrate up front so that it does not distort the first test.
+  TscClock::CyclesPerMicrosecond();
+  singleton_ = new PhaseTimer();
+}
+
+void PhaseTimer::BeginTest(const std::string &suite, const std::string &test) {
+  if (!singleton_) {
+    return;
+  }
+
+  singleton_->current_suite_ = suite;
+  singleton_->current_test_ = test;
+  singleton_->current_ = Totals();
+  singleton_->test_start_ = TscClock::Now();
+}
+
+void PhaseTimer::EndTest() {
+  if (!singleton_ || singleton_->current_test_.empty()) {
+    return;
+  }
+
+  auto &current = singleton_->current_;
+  current.runs = 1;
+  current.total_cycles = TscClock::Now() - singleton_->test_start_;
+
+  singleton_->totals_[singleton_->current_suite_][singleton_->current_test_].Add(current);
+  singleton_->current_test_.clear();
+}
+
+bool PhaseTimer::LastTestMicroseconds(uint64_t phase_microseconds[PHASE_COUNT]) {
+  if (!singleton_) {
+    return false;
+  }
+
+  const auto cycles_per_microsecond = TscClock::CyclesPerMicrosecond();
+  for (uint32_t i = 0; i < PHASE_COUNT; ++i) {
+    phase_microseconds[i] = singleton_->current_.phase_cycles[i] / cycles_per_microsecond;
+  }
+  return true;
+}
+
+void PhaseTimer::Accumulate(Phase phase, uint64_t cycles) {
+  current_.phase_cycles[phase] += cycles;
+  ++current_.phase_calls[phase];
+}
+
+void PhaseTimer::Totals::Add(const Totals &other) {
+  runs += other.runs;
+  total_cycles += other.total_cycles;
+  for (uint32_t i = 0; i < PHASE_COUNT; ++i) {
+    phase_cycles[i] += other.phase_cycles[i];
+    phase_calls[i] += other.phase_calls[i];
+  }
+}
+
+void PhaseTimer::WriteCSV(const std::string &path) {
+  if (!singleton_) {
+    return;
+  }
+
+  std::ofstream csv(path.c_str(), std::ios_base::out | std::ios_base::trunc);
+  if (!csv) {
+    PrintMsg("Failed to open phase timing output %s\n", path.c_str());
+    return;
+  }
+
+  const auto cycles_per_microsecond = TscClock::CyclesPerMicrosecond();
+  auto write_row = [&csv, cycles_per_microsecond](const std::string &suite, const std::string &test,
+                                                  const Totals &totals) {
+    uint64_t attributed = 0;
+    csv << suite << "," << test << "," << totals.runs << "," << totals.total_cycles / cycles_per_microsecond;
+    for (uint32_t i = 0; i < PHASE_COUNT; ++i) {
+      attributed += totals.phase_cycles[i];
+      csv << "," << totals.phase_cycles[i] / cycles_per_microsecond << "," << totals.phase_calls[i];
+    }
+    auto other = totals.total_cycles > attributed ? totals.total_cycles - attributed : 0;
+    csv << "," << other / cycles_per_microsecond << std::endl;
+  };
+
+  // Suite rows use "*" as the test name.
+  csv << "suite,test,runs,total_us";
+  for (uint32_t i = 0; i < PHASE_COUNT; ++i) {
+    csv << "," << kPhaseNames[i] << "_us," << kPhaseNames[i] << "_calls";
+  }
+  csv << ",other_us" << std::endl;
+
+  for (auto &suite : singleton_->totals_) {
+    for (auto &test : suite.second) {
+      write_row(suite.first, test.first, test.second);
+    }
+  }
+
+  for (auto &suite : singleton_->totals_) {
+    Totals suite_totals;
+    for (auto &test : suite.second) {
+      suite_totals.Add(test.second);
+    }
+    write_row(suite.first, "*", suite_totals);
+  }
+}
@@ -0,0 +1,95 @@
+#ifndef NXDK_VSH_TESTS_PHASE_TIMER_H
+#define NXDK_VSH_TESTS_PHASE_TIMER_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "tsc_clock.h"
+
+//! Accumulates time stamp counter cycles spent in each phase of a test so that optimization work can be targeted.
+//!
+//! Phases are attributed to the test set by BeginTest. Time not covered by any phase is reported as "other". The
+//! results are aggregated per test and per suite and written as CSV by WriteCSV.
+class PhaseTimer {
+ public:
+  enum Phase : uint32_t {
+    PHASE_PROGRAM_UPLOAD,
+    PHASE_CONSTANT_UPLOAD,
+    PHASE_DRAW_SUBMIT,
+    PHASE_IDLE_WAIT,
+    PHASE_READBACK,
+    PHASE_CPU_REFERENCE,
+    PHASE_OVERLAY_RENDER,
+    PHASE_SAVE,
+    PHASE_COUNT,
+  };
+
+  //! Attributes the cycles between construction and destruction to a phase. Scopes must not be nested.
+  //!
+  //! The current phase is tracked even when timing is disabled so that other instrumentation (e.g., HeapTracker) can
+  //! attribute work to it.
+  class Scope {
+   public:
+    explicit Scope(Phase phase) : phase_(phase), start_(singleton_ ? TscClock::Now() : 0) { current_phase_ = phase; }
+    ~Scope() {
+      current_phase_ = PHASE_COUNT;
+      if (singleton_) {
+        singleton_->Accumulate(phase_, TscClock::Now() - start_);
+      }
+    }
+
+   private:
+    Phase phase_;
+    uint64_t start_;
+  };
+
+ public:
+  //! Enables timing.
+  static void Initialize();
+
+  static bool IsEnabled() { return singleton_ != nullptr; }
+
+  //! Returns the phase of the active Scope, or PHASE_COUNT if none is active.
+  static Phase CurrentPhase() { return current_phase_; }
+
+  //! Returns the name used for the given phase in CSV output. PHASE_COUNT is reported as "other".
+  static const char *PhaseName(Phase phase);
+
+  static void BeginTest(const std::string &suite, const std::string &test);
+  static void EndTest();
+
+  //! Retrieves the microseconds spent in each phase by the most recently ended test. Returns false if disabled.
+  static bool LastTestMicroseconds(uint64_t phase_microseconds[PHASE_COUNT]);
+
+  //! Writes one row per test followed by one row per suite, in microseconds.
+  static void WriteCSV(const std::string &path);
+
+ private:
+  struct Totals {
+    uint32_t runs{0};
+    uint64_t total_cycles{0};
+    uint64_t phase_cycles[PHASE_COUNT]{0};
+    uint32_t phase_calls[PHASE_COUNT]{0};
+
+    void Add(const Totals &other);
+  };
+
+  PhaseTimer() = default;
+
+  void Accumulate(Phase phase, uint64_t cycles);
+
+ private:
+  std::string current_suite_;
+  std::string current_test_;
+  uint64_t test_start_{0};
+  Totals current_;
+
+  // Keyed by suite and then test so that rows are grouped in the output.
+  std::map<std::string, std::map<std::string, Totals>> totals_;
+
+  static PhaseTimer *singleton_;
+  static Phase current_phase_;
+};
+
+#endif  // NXDK_VSH_TESTS_PHASE_TIMER_H
@@ -0,0 +1,168 @@
+#include "progress_journal.h"
+
+#include <cstdlib>
+#include <fstream>
+
+#include "debug_output.h"
+#include "tests/test_suite.h"
+
+ProgressJournal *ProgressJournal::singleton_ = nullptr;
+
+static std::string test_key(const std::string &suite, const std::string &test) { return suite + "::" + test; }
+
+void ProgressJournal::Initialize(const std::string &journal_path) {
+  ASSERT(!singleton_ && "Invalid attempt to initialize progress journal twice.");
+
+  singleton_ = new ProgressJournal(journal_path);
+}
+
+ProgressJournal::ProgressJournal(const std::string &journal_path) {
+  LoadPrevious(journal_path);
+
+  const char *p = journal_path.c_str();
+  auto disposition = attempt_ > 1 ? OPEN_ALWAYS : CREATE_ALWAYS;
+  file_ = CreateFile(p, GENERIC_WRITE, 0, nullptr, disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+  ASSERT(file_ != INVALID_HANDLE_VALUE && "Failed to open progress journal for output");
+  SetFilePointer(file_, 0, nullptr, FILE_END);
+
+  if (attempt_ > 1) {
+    PrintMsg("Resuming run from %s (attempt %d), %d tests completed, %d quarantined\n", p, attempt_,
+             static_cast<int>(completed_.size()), static_cast<int>(quarantined_.size()));
+  }
+
+  Append("R " + std::to_string(attempt_));
+
+  if (!crashed_test_.empty()) {
+    PrintMsg("Quarantining %s, which did not complete in the previous attempt\n", crashed_test_.c_str());
+    Append("Q " + crashed_test_);
+  }
+}
+
+void ProgressJournal::LoadPrevious(const std::string &journal_path) {
+  std::ifstream journal(journal_path.c_str());
+  if (!journal) {
+    return;
+  }
+
+  uint32_t previous_attempt = 0;
+  bool finished = false;
+  std::string in_progress;
+  std::string line;
+  while (std::getline(journal, line)) {
+    // A final record without a newline was cut short when the console went down and can't be trusted.
+    if (line.empty() || journal.eof()) {
+      continue;
+    }
+
+    auto record = line.size() > 2 ? line.substr(2) : std::string();
+    switch (line.front()) {
+      case 'R':
+        previous_attempt = strtoul(record.c_str(), nullptr, 10);
+        in_progress.clear();
+        break;
+
+      case 'S':
+        in_progress = record;
+        break;
+
+      case 'C': {
+        // The elapsed time follows the last space, test names may contain spaces.
+        auto key = record.substr(0, record.rfind(' '));
+        completed_.insert(key);
+        if (key == in_progress) {
+          in_progress.clear();
+        }
+      } break;
+
+      case 'Q':
+        quarantined_.insert(record);
+        break;
+
+      case 'E':
+        finished = true;
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  if (finished || !previous_attempt) {
+    completed_.clear();
+    quarantined_.clear();
+    return;
+  }
+
+  attempt_ = previous_attempt + 1;
+  if (!in_progress.empty()) {
+    quarantined_.insert(in_progress);
+    crashed_test_ = in_progress;
+  }
+}
+
+bool ProgressJournal::IsResuming() { return singleton_ && singleton_->attempt_ > 1; }
+
+uint32_t ProgressJournal::Attempt() { return singleton_ ? singleton_->attempt_ : 1; }
+
+void ProgressJournal::SkipFinishedTests(std::vector<std::shared_ptr<TestSuite>> &test_suites) {
+  if (!IsResuming()) {
+    return;
+  }
+
+  std::vector<std::shared_ptr<TestSuite>> remaining_suites;
+  for (auto &suite : test_suites) {
+    std::vector<std::string> tests_to_skip;
+    for (auto &test : suite->TestNames()) {
+      auto key = test_key(suite->Name(), test);
+      if (singleton_->completed_.count(key)) {
+        tests_to_skip.push_back(test);
+      } else if (singleton_->quarantined_.count(key)) {
+        PrintMsg("Skipping quarantined test %s\n", key.c_str());
+        tests_to_skip.push_back(test);
+      }
+    }
+
+    suite->DisableTests(tests_to_skip);
+    if (!suite->TestNames().empty()) {
+      remaining_suites.push_back(suite);
+    }
+  }
+
+  test_suites = remaining_suites;
+}
+
+void ProgressJournal::RecordTestStart(const std::string &suite, const std::string &test) {
+  if (!singleton_) {
+    return;
+  }
+  singleton_->Append("S " + test_key(suite, test));
+}
+
+void ProgressJournal::RecordTestEnd(const std::string &suite, const std::string &test, uint32_t elapsed_milliseconds) {
+  if (!singleton_) {
+    return;
+  }
+  singleton_->Append("C " + test_key(suite, test) + " " + std::to_string(elapsed_milliseconds));
+}
+
+void ProgressJournal::Finish() {
+  if (!singleton_) {
+    return;
+  }
+
+  singleton_->Append("E");
+  CloseHandle(singleton_->file_);
+  delete singleton_;
+  singleton_ = nullptr;
+}
+
+void ProgressJournal::Append(const std::string &record) {
+  auto line = record + "\n";
+  DWORD bytes_written;
+  if (!WriteFile(file_, line.data(), line.size(), &bytes_written, nullptr) || bytes_written != line.size()) {
+    ASSERT(!"Failed to write to progress journal");
+  }
+
+  // Flush through to the disk so the record survives a hang that ends in a power cycle.
+  FlushFileBuffers(file_);
+}
@@ -0,0 +1,64 @@
+#ifndef NXDK_VSH_TESTS_PROGRESS_JOURNAL_H
+#define NXDK_VSH_TESTS_PROGRESS_JOURNAL_H
+
+#include <windows.h>
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+class TestSuite;
+
+//! Durable record of the progress of a run, used to resume after a crash or hang.
+//!
+//! One short line is appended and flushed to disk as each test starts and completes:
+//!   R <attempt>                 - The run was started (1) or resumed (> 1).
+//!   S <suite>::<test>           - A test was started.
+//!   C <suite>::<test> <ms>      - A test completed.
+//!   Q <suite>::<test>           - A test was quarantined because it never completed in a previous attempt.
+//!   E                           - The run finished.
+//!
+//! If the journal from a previous boot does not end with "E", the run is resumed: completed tests are skipped and the
+//! test that was in progress when the console went down is quarantined, so a crash costs one test rather than the run.
+class ProgressJournal {
+ public:
+  //! Opens the journal at `journal_path`, resuming the previous run if it never finished.
+  static void Initialize(const std::string &journal_path);
+
+  static bool IsEnabled() { return singleton_ != nullptr; }
+
+  //! Returns true if a previous, unfinished run is being resumed.
+  static bool IsResuming();
+
+  //! Returns the 1-based number of times this run has been started.
+  static uint32_t Attempt();
+
+  //! Disables every test that completed or was quarantined in a previous attempt and removes empty suites.
+  static void SkipFinishedTests(std::vector<std::shared_ptr<TestSuite>> &test_suites);
+
+  static void RecordTestStart(const std::string &suite, const std::string &test);
+  static void RecordTestEnd(const std::string &suite, const std::string &test, uint32_t elapsed_milliseconds);
+
+  //! Marks the run as finished so that the next boot starts a fresh run.
+  static void Finish();
+
+ private:
+  explicit ProgressJournal(const std::string &journal_path);
+
+  void LoadPrevious(const std::string &journal_path);
+  void Append(const std::string &record);
+
+ private:
+  HANDLE file_{INVALID_HANDLE_VALUE};
+  uint32_t attempt_{1};
+  std::set<std::string> completed_;
+  std::set<std::string> quarantined_;
+  // The test that was in progress when the previous attempt went down.
+  std::string crashed_test_;
+
+  static ProgressJournal *singleton_;
+};
+
+#endif  // NXDK_VSH_TESTS_PROGRESS_JOURNAL_H
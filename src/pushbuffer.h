@@ -24,6 +24,9 @@ class Pushbuffer {
   //! Flushes and ressets the underlying pushbuffer.
   static void Flush();
 
+  //! Forgets any in-progress block without waiting for the GPU, used after pbkit has been reset following a hang.
+  static void Discard();
+
   //! Pushes the given command and param to the given subchannel.
   static void PushTo(uint32_t subchannel, uint32_t command, uint32_t param1);
 
@@ -102,8 +105,8 @@ class Pushbuffer {
  private:
   Pushbuffer() = default;
 
-  //! Ensures that at least num_dwords values may be added to the pushbuffer.
-  void Reserve(uint32_t num_dwords);
+  //! Ensures that at least num_dwords values may be added to the pushbuffer for the given command.
+  void Reserve(uint32_t command, uint32_t num_dwords);
 
   uint32_t *head_ = nullptr;
 
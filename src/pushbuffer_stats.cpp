@@ -0,0 +1,99 @@
+#include "pushbuffer_stats.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "debug_output.h"
+#include "tsc_clock.h"
+
+PushbufferStats *PushbufferStats::singleton_ = nullptr;
+
+void PushbufferStats::Initialize() {
+  ASSERT(!singleton_ && "Invalid attempt to initialize pushbuffer stats twice.");
+
+  singleton_ = new PushbufferStats();
+}
+
+void PushbufferStats::BeginTest(const std::string &suite, const std::string &test) {
+  if (!singleton_) {
+    return;
+  }
+
+  singleton_->current_suite_ = suite;
+  singleton_->current_test_ = test;
+  singleton_->current_ = Counters();
+  memset(singleton_->method_counts_, 0, sizeof(singleton_->method_counts_));
+}
+
+void PushbufferStats::EndTest() {
+  if (!singleton_ || singleton_->current_test_.empty()) {
+    return;
+  }
+
+  auto &current = singleton_->current_;
+  current.runs = 1;
+  for (uint32_t i = 0; i < kNumMethods; ++i) {
+    if (singleton_->method_counts_[i]) {
+      current.methods[i << 2] = singleton_->method_counts_[i];
+    }
+  }
+
+  singleton_->totals_[singleton_->current_suite_][singleton_->current_test_].Add(current);
+  singleton_->current_test_.clear();
+}
+
+void PushbufferStats::Counters::Add(const Counters &other) {
+  runs += other.runs;
+  dwords += other.dwords;
+  kicks += other.kicks;
+  splits += other.splits;
+  flushes += other.flushes;
+  flush_cycles += other.flush_cycles;
+  for (auto &method : other.methods) {
+    methods[method.first] += method.second;
+  }
+}
+
+void PushbufferStats::WriteCSV(const std::string &path) {
+  if (!singleton_) {
+    return;
+  }
+
+  std::ofstream csv(path.c_str(), std::ios_base::out | std::ios_base::trunc);
+  if (!csv) {
+    PrintMsg("Failed to open pushbuffer stats output %s\n", path.c_str());
+    return;
+  }
+
+  auto write_rows = [&csv](const std::string &suite, const std::string &test, const Counters &counters) {
+    auto prefix = suite + "," + test + ",";
+    csv << prefix << "runs," << counters.runs << "\n";
+    csv << prefix << "dwords," << counters.dwords << "\n";
+    csv << prefix << "kicks," << counters.kicks << "\n";
+    csv << prefix << "splits," << counters.splits << "\n";
+    csv << prefix << "flushes," << counters.flushes << "\n";
+    csv << prefix << "flush_us," << counters.flush_cycles / TscClock::CyclesPerMicrosecond() << "\n";
+
+    char method_name[32];
+    for (auto &method : counters.methods) {
+      snprintf(method_name, sizeof(method_name), "method_0x%04X,", method.first);
+      csv << prefix << method_name << method.second << "\n";
+    }
+  };
+
+  csv << "suite,test,counter,value" << std::endl;
+  for (auto &suite : singleton_->totals_) {
+    for (auto &test : suite.second) {
+      write_rows(suite.first, test.first, test.second);
+    }
+  }
+
+  for (auto &suite : singleton_->totals_) {
+    Counters suite_totals;
+    for (auto &test : suite.second) {
+      suite_totals.Add(test.second);
+    }
+    write_rows(suite.first, "*", suite_totals);
+  }
+}
@@ -0,0 +1,83 @@
+#ifndef NXDK_VSH_TESTS_PUSHBUFFER_STATS_H
+#define NXDK_VSH_TESTS_PUSHBUFFER_STATS_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+//! Counts the commands submitted through Pushbuffer for each test so that command overhead can be measured.
+//!
+//! Tracks the number of times each NV097 method is pushed, the total DWORDs, the number of pb_end kicks, the number of
+//! blocks split by Pushbuffer::Reserve, the number of full flushes and the time spent blocked in Pushbuffer::Flush.
+//! Commands pushed directly through pbkit bypass the counters.
+class PushbufferStats {
+ public:
+  //! Enables counting.
+  static void Initialize();
+
+  static bool IsEnabled() { return singleton_ != nullptr; }
+
+  static void BeginTest(const std::string &suite, const std::string &test);
+  static void EndTest();
+
+  //! Writes "suite,test,counter,value" rows for every test followed by totals for every suite (test "*").
+  static void WriteCSV(const std::string &path);
+
+  static void RecordMethod(uint32_t command, uint32_t num_dwords) {
+    if (singleton_) {
+      ++singleton_->method_counts_[(command & kMethodMask) >> 2];
+      singleton_->current_.dwords += num_dwords;
+    }
+  }
+
+  static void RecordKick() {
+    if (singleton_) {
+      ++singleton_->current_.kicks;
+    }
+  }
+
+  static void RecordSplit() {
+    if (singleton_) {
+      ++singleton_->current_.splits;
+    }
+  }
+
+  static void RecordFlush(uint64_t cycles) {
+    if (singleton_) {
+      ++singleton_->current_.flushes;
+      singleton_->current_.flush_cycles += cycles;
+    }
+  }
+
+ private:
+  // Method offsets are DWORD aligned and below 0x2000 for the NV097 class.
+  static constexpr uint32_t kMethodMask = 0x1FFC;
+  static constexpr uint32_t kNumMethods = (kMethodMask >> 2) + 1;
+
+  struct Counters {
+    uint32_t runs{0};
+    uint64_t dwords{0};
+    uint32_t kicks{0};
+    uint32_t splits{0};
+    uint32_t flushes{0};
+    uint64_t flush_cycles{0};
+    // Sparse map of method offset to the number of times it was pushed.
+    std::map<uint32_t, uint32_t> methods;
+
+    void Add(const Counters &other);
+  };
+
+  PushbufferStats() = default;
+
+ private:
+  std::string current_suite_;
+  std::string current_test_;
+  Counters current_;
+  uint32_t method_counts_[kNumMethods]{0};
+
+  std::map<std::string, std::map<std::string, Counters>> totals_;
+
+  static PushbufferStats *singleton_;
+};
+
+#endif  // NXDK_VSH_TESTS_PUSHBUFFER_STATS_H
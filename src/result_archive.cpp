@@ -0,0 +1,121 @@
+#include "result_archive.h"
+
+#include "debug_output.h"
+
+ResultArchive *ResultArchive::singleton_ = nullptr;
+
+// Maximum length of the suite and test names stored with each entry.
+static constexpr uint32_t kMaxNameLength = 0xFFFF;
+
+void ResultArchive::Initialize(const std::string &archive_path) {
+  ASSERT(!singleton_ && "Invalid attempt to initialize result archive twice.");
+
+  singleton_ = new ResultArchive(archive_path);
+}
+
+ResultArchive::ResultArchive(const std::string &archive_path) {
+  const char *p = archive_path.c_str();
+  PrintMsg("Opening result archive at %s\n", p);
+
+  file_ = fopen(p, "wb");
+  ASSERT(file_ && "Failed to open result archive for output");
+
+  const uint32_t header[] = {kFileMagic0, kFileMagic1, kVersion, 0};
+  WriteRaw(header, sizeof(header));
+  fflush(file_);
+}
+
+void ResultArchive::Write(PayloadType type, const std::string &suite, const std::string &test, const void *payload,
+                          uint32_t payload_size) {
+  ASSERT(singleton_ && "Attempt to use ResultArchive before Initialize");
+  singleton_->WriteEntry(type, suite, test, payload, payload_size);
+}
+
+void ResultArchive::AppendFile(PayloadType type, const std::string &suite, const std::string &test,
+                               const std::string &path) {
+  ASSERT(singleton_ && "Attempt to use ResultArchive before Initialize");
+
+  FILE *in_file = fopen(path.c_str(), "rb");
+  if (!in_file) {
+    PrintMsg("Failed to open %s for archiving, skipping\n", path.c_str());
+    return;
+  }
+
+  std::vector<uint8_t> buffer;
+  uint8_t chunk[4096];
+  size_t bytes_read;
+  while ((bytes_read = fread(chunk, 1, sizeof(chunk), in_file)) > 0) {
+    buffer.insert(buffer.end(), chunk, chunk + bytes_read);
+  }
+  fclose(in_file);
+
+  singleton_->WriteEntry(type, suite, test, buffer.data(), buffer.size());
+}
+
+void ResultArchive::Close() {
+  if (!singleton_) {
+    return;
+  }
+
+  singleton_->WriteIndexAndClose();
+  delete singleton_;
+  singleton_ = nullptr;
+}
+
+void ResultArchive::WriteEntry(PayloadType type, const std::string &suite, const std::string &test,
+                               const void *payload, uint32_t payload_size) {
+  ASSERT(suite.size() <= kMaxNameLength && test.size() <= kMaxNameLength && "Archive entry name is too long.");
+
+  IndexEntry entry{type, offset_, payload_size, suite, test};
+
+  const uint32_t header[] = {
+      kEntryMagic,
+      type,
+      payload_size,
+      static_cast<uint32_t>(suite.size()) | (static_cast<uint32_t>(test.size()) << 16),
+  };
+  WriteRaw(header, sizeof(header));
+  WriteRaw(suite.data(), suite.size());
+  WriteRaw(test.data(), test.size());
+  WriteRaw(payload, payload_size);
+
+  // Flush each entry so that everything written before a crash or hang can still be recovered.
+  fflush(file_);
+
+  index_.emplace_back(std::move(entry));
+}
+
+void ResultArchive::WriteIndexAndClose() {
+  const uint32_t index_offset = offset_;
+
+  for (auto &entry : index_) {
+    const uint32_t header[] = {
+        entry.type,
+        entry.offset,
+        entry.payload_size,
+        static_cast<uint32_t>(entry.suite.size()) | (static_cast<uint32_t>(entry.test.size()) << 16),
+    };
+    WriteRaw(header, sizeof(header));
+    WriteRaw(entry.suite.data(), entry.suite.size());
+    WriteRaw(entry.test.data(), entry.test.size());
+  }
+
+  const uint32_t footer[] = {index_offset, static_cast<uint32_t>(index_.size()), kFooterMagic};
+  WriteRaw(footer, sizeof(footer));
+
+  if (fclose(file_)) {
+    ASSERT(!"Failed to close result archive");
+  }
+  file_ = nullptr;
+}
+
+void ResultArchive::WriteRaw(const void *data, uint32_t size) {
+  if (!size) {
+    return;
+  }
+
+  if (fwrite(data, 1, size, file_) != size) {
+    ASSERT(!"Failed to write to result archive");
+  }
+  offset_ += size;
+}
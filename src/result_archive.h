@@ -0,0 +1,77 @@
+#ifndef NXDK_VSH_TESTS_RESULT_ARCHIVE_H
+#define NXDK_VSH_TESTS_RESULT_ARCHIVE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//! Append-only container that packs every output of a run into a single file.
+//!
+//! Creating files on the FATX partition is slow, so when enabled the images, structured results and logs produced by a
+//! run are written sequentially into one archive rather than into a directory per suite with a file per test.
+//!
+//! Layout (all values are little endian):
+//!   FileHeader
+//!   { EntryHeader, suite name, test name, payload }*
+//!   { IndexEntry, suite name, test name }*    <- written by Close()
+//!   Footer
+//!
+//! Every entry is self-describing, so an archive from a run that never reached Close() can still be read by scanning
+//! the entries from the start of the file. scripts/result_archive.py lists, extracts and diffs archives on the host.
+class ResultArchive {
+ public:
+  enum PayloadType : uint32_t {
+    PAYLOAD_PNG = 1,
+    PAYLOAD_RESULTS = 2,
+    PAYLOAD_LOG = 3,
+  };
+
+  static constexpr uint32_t kFileMagic0 = 0x41485356;  // "VSHA"
+  static constexpr uint32_t kFileMagic1 = 0x00435241;  // "ARC\0"
+  static constexpr uint32_t kEntryMagic = 0x45485356;  // "VSHE"
+  static constexpr uint32_t kFooterMagic = 0x58485356;  // "VSHX"
+  static constexpr uint32_t kVersion = 1;
+
+ public:
+  //! Creates (or truncates) the archive at the given path. Subsequent outputs are routed into it.
+  static void Initialize(const std::string &archive_path);
+
+  //! Returns true if outputs should be written into the archive rather than individual files.
+  static bool IsEnabled() { return singleton_ != nullptr; }
+
+  //! Appends an entry to the archive.
+  static void Write(PayloadType type, const std::string &suite, const std::string &test, const void *payload,
+                    uint32_t payload_size);
+
+  //! Appends the contents of the file at `path` to the archive.
+  static void AppendFile(PayloadType type, const std::string &suite, const std::string &test, const std::string &path);
+
+  //! Writes the index and footer and closes the archive.
+  static void Close();
+
+ private:
+  struct IndexEntry {
+    uint32_t type;
+    uint32_t offset;
+    uint32_t payload_size;
+    std::string suite;
+    std::string test;
+  };
+
+  explicit ResultArchive(const std::string &archive_path);
+
+  void WriteEntry(PayloadType type, const std::string &suite, const std::string &test, const void *payload,
+                  uint32_t payload_size);
+  void WriteIndexAndClose();
+  void WriteRaw(const void *data, uint32_t size);
+
+ private:
+  FILE *file_{nullptr};
+  uint32_t offset_{0};
+  std::vector<IndexEntry> index_;
+
+  static ResultArchive *singleton_;
+};
+
+#endif  // NXDK_VSH_TESTS_RESULT_ARCHIVE_H
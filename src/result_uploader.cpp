@@ -0,0 +1,342 @@
+#include "result_uploader.h"
+
+#include <lwip/sockets.h>
+#include <nxdk/net.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "debug_output.h"
+
+ResultUploader *ResultUploader::singleton_ = nullptr;
+
+// Timeout applied to every socket read so that an unresponsive server is treated as a failed attempt.
+static constexpr uint32_t kSocketTimeoutSeconds = 10;
+
+static constexpr uint32_t kReplyReadyForData = 150;
+static constexpr uint32_t kReplyAlreadyOpen = 125;
+static constexpr uint32_t kReplyCommandOk = 200;
+static constexpr uint32_t kReplyServiceReady = 220;
+static constexpr uint32_t kReplyTransferComplete = 226;
+static constexpr uint32_t kReplyPassiveMode = 227;
+static constexpr uint32_t kReplyLoggedIn = 230;
+static constexpr uint32_t kReplyFileActionOk = 250;
+static constexpr uint32_t kReplyPathCreated = 257;
+static constexpr uint32_t kReplyNeedPassword = 331;
+
+static void set_receive_timeout(int sock) {
+  struct timeval timeout {};
+  timeout.tv_sec = kSocketTimeoutSeconds;
+  lwip_setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+static int connect_to(uint32_t address, uint16_t port) {
+  int sock = lwip_socket(AF_INET, SOCK_STREAM, 0);
+  if (sock < 0) {
+    return -1;
+  }
+
+  struct sockaddr_in addr {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = address;
+  if (lwip_connect(sock, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr))) {
+    lwip_close(sock);
+    return -1;
+  }
+
+  set_receive_timeout(sock);
+  return sock;
+}
+
+static bool send_all(int sock, const void *data, size_t size) {
+  auto remaining = static_cast<const uint8_t *>(data);
+  while (size) {
+    auto sent = lwip_send(sock, remaining, size, 0);
+    if (sent <= 0) {
+      return false;
+    }
+    remaining += sent;
+    size -= sent;
+  }
+  return true;
+}
+
+void ResultUploader::Initialize(const Config &config) {
+  ASSERT(!singleton_ && "Invalid attempt to initialize result uploader twice.");
+
+  PrintMsg("Initializing network for result upload to %s:%d\n", config.server_ip.c_str(), config.port);
+  if (nxNetInit(nullptr)) {
+    PrintMsg("Failed to initialize network, results will not be uploaded\n");
+    return;
+  }
+
+  singleton_ = new ResultUploader(config);
+}
+
+ResultUploader::ResultUploader(Config config) : config_(std::move(config)) {
+  thread_ = std::thread(&ResultUploader::ThreadMain, this);
+}
+
+void ResultUploader::Enqueue(const std::string &suite, const std::string &filename, const void *payload,
+                             uint32_t payload_size) {
+  ASSERT(singleton_ && "Attempt to use ResultUploader before Initialize");
+
+  Upload upload;
+  upload.remote_directory = singleton_->config_.remote_root + "/" + suite;
+  upload.remote_path = upload.remote_directory + "/" + filename;
+  auto bytes = static_cast<const uint8_t *>(payload);
+  upload.payload.assign(bytes, bytes + payload_size);
+
+  singleton_->Push(std::move(upload));
+}
+
+void ResultUploader::Close() {
+  if (!singleton_) {
+    return;
+  }
+
+  singleton_->Shutdown();
+  delete singleton_;
+  singleton_ = nullptr;
+}
+
+void ResultUploader::Push(Upload &&upload) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  // Always admit a payload into an empty queue so that a single oversized payload cannot block forever.
+  queue_changed_.wait(lock, [this, &upload] {
+    return queue_.empty() || queued_bytes_ + upload.payload.size() <= kMaxQueuedBytes;
+  });
+
+  queued_bytes_ += upload.payload.size();
+  queue_.emplace_back(std::move(upload));
+  queue_changed_.notify_all();
+}
+
+void ResultUploader::Shutdown() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    PrintMsg("Waiting for %d pending upload(s)\n", static_cast<int>(queue_.size() + (uploading_ ? 1 : 0)));
+    shutting_down_ = true;
+    queue_changed_.notify_all();
+  }
+
+  thread_.join();
+  PrintMsg("Uploaded %d result(s), %d failed\n", num_uploaded_, num_failed_);
+}
+
+void ResultUploader::ThreadMain() {
+  while (true) {
+    Upload upload;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queue_changed_.wait(lock, [this] { return !queue_.empty() || shutting_down_; });
+      if (queue_.empty()) {
+        break;
+      }
+      upload = std::move(queue_.front());
+      queue_.pop_front();
+      uploading_ = true;
+    }
+
+    bool succeeded = UploadWithRetry(upload);
+
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queued_bytes_ -= upload.payload.size();
+      uploading_ = false;
+      if (succeeded) {
+        ++num_uploaded_;
+      } else {
+        ++num_failed_;
+      }
+      queue_changed_.notify_all();
+    }
+  }
+
+  Disconnect();
+}
+
+bool ResultUploader::UploadWithRetry(const Upload &upload) {
+  auto delay = std::chrono::milliseconds(kInitialRetryDelayMilliseconds);
+
+  for (uint32_t attempt = 1; attempt <= kMaxAttempts; ++attempt) {
+    if (Connect() && EnsureDirectory(upload.remote_directory) && Store(upload.remote_path, upload.payload)) {
+      return true;
+    }
+
+    PrintMsg("Upload of %s failed (attempt %d of %d): %s\n", upload.remote_path.c_str(), attempt, kMaxAttempts,
+             last_reply_.c_str());
+
+    // Any failure may leave the control connection in an unknown state, so always start over.
+    Disconnect();
+    if (attempt < kMaxAttempts) {
+      std::this_thread::sleep_for(delay);
+      delay *= 2;
+    }
+  }
+
+  return false;
+}
+
+bool ResultUploader::Connect() {
+  if (control_socket_ >= 0) {
+    return true;
+  }
+
+  control_socket_ = connect_to(inet_addr(config_.server_ip.c_str()), config_.port);
+  if (control_socket_ < 0) {
+    last_reply_ = "connection failed";
+    return false;
+  }
+
+  if (ReadReply() != kReplyServiceReady) {
+    return false;
+  }
+
+  if (!SendCommand("USER " + config_.user)) {
+    return false;
+  }
+  auto reply = ReadReply();
+  if (reply == kReplyNeedPassword) {
+    if (!SendCommand("PASS " + config_.password)) {
+      return false;
+    }
+    reply = ReadReply();
+  }
+  if (reply != kReplyLoggedIn) {
+    return false;
+  }
+
+  return SendCommand("TYPE I") && ReadReply() == kReplyCommandOk;
+}
+
+void ResultUploader::Disconnect() {
+  if (control_socket_ < 0) {
+    return;
+  }
+
+  if (SendCommand("QUIT")) {
+    ReadReply();
+  }
+  lwip_close(control_socket_);
+  control_socket_ = -1;
+  reply_buffer_.clear();
+  created_directories_.clear();
+}
+
+bool ResultUploader::SendCommand(const std::string &command) {
+  auto line = command + "\r\n";
+  return send_all(control_socket_, line.data(), line.size());
+}
+
+uint32_t ResultUploader::ReadReply() {
+  // Multi-line replies start with "xyz-" and end with a line starting with "xyz ".
+  std::string first_line;
+  while (true) {
+    auto line_end = reply_buffer_.find("\r\n");
+    if (line_end == std::string::npos) {
+      char buffer[512];
+      auto received = lwip_recv(control_socket_, buffer, sizeof(buffer), 0);
+      if (received <= 0) {
+        last_reply_ = "connection lost";
+        return 0;
+      }
+      reply_buffer_.append(buffer, received);
+      continue;
+    }
+
+    std::string line = reply_buffer_.substr(0, line_end);
+    reply_buffer_.erase(0, line_end + 2);
+
+    if (first_line.empty()) {
+      if (line.size() < 4) {
+        last_reply_ = "malformed reply";
+        return 0;
+      }
+      first_line = line;
+      if (line[3] != '-') {
+        break;
+      }
+      continue;
+    }
+
+    if (line.size() >= 4 && !line.compare(0, 3, first_line, 0, 3) && line[3] == ' ') {
+      break;
+    }
+  }
+
+  last_reply_ = first_line;
+  return strtoul(first_line.substr(0, 3).c_str(), nullptr, 10);
+}
+
+bool ResultUploader::EnsureDirectory(const std::string &path) {
+  if (created_directories_.count(path)) {
+    return true;
+  }
+
+  // Create each component in turn. A failure usually just means that the directory already exists, so it is not an
+  // error; a genuinely missing directory will cause the subsequent STOR to fail.
+  std::string::size_type separator = 0;
+  while (separator != std::string::npos) {
+    separator = path.find('/', separator + 1);
+    auto component = path.substr(0, separator);
+    if (component.empty() || created_directories_.count(component)) {
+      continue;
+    }
+
+    if (!SendCommand("MKD " + component) || !ReadReply()) {
+      return false;
+    }
+    created_directories_.insert(component);
+  }
+
+  return true;
+}
+
+int ResultUploader::OpenPassiveDataConnection() {
+  if (!SendCommand("PASV") || ReadReply() != kReplyPassiveMode) {
+    return -1;
+  }
+
+  // 227 Entering Passive Mode (h1,h2,h3,h4,p1,p2)
+  auto values_start = last_reply_.find('(');
+  if (values_start == std::string::npos) {
+    return -1;
+  }
+  uint32_t h1, h2, h3, h4, p1, p2;
+  if (sscanf(last_reply_.c_str() + values_start, "(%u,%u,%u,%u,%u,%u)", &h1, &h2, &h3, &h4, &p1, &p2) != 6) {
+    return -1;
+  }
+
+  uint32_t address = htonl((h1 << 24) | (h2 << 16) | (h3 << 8) | h4);
+  return connect_to(address, static_cast<uint16_t>((p1 << 8) | p2));
+}
+
+bool ResultUploader::Store(const std::string &path, const std::vector<uint8_t> &payload) {
+  int data_socket = OpenPassiveDataConnection();
+  if (data_socket < 0) {
+    return false;
+  }
+
+  if (!SendCommand("STOR " + path)) {
+    lwip_close(data_socket);
+    return false;
+  }
+  auto reply = ReadReply();
+  if (reply != kReplyReadyForData && reply != kReplyAlreadyOpen) {
+    lwip_close(data_socket);
+    return false;
+  }
+
+  bool sent = send_all(data_socket, payload.data(), payload.size());
+  lwip_close(data_socket);
+  if (!sent) {
+    return false;
+  }
+
+  reply = ReadReply();
+  return reply == kReplyTransferComplete || reply == kReplyFileActionOk;
+}
@@ -0,0 +1,96 @@
+#ifndef NXDK_VSH_TESTS_RESULT_UPLOADER_H
+#define NXDK_VSH_TESTS_RESULT_UPLOADER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+//! Streams test outputs to an FTP server from a background thread while the run is in progress.
+//!
+//! Outputs are copied into a bounded in-memory queue so that rendering is never blocked on the network unless the queue
+//! is full. Each upload is retried with a fresh control connection before it is given up on. Files are stored at
+//! `<remote_root>/<suite>/<filename>`, mirroring the local output directory layout.
+class ResultUploader {
+ public:
+  struct Config {
+    std::string server_ip;
+    uint16_t port{21};
+    std::string user;
+    std::string password;
+    std::string remote_root;
+  };
+
+  //! Maximum number of payload bytes held in the queue before Enqueue blocks.
+  static constexpr uint32_t kMaxQueuedBytes = 16 * 1024 * 1024;
+  //! Number of times an upload is attempted before it is dropped.
+  static constexpr uint32_t kMaxAttempts = 5;
+  //! Delay before the first retry, doubled after each subsequent failure.
+  static constexpr uint32_t kInitialRetryDelayMilliseconds = 250;
+
+ public:
+  //! Brings up networking and starts the upload thread.
+  static void Initialize(const Config &config);
+
+  //! Returns true if outputs should be queued for upload.
+  static bool IsEnabled() { return singleton_ != nullptr; }
+
+  //! Queues a copy of the given payload for upload. Blocks while the queue is full.
+  static void Enqueue(const std::string &suite, const std::string &filename, const void *payload,
+                      uint32_t payload_size);
+
+  //! Waits for all queued uploads to finish and stops the upload thread.
+  static void Close();
+
+ private:
+  struct Upload {
+    std::string remote_path;
+    std::string remote_directory;
+    std::vector<uint8_t> payload;
+  };
+
+  explicit ResultUploader(Config config);
+
+  void Push(Upload &&upload);
+  void Shutdown();
+  void ThreadMain();
+  bool UploadWithRetry(const Upload &upload);
+
+  bool Connect();
+  void Disconnect();
+  bool SendCommand(const std::string &command);
+  //! Reads a (possibly multi-line) reply from the control connection and returns its status code, or 0 on error.
+  uint32_t ReadReply();
+  //! Creates `path` and each of its parents with MKD, once per control connection.
+  bool EnsureDirectory(const std::string &path);
+  bool Store(const std::string &path, const std::vector<uint8_t> &payload);
+  int OpenPassiveDataConnection();
+
+ private:
+  Config config_;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable queue_changed_;
+  std::deque<Upload> queue_;
+  uint32_t queued_bytes_{0};
+  bool uploading_{false};
+  bool shutting_down_{false};
+
+  int control_socket_{-1};
+  std::string reply_buffer_;
+  std::string last_reply_;
+  //! Remote directories already passed to MKD on the current control connection.
+  std::set<std::string> created_directories_;
+
+  uint32_t num_uploaded_{0};
+  uint32_t num_failed_{0};
+
+  static ResultUploader *singleton_;
+};
+
+#endif  // NXDK_VSH_TESTS_RESULT_UPLOADER_H
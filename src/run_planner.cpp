@@ -0,0 +1,118 @@
+#include "run_planner.h"
+
+#include <fstream>
+
+#include "debug_output.h"
+#include "test_sharder.h"
+
+RunPlanner *RunPlanner::singleton_ = nullptr;
+
+void RunPlanner::Initialize(const std::string &durations_path) {
+  ASSERT(!singleton_ && "Invalid attempt to initialize run planner twice.");
+
+  singleton_ = new RunPlanner();
+  if (!TestSharder::ReadDurations(durations_path, singleton_->durations_)) {
+    PrintMsg("No test durations at %s, wall time estimates will use %dms per test\n", durations_path.c_str(),
+             TestSharder::kDefaultDurationMilliseconds);
+  }
+  singleton_->default_duration_ = TestSharder::MedianDuration(singleton_->durations_);
+}
+
+void RunPlanner::BeginTest(const std::string &suite, const std::string &test) {
+  if (!singleton_) {
+    return;
+  }
+
+  singleton_->current_suite_ = suite;
+  singleton_->current_test_ = test;
+  singleton_->current_ = Counters();
+}
+
+void RunPlanner::EndTest() {
+  if (!singleton_ || singleton_->current_test_.empty()) {
+    return;
+  }
+
+  auto &current = singleton_->current_;
+  auto duration = singleton_->durations_.find(singleton_->current_suite_ + "::" + singleton_->current_test_);
+  current.estimated_milliseconds =
+      duration == singleton_->durations_.end() ? singleton_->default_duration_ : duration->second;
+
+  singleton_->totals_[singleton_->current_suite_][singleton_->current_test_].Add(current);
+  singleton_->current_test_.clear();
+}
+
+void RunPlanner::RecordComputation(uint32_t program_dwords, uint32_t constant_uploads, uint32_t constant_dwords,
+                                   uint32_t draw_dwords, uint32_t readback_registers, bool custom_draw) {
+  if (!singleton_) {
+    return;
+  }
+
+  auto &current = singleton_->current_;
+  ++current.computations;
+  ++current.shader_uploads;
+  current.constant_uploads += constant_uploads;
+  current.pushbuffer_dwords += program_dwords + constant_dwords + draw_dwords;
+  current.readback_registers += readback_registers;
+  if (custom_draw) {
+    ++current.custom_draws;
+  }
+}
+
+void RunPlanner::RecordImage() {
+  if (singleton_) {
+    ++singleton_->current_.images;
+  }
+}
+
+void RunPlanner::Counters::Add(const Counters &other) {
+  computations += other.computations;
+  custom_draws += other.custom_draws;
+  shader_uploads += other.shader_uploads;
+  constant_uploads += other.constant_uploads;
+  pushbuffer_dwords += other.pushbuffer_dwords;
+  readback_registers += other.readback_registers;
+  images += other.images;
+  estimated_milliseconds += other.estimated_milliseconds;
+}
+
+void RunPlanner::WriteReport(const std::string &path) {
+  if (!singleton_) {
+    return;
+  }
+
+  std::ofstream csv(path.c_str(), std::ios_base::out | std::ios_base::trunc);
+  if (!csv) {
+    PrintMsg("Failed to open dry run report %s\n", path.c_str());
+    return;
+  }
+
+  auto write_row = [&csv](const std::string &suite, const std::string &test, const Counters &counters) {
+    csv << suite << "," << test << "," << counters.computations << "," << counters.custom_draws << ","
+        << counters.shader_uploads << "," << counters.constant_uploads << "," << counters.pushbuffer_dwords << ","
+        << counters.readback_registers << "," << counters.images << "," << counters.estimated_milliseconds << "\n";
+  };
+
+  csv << "suite,test,computations,custom_draws,shader_uploads,constant_uploads,pushbuffer_dwords,readback_registers,"
+         "images,estimated_ms"
+      << std::endl;
+  for (auto &suite : singleton_->totals_) {
+    for (auto &test : suite.second) {
+      write_row(suite.first, test.first, test.second);
+    }
+  }
+
+  Counters run_totals;
+  for (auto &suite : singleton_->totals_) {
+    Counters suite_totals;
+    for (auto &test : suite.second) {
+      suite_totals.Add(test.second);
+    }
+    write_row(suite.first, "*", suite_totals);
+    run_totals.Add(suite_totals);
+  }
+  write_row("*", "*", run_totals);
+
+  PrintMsg("Dry run: %d computations, %d images, estimated %d seconds\n", run_totals.computations, run_totals.images,
+           static_cast<int>(run_totals.estimated_milliseconds / 1000));
+}
@@ -0,0 +1,63 @@
+#ifndef NXDK_VSH_TESTS_RUN_PLANNER_H
+#define NXDK_VSH_TESTS_RUN_PLANNER_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+//! Tallies the work each test would submit during a dry run so that the cost of a run can be estimated up front.
+//!
+//! In dry-run mode TestHost does not submit computations or render results. Instead it reports the exact number of
+//! pushbuffer DWORDs each computation would have pushed, and this class aggregates them per test and per suite together
+//! with an estimated wall time taken from the historical durations used to balance shards (see TestSharder).
+//! Computations with a custom draw function and commands issued directly through pbkit are not counted.
+class RunPlanner {
+ public:
+  //! Enables planning, estimating wall time from the durations file at `durations_path` if it exists.
+  static void Initialize(const std::string &durations_path);
+
+  static bool IsEnabled() { return singleton_ != nullptr; }
+
+  static void BeginTest(const std::string &suite, const std::string &test);
+  static void EndTest();
+
+  //! Records a computation that would have been submitted. `custom_draw` indicates that `draw_dwords` is unknown.
+  static void RecordComputation(uint32_t program_dwords, uint32_t constant_uploads, uint32_t constant_dwords,
+                                uint32_t draw_dwords, uint32_t readback_registers, bool custom_draw);
+
+  //! Records a result image that would have been saved.
+  static void RecordImage();
+
+  //! Writes one row per test followed by one row per suite (test "*") and a grand total (suite "*").
+  static void WriteReport(const std::string &path);
+
+ private:
+  struct Counters {
+    uint32_t computations{0};
+    uint32_t custom_draws{0};
+    uint32_t shader_uploads{0};
+    uint32_t constant_uploads{0};
+    uint64_t pushbuffer_dwords{0};
+    uint32_t readback_registers{0};
+    uint32_t images{0};
+    uint64_t estimated_milliseconds{0};
+
+    void Add(const Counters &other);
+  };
+
+  RunPlanner() = default;
+
+ private:
+  std::string current_suite_;
+  std::string current_test_;
+  Counters current_;
+
+  std::map<std::string, uint32_t> durations_;
+  uint32_t default_duration_{0};
+
+  std::map<std::string, std::map<std::string, Counters>> totals_;
+
+  static RunPlanner *singleton_;
+};
+
+#endif  // NXDK_VSH_TESTS_RUN_PLANNER_H
@@ -0,0 +1,76 @@
+#include "runtime_history.h"
+
+#include <chrono>
+#include <utility>
+
+#include "debug_output.h"
+#include "phase_timer.h"
+#include "tsc_clock.h"
+
+RuntimeHistory *RuntimeHistory::singleton_ = nullptr;
+
+void RuntimeHistory::Initialize(const std::string &history_path, const std::string &build_id) {
+  ASSERT(!singleton_ && "Invalid attempt to initialize runtime history twice.");
+
+  // Calibrate up front so that it does not distort the first test.
+  TscClock::CyclesPerMicrosecond();
+  singleton_ = new RuntimeHistory(history_path, build_id);
+}
+
+RuntimeHistory::RuntimeHistory(const std::string &history_path, std::string build_id)
+    : build_id_(std::move(build_id)) {
+  history_.open(history_path.c_str(), std::ios_base::out | std::ios_base::app);
+  ASSERT(history_ && "Failed to open runtime history for output");
+
+  history_.seekp(0, std::ios_base::end);
+  if (history_.tellp() == 0) {
+    history_ << "build,run,suite,test,metric,microseconds" << std::endl;
+  }
+
+  // Runs are distinguished by their start time, which is also how the host tool orders them.
+  auto now = std::chrono::system_clock::now();
+  run_id_ = std::to_string(std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count());
+}
+
+void RuntimeHistory::BeginTest(const std::string &suite, const std::string &test) {
+  if (!singleton_) {
+    return;
+  }
+
+  singleton_->current_suite_ = suite;
+  singleton_->current_test_ = test;
+  singleton_->test_start_ = TscClock::Now();
+}
+
+void RuntimeHistory::EndTest() {
+  if (!singleton_ || singleton_->current_test_.empty()) {
+    return;
+  }
+
+  const auto cycles_per_microsecond = TscClock::CyclesPerMicrosecond();
+  singleton_->Append("total", (TscClock::Now() - singleton_->test_start_) / cycles_per_microsecond);
+
+  uint64_t phase_microseconds[PhaseTimer::PHASE_COUNT];
+  if (PhaseTimer::LastTestMicroseconds(phase_microseconds)) {
+    for (uint32_t i = 0; i < PhaseTimer::PHASE_COUNT; ++i) {
+      singleton_->Append(PhaseTimer::PhaseName(static_cast<PhaseTimer::Phase>(i)), phase_microseconds[i]);
+    }
+  }
+
+  singleton_->history_.flush();
+  singleton_->current_test_.clear();
+}
+
+void RuntimeHistory::Close() {
+  if (!singleton_) {
+    return;
+  }
+
+  delete singleton_;
+  singleton_ = nullptr;
+}
+
+void RuntimeHistory::Append(const char *metric, uint64_t microseconds) {
+  history_ << build_id_ << "," << run_id_ << "," << current_suite_ << "," << current_test_ << "," << metric << ","
+           << microseconds << "\n";
+}
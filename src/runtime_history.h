@@ -0,0 +1,44 @@
+#ifndef NXDK_VSH_TESTS_RUNTIME_HISTORY_H
+#define NXDK_VSH_TESTS_RUNTIME_HISTORY_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+//! Appends the duration of every test to a CSV file that accumulates across runs so that slowdowns can be detected.
+//!
+//! Each row is "build,run,suite,test,metric,microseconds", where build identifies the XBE (BUILD_ID), run identifies
+//! this execution, and metric is "total" or, when PhaseTimer is enabled, the name of a phase. Rows are flushed as each
+//! test ends so that an interrupted run still contributes its completed tests. See scripts/runtime_history.py.
+class RuntimeHistory {
+ public:
+  //! Opens the history at `history_path` for appending, creating it if necessary.
+  static void Initialize(const std::string &history_path, const std::string &build_id);
+
+  static bool IsEnabled() { return singleton_ != nullptr; }
+
+  static void BeginTest(const std::string &suite, const std::string &test);
+
+  //! Appends the rows for the current test. Must be called after PhaseTimer::EndTest.
+  static void EndTest();
+
+  static void Close();
+
+ private:
+  RuntimeHistory(const std::string &history_path, std::string build_id);
+
+  void Append(const char *metric, uint64_t microseconds);
+
+ private:
+  std::ofstream history_;
+  std::string build_id_;
+  std::string run_id_;
+
+  std::string current_suite_;
+  std::string current_test_;
+  uint64_t test_start_{0};
+
+  static RuntimeHistory *singleton_;
+};
+
+#endif  // NXDK_VSH_TESTS_RUNTIME_HISTORY_H
@@ -4,38 +4,37 @@
 
 #include <memory>
 
+#include "content_hash.h"
 #include "debug_output.h"
+#include "gpu_watchdog.h"
 #include "pbkit_ext.h"
+#include "pushbuffer.h"
 
 void VertexShaderProgram::LoadShaderProgram(const uint32_t *shader, uint32_t shader_size) const {
-  uint32_t *p;
-  int i;
-
-  p = pb_begin();
+  Pushbuffer::Begin();
 
   // Set run address of shader
-  p = pb_push1(p, NV097_SET_TRANSFORM_PROGRAM_START, 0);
+  Pushbuffer::Push(NV097_SET_TRANSFORM_PROGRAM_START, 0);
 
-  p = pb_push1(
-      p, NV097_SET_TRANSFORM_EXECUTION_MODE,
+  Pushbuffer::Push(
+      NV097_SET_TRANSFORM_EXECUTION_MODE,
       MASK(NV097_SET_TRANSFORM_EXECUTION_MODE_MODE, NV097_SET_TRANSFORM_EXECUTION_MODE_MODE_PROGRAM) |
           MASK(NV097_SET_TRANSFORM_EXECUTION_MODE_RANGE_MODE, NV097_SET_TRANSFORM_EXECUTION_MODE_RANGE_MODE_PRIV));
 
   // Enable writing to c0-96 registers?
-  p = pb_push1(p, NV097_SET_TRANSFORM_PROGRAM_CXT_WRITE_EN, true);
-  pb_end(p);
+  Pushbuffer::Push(NV097_SET_TRANSFORM_PROGRAM_CXT_WRITE_EN, true);
+  Pushbuffer::End();
 
   // Set cursor and begin copying program
-  p = pb_begin();
-  p = pb_push1(p, NV097_SET_TRANSFORM_PROGRAM_LOAD, 0);
-  pb_end(p);
-
-  for (i = 0; i < shader_size / 16; i++) {
-    p = pb_begin();
-    pb_push(p++, NV097_SET_TRANSFORM_PROGRAM, 4);
-    memcpy(p, &shader[i * 4], 4 * 4);
-    p += 4;
-    pb_end(p);
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_TRANSFORM_PROGRAM_LOAD, 0);
+  Pushbuffer::End();
+
+  for (uint32_t i = 0; i < shader_size / 16; i++) {
+    Pushbuffer::Begin();
+    auto instruction = &shader[i * 4];
+    Pushbuffer::Push(NV097_SET_TRANSFORM_PROGRAM, instruction[0], instruction[1], instruction[2], instruction[3]);
+    Pushbuffer::End();
   }
 }
 
@@ -62,32 +61,50 @@ void VertexShaderProgram::PrepareDraw() {
 void VertexShaderProgram::UploadConstants() {
   uint32_t load_index = 0xFFFF;
 
-  auto p = pb_begin();
+  Pushbuffer::Begin();
   uint32_t depth = 0;
 
   for (const auto &item : uniforms_) {
     const uint32_t slot = item.first;
 
     if (slot != load_index) {
-      p = pb_push1(p, NV097_SET_TRANSFORM_CONSTANT_LOAD, slot);
+      Pushbuffer::Push(NV097_SET_TRANSFORM_CONSTANT_LOAD, slot);
       load_index = slot;
     }
-    p = pb_push4(p, NV097_SET_TRANSFORM_CONSTANT, item.second.x, item.second.y, item.second.z, item.second.w);
+    Pushbuffer::Push(NV097_SET_TRANSFORM_CONSTANT, item.second.x, item.second.y, item.second.z, item.second.w);
     load_index += 1;
 
     if (++depth > 16) {
-      pb_end(p);
-      while (pb_busy())
-        ;
+      Pushbuffer::End();
+      GpuWatchdog::WaitForIdle(__func__);
       depth = 0;
-      p = pb_begin();
+      Pushbuffer::Begin();
     }
   }
 
-  pb_end(p);
+  Pushbuffer::End();
   uniform_upload_required_ = false;
 }
 
+uint32_t VertexShaderProgram::PendingConstantDwords() const {
+  if (!uniform_upload_required_) {
+    return 0;
+  }
+
+  // Mirrors UploadConstants: a load command whenever the slots are not contiguous, then one command per constant.
+  uint32_t dwords = 0;
+  uint32_t load_index = 0xFFFF;
+  for (const auto &item : uniforms_) {
+    if (item.first != load_index) {
+      dwords += 2;
+      load_index = item.first;
+    }
+    dwords += 5;
+    load_index += 1;
+  }
+  return dwords;
+}
+
 void VertexShaderProgram::SetUniform4x4F(uint32_t slot, const float *value) {
   SetUniformBlock(slot, reinterpret_cast<const uint32_t *>(value), 4);
 }
@@ -124,3 +141,11 @@ void VertexShaderProgram::SetUniformBlock(uint32_t slot, const uint32_t *values,
   }
   uniform_upload_required_ = true;
 }
+
+uint64_t VertexShaderProgram::HashUniforms(uint64_t hash) const {
+  for (const auto &item : uniforms_) {
+    hash = ContentHash(&item.first, sizeof(item.first), hash);
+    hash = ContentHash(&item.second, sizeof(item.second), hash);
+  }
+  return hash;
+}
@@ -29,6 +29,15 @@ class VertexShaderProgram {
   void SetUniformUI(uint32_t slot, uint32_t x, uint32_t y = 0, uint32_t z = 0, uint32_t w = 0);
   void SetUniformI(uint32_t slot, int32_t x, int32_t y = 0, int32_t z = 0, int32_t w = 0);
 
+  //! Folds the slots and values of all uniforms into the given ContentHash.
+  [[nodiscard]] uint64_t HashUniforms(uint64_t hash) const;
+
+  //! Returns the number of constants that the next PrepareDraw will upload.
+  [[nodiscard]] uint32_t PendingConstantCount() const { return uniform_upload_required_ ? uniforms_.size() : 0; }
+
+  //! Returns the number of pushbuffer DWORDs that the next PrepareDraw will push to upload constants.
+  [[nodiscard]] uint32_t PendingConstantDwords() const;
+
  protected:
   virtual void OnActivate() {}
   virtual void OnLoadShader() {}
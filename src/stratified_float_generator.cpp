@@ -0,0 +1,144 @@
+#include "stratified_float_generator.h"
+
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#include "counter_rng.h"
+#include "debug_output.h"
+
+static constexpr uint32_t kSignBit = 0x80000000;
+static constexpr uint32_t kExponentShift = 23;
+static constexpr uint32_t kMantissaMask = 0x007FFFFF;
+static constexpr uint32_t kQuietBit = 0x00400000;
+static constexpr uint32_t kInfinity = 0x7F800000;
+
+StratifiedFloatGenerator::StratifiedFloatGenerator(uint32_t classes, bool allow_negative, std::vector<float> curated)
+    : allow_negative_(allow_negative), curated_(std::move(curated)) {
+  for (auto negative : {false, true}) {
+    if (negative && !allow_negative) {
+      break;
+    }
+
+    if (classes & CLASS_ZERO) {
+      strata_.push_back({KIND_ZERO, 0, MANTISSA_RANDOM, negative});
+    }
+    if (classes & CLASS_NORMAL) {
+      for (uint8_t band = 0; band < kExponentBands; ++band) {
+        for (uint8_t pattern = 0; pattern < MANTISSA_PATTERN_COUNT; ++pattern) {
+          strata_.push_back({KIND_NORMAL, band, static_cast<MantissaPattern>(pattern), negative});
+        }
+      }
+    }
+    if (classes & CLASS_SUBNORMAL) {
+      for (uint8_t pattern = 0; pattern < MANTISSA_PATTERN_COUNT; ++pattern) {
+        strata_.push_back({KIND_SUBNORMAL, 0, static_cast<MantissaPattern>(pattern), negative});
+      }
+    }
+    if (classes & CLASS_INFINITY) {
+      strata_.push_back({KIND_INFINITY, 0, MANTISSA_RANDOM, negative});
+    }
+    if (classes & CLASS_NAN) {
+      strata_.push_back({KIND_QUIET_NAN, 0, MANTISSA_RANDOM, negative});
+      strata_.push_back({KIND_SIGNALING_NAN, 0, MANTISSA_RANDOM, negative});
+    }
+  }
+
+  if ((classes & CLASS_CURATED) && !curated_.empty()) {
+    strata_.push_back({KIND_CURATED, 0, MANTISSA_RANDOM, false});
+  }
+  ASSERT(!strata_.empty() && "No value classes enabled");
+
+  order_.resize(strata_.size());
+  Reset();
+}
+
+float StratifiedFloatGenerator::Next(CounterRng &rng) {
+  if (next_ == order_.size()) {
+    // Fisher-Yates shuffle of the strata for the next round.
+    for (uint32_t i = 0; i < order_.size(); ++i) {
+      order_[i] = i;
+    }
+    for (uint32_t i = order_.size() - 1; i > 0; --i) {
+      std::swap(order_[i], order_[rng.NextUint32() % (i + 1)]);
+    }
+    next_ = 0;
+  }
+
+  return NextInStratum(order_[next_++], rng);
+}
+
+float StratifiedFloatGenerator::NextInStratum(uint32_t stratum, CounterRng &rng) {
+  ASSERT(stratum < strata_.size() && "Invalid stratum");
+  const uint32_t bits = Generate(strata_[stratum], rng);
+  float ret;
+  memcpy(&ret, &bits, sizeof(ret));
+  return ret;
+}
+
+uint32_t StratifiedFloatGenerator::Mantissa(MantissaPattern pattern, bool subnormal, CounterRng &rng) {
+  switch (pattern) {
+    case MANTISSA_RANDOM: {
+      uint32_t ret = rng.NextUint32() & kMantissaMask;
+      // A zero mantissa would turn a subnormal into a zero.
+      return subnormal && !ret ? 1 : ret;
+    }
+
+    case MANTISSA_POWER_OF_TWO:
+      // The largest subnormal power of two.
+      return subnormal ? 0x00400000 : 0;
+
+    case MANTISSA_ABOVE_POWER_OF_TWO:
+      return 1;
+
+    case MANTISSA_BELOW_POWER_OF_TWO:
+      return kMantissaMask;
+
+    default:
+      ASSERT(!"Invalid mantissa pattern");
+      return 0;
+  }
+}
+
+uint32_t StratifiedFloatGenerator::Generate(const Stratum &stratum, CounterRng &rng) const {
+  const uint32_t sign = stratum.negative ? kSignBit : 0;
+
+  switch (stratum.kind) {
+    case KIND_ZERO:
+      return sign;
+
+    case KIND_NORMAL: {
+      const uint32_t first = BandFirstExponent(stratum.band);
+      const uint32_t count = BandFirstExponent(stratum.band + 1) - first;
+      const uint32_t exponent = first + rng.NextUint32() % count;
+      return sign | (exponent << kExponentShift) | Mantissa(stratum.pattern, false, rng);
+    }
+
+    case KIND_SUBNORMAL:
+      return sign | Mantissa(stratum.pattern, true, rng);
+
+    case KIND_INFINITY:
+      return sign | kInfinity;
+
+    case KIND_QUIET_NAN:
+      return sign | kInfinity | kQuietBit | (rng.NextUint32() & (kQuietBit - 1));
+
+    case KIND_SIGNALING_NAN: {
+      uint32_t payload = rng.NextUint32() & (kQuietBit - 1);
+      return sign | kInfinity | (payload ? payload : 1);
+    }
+
+    case KIND_CURATED: {
+      float value = curated_[rng.NextUint32() % curated_.size()];
+      if (!allow_negative_) {
+        value = fabsf(value);
+      }
+      uint32_t ret;
+      memcpy(&ret, &value, sizeof(ret));
+      return ret;
+    }
+  }
+
+  ASSERT(!"Invalid stratum");
+  return 0;
+}
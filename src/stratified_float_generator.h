@@ -0,0 +1,91 @@
+#ifndef NXDK_VSH_TESTS_STRATIFIED_FLOAT_GENERATOR_H
+#define NXDK_VSH_TESTS_STRATIFIED_FLOAT_GENERATOR_H
+
+#include <cstdint>
+#include <vector>
+
+class CounterRng;
+
+//! Generates floats that are spread evenly across classes of values instead of uniformly over bit patterns, most of
+//! which are huge or NaN.
+//!
+//! The value space is split into strata: zeros, each band of normal exponents combined with each mantissa pattern
+//! (random, exact power of two, one ULP above a power of two and one ULP below the next one), the same mantissa
+//! patterns for subnormals, infinities, quiet and signaling NaNs with random payloads, and a list of curated values.
+//! Unless negatives are disabled, every stratum except the curated one exists once per sign. Draws are made in rounds
+//! that visit every enabled stratum exactly once in a random order, so each round of StrataCount() draws covers them
+//! all.
+class StratifiedFloatGenerator {
+ public:
+  enum ValueClass : uint32_t {
+    CLASS_ZERO = 1 << 0,
+    CLASS_NORMAL = 1 << 1,
+    CLASS_SUBNORMAL = 1 << 2,
+    CLASS_INFINITY = 1 << 3,
+    CLASS_NAN = 1 << 4,
+    CLASS_CURATED = 1 << 5,
+
+    CLASS_FINITE = CLASS_ZERO | CLASS_NORMAL | CLASS_CURATED,
+    CLASS_ALL = CLASS_FINITE | CLASS_SUBNORMAL | CLASS_INFINITY | CLASS_NAN,
+  };
+
+  //! Number of bands the normal exponent range is divided into.
+  static constexpr uint32_t kExponentBands = 8;
+
+ public:
+  //! `curated` values are drawn as-is, except that their sign is cleared if `allow_negative` is false.
+  StratifiedFloatGenerator(uint32_t classes, bool allow_negative, std::vector<float> curated = {});
+
+  //! Returns the next value, drawing the stratum order and the value within the stratum from `rng`.
+  float Next(CounterRng &rng);
+
+  //! Returns a value from the given stratum, without affecting the current round.
+  float NextInStratum(uint32_t stratum, CounterRng &rng);
+
+  //! Starts a new round so that the following draws do not depend on earlier ones.
+  void Reset() { next_ = static_cast<uint32_t>(order_.size()); }
+
+  uint32_t StrataCount() const { return static_cast<uint32_t>(strata_.size()); }
+
+ private:
+  enum Kind : uint8_t {
+    KIND_ZERO,
+    KIND_NORMAL,
+    KIND_SUBNORMAL,
+    KIND_INFINITY,
+    KIND_QUIET_NAN,
+    KIND_SIGNALING_NAN,
+    KIND_CURATED,
+  };
+
+  enum MantissaPattern : uint8_t {
+    MANTISSA_RANDOM,
+    MANTISSA_POWER_OF_TWO,
+    MANTISSA_ABOVE_POWER_OF_TWO,
+    MANTISSA_BELOW_POWER_OF_TWO,
+    MANTISSA_PATTERN_COUNT,
+  };
+
+  struct Stratum {
+    Kind kind;
+    uint8_t band;
+    MantissaPattern pattern;
+    bool negative;
+  };
+
+  static uint32_t BandFirstExponent(uint32_t band) { return 1 + band * 254 / kExponentBands; }
+  static uint32_t Mantissa(MantissaPattern pattern, bool subnormal, CounterRng &rng);
+
+  uint32_t Generate(const Stratum &stratum, CounterRng &rng) const;
+
+ private:
+  bool allow_negative_;
+  std::vector<float> curated_;
+  std::vector<Stratum> strata_;
+
+  // Shuffled indices into strata_ for the current round and the position of the next draw within it.
+  std::vector<uint32_t> order_;
+  uint32_t next_{0};
+};
+
+#endif  // NXDK_VSH_TESTS_STRATIFIED_FLOAT_GENERATOR_H
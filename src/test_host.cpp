@@ -13,13 +13,21 @@
 #include <algorithm>
 #include <utility>
 
+#include "content_hash.h"
 #include "debug_output.h"
+#include "gpu_watchdog.h"
+#include "heap_tracker.h"
 #include "nxdk_ext.h"
 #include "pbkit_ext.h"
 #include "pgraph_diff_token.h"
+#include "phase_timer.h"
 #include "pushbuffer.h"
+#include "result_archive.h"
+#include "result_uploader.h"
+#include "run_planner.h"
 #include "shaders/vertex_shader_program.h"
 #include "text_overlay.h"
+#include "trace_recorder.h"
 
 // clang format off
 static const uint32_t kClearStateShader[] = {
@@ -37,6 +45,14 @@ static const uint32_t kComputeFooter[] = {
 
 #define MAX_FILE_PATH_SIZE 248
 
+// Pushbuffer DWORDs used to upload a program: three setup commands, the load cursor and one command per instruction.
+static constexpr uint32_t kProgramUploadDwords = 4 * 2;
+static constexpr uint32_t kProgramInstructionDwords = 5;
+// Pushbuffer DWORDs submitted by the default Compute draw (two immediate mode quads and the stall) and by
+// ComputeWithVertexBuffer.
+static constexpr uint32_t kComputeDrawDwords = 2 * (2 + 4 * 5 + 2) + 3 * 2;
+static constexpr uint32_t kComputeWithVertexBufferDrawDwords = 6 * 2;
+
 // LOG_GET_CONSTANT
 #ifdef LOG_GET_CONSTANT
 #define GET_CONSTANT(var, idx)                                                                                      \
@@ -132,6 +148,16 @@ static void SetSurfaceFormat() {
   pb_end(p);
 }
 
+static void SetVertexBufferFormat(const float *vertex_buffer) {
+  auto p = pb_begin();
+  p = pb_push1(p, NV097_SET_VERTEX_DATA_ARRAY_FORMAT,
+               MASK(NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F) |
+                   MASK(NV097_SET_VERTEX_DATA_ARRAY_FORMAT_SIZE, 4) |
+                   MASK(NV097_SET_VERTEX_DATA_ARRAY_FORMAT_STRIDE, 16));
+  p = pb_push1(p, NV097_SET_VERTEX_DATA_ARRAY_OFFSET, VRAM_ADDR(vertex_buffer));
+  pb_end(p);
+}
+
 TestHost::TestHost() {
   SetSurfaceFormat();
 
@@ -166,15 +192,8 @@ TestHost::TestHost() {
     vertex_buffer_[i++] = 1.0f;
     vertex_buffer_[i++] = 1.0f;
 
-    auto p = pb_begin();
-    p = pb_push1(p, NV097_SET_VERTEX_DATA_ARRAY_FORMAT,
-                 MASK(NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE, NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_F) |
-                     MASK(NV097_SET_VERTEX_DATA_ARRAY_FORMAT_SIZE, 4) |
-                     MASK(NV097_SET_VERTEX_DATA_ARRAY_FORMAT_STRIDE, 16));
-    p = pb_push1(p, NV097_SET_VERTEX_DATA_ARRAY_OFFSET, VRAM_ADDR(vertex_buffer_));
-    pb_end(p);
+    SetVertexBufferFormat(vertex_buffer_);
   }
-
 }
 
 TestHost::~TestHost() {
@@ -231,7 +250,7 @@ static void fetch_constant(float *buffer, uint32_t index) {
   }
 }
 
-static void fetch_results(TestHost::Results &results) {
+void TestHost::FetchResults(Results &results) {
   for (uint32_t i = 0; i < 32; ++i) {
     if (results.results_mask & (1 << i)) {
       GET_CONSTANT(results.cOut[i], kOutputConstantBaseIndex + i);
@@ -239,91 +258,174 @@ static void fetch_results(TestHost::Results &results) {
   }
 }
 
-void TestHost::Compute(const std::list<Computation> &computations) {
-  static constexpr float kPatchSize = 16.0f;
+static void wait_and_fetch_results(TestHost::Results &results, const char *location) {
+  {
+    PhaseTimer::Scope timer(PhaseTimer::PHASE_IDLE_WAIT);
+    GpuWatchdog::WaitForIdle(location);
+  }
 
-  for (auto &comp : computations) {
-    auto shader = PrepareCalculation(comp.shader_code, comp.shader_size);
+  PhaseTimer::Scope timer(PhaseTimer::PHASE_READBACK);
+  TestHost::FetchResults(results);
+}
+
+void TestHost::PrepareComputation(const Computation &comp) {
+  std::shared_ptr<VertexShaderProgram> shader;
+  {
+    PhaseTimer::Scope timer(PhaseTimer::PHASE_PROGRAM_UPLOAD);
+    shader = PrepareCalculation(comp.shader_code, comp.shader_size);
+  }
+
+  {
+    PhaseTimer::Scope timer(PhaseTimer::PHASE_CONSTANT_UPLOAD);
     if (comp.prepare) {
       comp.prepare(shader);
     }
     shader->PrepareDraw();
+  }
+
+  // Only the structured results saved into the archive or upload stream use the hash. Kept outside of the phase timers
+  // so that it does not count as constant upload time.
+  if (ResultArchive::IsEnabled() || ResultUploader::IsEnabled()) {
+    comp.results->input_hash = HashInputs(shader);
+  }
+
+  PhaseTimer::Scope timer(PhaseTimer::PHASE_IDLE_WAIT);
+  GpuWatchdog::WaitForIdle(__func__);
+}
 
-    while (pb_busy()) {
+void TestHost::PlanComputations(const std::list<Computation> &computations, uint32_t draw_dwords) {
+  for (auto &comp : computations) {
+    ASSERT(comp.shader_size >= 4);
+    auto shader = std::make_shared<VertexShaderProgram>();
+    if (comp.prepare) {
+      comp.prepare(shader);
     }
 
-    if (comp.draw) {
-      comp.draw();
-    } else {
-      float left = 0.0f;
-      float top = 0.0f;
-
-      Begin(PRIMITIVE_QUADS);
-      SetVertex(left, 0.0, 0.0, 1.0);
-      SetVertex(left + kPatchSize, top, 0.0, 1.0);
-      SetVertex(left + kPatchSize, top + kPatchSize, 0.0, 1.0);
-      SetVertex(left, top + kPatchSize, 0.0, 1.0);
-      End();
-
-      left += kPatchSize;
-      Begin(PRIMITIVE_QUADS);
-      SetVertex(left, 0.0, 0.0, 1.0);
-      SetVertex(left + kPatchSize, top, 0.0, 1.0);
-      SetVertex(left + kPatchSize, top + kPatchSize, 0.0, 1.0);
-      SetVertex(left, top + kPatchSize, 0.0, 1.0);
-      End();
+    const uint32_t instructions = (comp.shader_size + sizeof(kComputeFooter)) / 16;
+    RunPlanner::RecordComputation(kProgramUploadDwords + instructions * kProgramInstructionDwords,
+                                  shader->PendingConstantCount(), shader->PendingConstantDwords(),
+                                  comp.draw ? 0 : draw_dwords, __builtin_popcount(comp.results->results_mask),
+                                  static_cast<bool>(comp.draw));
+  }
+}
+
+void TestHost::Compute(const std::list<Computation> &computations) {
+  static constexpr float kPatchSize = 16.0f;
+  if (dry_run_) {
+    PlanComputations(computations, kComputeDrawDwords);
+    return;
+  }
+
+  HeapTracker::HotPathScope hot_path(__func__);
+
+  const bool fired_before = GpuWatchdog::HasFired();
+  for (auto &comp : computations) {
+    // Once the GPU has been reset the results of the test are discarded, so the rest of the batch is not submitted.
+    if (GpuWatchdog::HasFired()) {
+      break;
     }
 
-    // Force inputs to be reloaded, may not be necessary for immediate mode commands.
-    Pushbuffer::Begin();
-    Pushbuffer::Push(NV097_BREAK_VERTEX_BUFFER_CACHE, 0);
-    Pushbuffer::Push(NV097_NO_OPERATION, 0);
-    Pushbuffer::Push(NV097_WAIT_FOR_IDLE, 0);
-    Pushbuffer::End();
+    TraceRecorder::Scope trace("compute", comp.results->title);
+    PrepareComputation(comp);
+    if (GpuWatchdog::HasFired()) {
+      break;
+    }
 
-    while (pb_busy()) {
+    {
+      PhaseTimer::Scope timer(PhaseTimer::PHASE_DRAW_SUBMIT);
+      if (comp.draw) {
+        comp.draw();
+      } else {
+        float left = 0.0f;
+        float top = 0.0f;
+
+        Begin(PRIMITIVE_QUADS);
+        SetVertex(left, 0.0, 0.0, 1.0);
+        SetVertex(left + kPatchSize, top, 0.0, 1.0);
+        SetVertex(left + kPatchSize, top + kPatchSize, 0.0, 1.0);
+        SetVertex(left, top + kPatchSize, 0.0, 1.0);
+        End();
+
+        left += kPatchSize;
+        Begin(PRIMITIVE_QUADS);
+        SetVertex(left, 0.0, 0.0, 1.0);
+        SetVertex(left + kPatchSize, top, 0.0, 1.0);
+        SetVertex(left + kPatchSize, top + kPatchSize, 0.0, 1.0);
+        SetVertex(left, top + kPatchSize, 0.0, 1.0);
+        End();
+      }
+
+      // Force inputs to be reloaded, may not be necessary for immediate mode commands.
+      Pushbuffer::Begin();
+      Pushbuffer::Push(NV097_BREAK_VERTEX_BUFFER_CACHE, 0);
+      Pushbuffer::Push(NV097_NO_OPERATION, 0);
+      Pushbuffer::Push(NV097_WAIT_FOR_IDLE, 0);
+      Pushbuffer::End();
     }
 
-    fetch_results(*comp.results);
+    wait_and_fetch_results(*comp.results, __func__);
+  }
+
+  if (GpuWatchdog::HasFired() && !fired_before) {
+    RestoreState();
   }
 }
 
 void TestHost::ComputeWithVertexBuffer(const std::list<Computation> &computations) {
+  if (dry_run_) {
+    PlanComputations(computations, kComputeWithVertexBufferDrawDwords);
+    return;
+  }
+
+  HeapTracker::HotPathScope hot_path(__func__);
+  const bool fired_before = GpuWatchdog::HasFired();
   for (auto &comp : computations) {
+    if (GpuWatchdog::HasFired()) {
+      break;
+    }
+
     assert(!comp.draw && "ComputeWithVertexBuffer must not be called with a draw override.");
     PrintMsg("Prepare calc in ComputeWithVertexBuffer\n");
-    auto shader = PrepareCalculation(comp.shader_code, comp.shader_size);
-    if (comp.prepare) {
-      comp.prepare(shader);
+    TraceRecorder::Scope trace("compute", comp.results->title);
+    PrepareComputation(comp);
+    if (GpuWatchdog::HasFired()) {
+      break;
     }
-    shader->PrepareDraw();
 
-    while (pb_busy()) {
+    {
+      PhaseTimer::Scope timer(PhaseTimer::PHASE_DRAW_SUBMIT);
+      Pushbuffer::Begin();
+      // Force inputs to be reloaded.
+      Pushbuffer::Push(NV097_BREAK_VERTEX_BUFFER_CACHE, 0);
+
+      Pushbuffer::Push(NV097_SET_BEGIN_END, NV097_SET_BEGIN_END_OP_QUADS);
+      Pushbuffer::Push(NV2A_SUPPRESS_COMMAND_INCREMENT(NV097_DRAW_ARRAYS),
+                       MASK(NV097_DRAW_ARRAYS_COUNT, 3) | MASK(NV097_DRAW_ARRAYS_START_INDEX, 0));
+      Pushbuffer::Push(NV097_SET_BEGIN_END, NV097_SET_BEGIN_END_OP_END);
+
+      // Stall for output.
+      Pushbuffer::Push(NV097_NO_OPERATION, 0);
+      Pushbuffer::Push(NV097_WAIT_FOR_IDLE, 0);
+      Pushbuffer::End();
     }
 
-    auto p = pb_begin();
-    // Force inputs to be reloaded.
-    p = pb_push1(p, NV097_BREAK_VERTEX_BUFFER_CACHE, 0);
-
-    p = pb_push1(p, NV097_SET_BEGIN_END, NV097_SET_BEGIN_END_OP_QUADS);
-    p = pb_push1(p, NV2A_SUPPRESS_COMMAND_INCREMENT(NV097_DRAW_ARRAYS),
-                 MASK(NV097_DRAW_ARRAYS_COUNT, 3) | MASK(NV097_DRAW_ARRAYS_START_INDEX, 0));
-    p = pb_push1(p, NV097_SET_BEGIN_END, NV097_SET_BEGIN_END_OP_END);
-
-    // Stall for output.
-    p = pb_push1(p, NV097_NO_OPERATION, 0);
-    p = pb_push1(p, NV097_WAIT_FOR_IDLE, 0);
-    pb_end(p);
-
-    while (pb_busy()) {
-    }
+    wait_and_fetch_results(*comp.results, __func__);
+  }
 
-    fetch_results(*comp.results);
+  if (GpuWatchdog::HasFired() && !fired_before) {
+    RestoreState();
   }
 }
 
 void TestHost::DrawResults(const std::list<Results> &results, bool allow_saving, const std::string &output_directory,
                            const std::string &name) {
+  if (dry_run_) {
+    if (allow_saving && save_results_) {
+      RunPlanner::RecordImage();
+    }
+    return;
+  }
+
   pb_wait_for_vbl();
   pb_reset();
 
@@ -355,36 +457,45 @@ void TestHost::DrawResults(const std::list<Results> &results, bool allow_saving,
     }
   }
 
-  bool perform_save = allow_saving && save_results_;
+  // Results computed across a GPU reset are meaningless, so never save them as if they were real.
+  if (GpuWatchdog::HasFired()) {
+    TextOverlay::Print("WATCHDOG: GPU hang detected, results discarded\n");
+  }
+  bool perform_save = allow_saving && save_results_ && !GpuWatchdog::HasFired();
   if (!perform_save) {
     TextOverlay::PrintAt(0, 55, (char *)"ns");
   }
 
-  TextOverlay::Render();
+  {
+    PhaseTimer::Scope timer(PhaseTimer::PHASE_OVERLAY_RENDER);
+    TextOverlay::Render();
+  }
 
   if (perform_save) {
     // TODO: See why waiting for tiles to be non-busy results in the screen not updating anymore.
     // In theory this should wait for all tiles to be rendered before capturing.
     pb_wait_for_vbl();
 
+    PhaseTimer::Scope timer(PhaseTimer::PHASE_SAVE);
     SaveBackBuffer(output_directory, name);
+    SaveResults(results, output_directory, name);
   }
 
-  while (pb_finished()) {
-  }
+  GpuWatchdog::WaitForFlip(__func__);
 
   SetVertexShaderProgram(shader);
 }
 
 std::shared_ptr<VertexShaderProgram> TestHost::PrepareCalculation(const uint32_t *shader_code, uint32_t shader_size) {
   ASSERT(shader_size >= 4);
-  if (shader_code_) {
+  // The buffer only grows so that repeated computations do not allocate.
+  shader_code_size_ = shader_size + sizeof(kComputeFooter);
+  if (shader_code_size_ > shader_code_capacity_) {
     delete[] shader_code_;
+    shader_code_capacity_ = shader_code_size_;
+    shader_code_ = new uint32_t[shader_code_capacity_ / 4];
   }
 
-  shader_code_size_ = shader_size + sizeof(kComputeFooter);
-  shader_code_ = new uint32_t[shader_code_size_];
-
   memcpy(shader_code_, shader_code, shader_size);
 
   uint32_t end_offset = shader_size / 4;
@@ -401,9 +512,12 @@ std::shared_ptr<VertexShaderProgram> TestHost::PrepareCalculation(const uint32_t
   return shader;
 }
 
-void TestHost::SaveBackBuffer(const std::string &output_directory, const std::string &name) {
-  auto target_file = PrepareSaveFile(output_directory, name);
+uint64_t TestHost::HashInputs(const std::shared_ptr<VertexShaderProgram> &shader) const {
+  auto hash = ContentHash(shader_code_, shader_code_size_);
+  return shader->HashUniforms(hash);
+}
 
+void TestHost::SaveBackBuffer(const std::string &output_directory, const std::string &name) {
   auto buffer = pb_agp_access(pb_back_buffer());
   auto width = static_cast<int>(pb_back_buffer_width());
   auto height = static_cast<int>(pb_back_buffer_height());
@@ -412,15 +526,10 @@ void TestHost::SaveBackBuffer(const std::string &output_directory, const std::st
   // FIXME: Support 16bpp surfaces
   ASSERT((pitch == width * 4) && "Expected packed 32bpp surface");
 
-  // Swizzle color channels ARGB -> OBGR
   unsigned int num_pixels = width * height;
   uint32_t *pre_enc_buf = (uint32_t *)malloc(num_pixels * 4);
   ASSERT(pre_enc_buf && "Failed to allocate pre-encode buffer");
-  uint32_t full_alpha = 0xFF000000;
-  for (unsigned int i = 0; i < num_pixels; i++) {
-    uint32_t c = static_cast<uint32_t *>(buffer)[i];
-    pre_enc_buf[i] = (c & 0xff00ff00) | ((c >> 16) & 0xff) | ((c & 0xff) << 16) | full_alpha;
-  }
+  ConvertToRGBA(static_cast<uint32_t *>(buffer), pre_enc_buf, num_pixels);
 
   std::vector<uint8_t> out_buf;
   if (!fpng::fpng_encode_image_to_memory((void *)pre_enc_buf, width, height, 4, out_buf)) {
@@ -428,6 +537,17 @@ void TestHost::SaveBackBuffer(const std::string &output_directory, const std::st
   }
   free(pre_enc_buf);
 
+  if (ResultUploader::IsEnabled()) {
+    ResultUploader::Enqueue(FolderName(output_directory), name + ".png", out_buf.data(), out_buf.size());
+  }
+
+  if (ResultArchive::IsEnabled()) {
+    ResultArchive::Write(ResultArchive::PAYLOAD_PNG, FolderName(output_directory), name, out_buf.data(),
+                         out_buf.size());
+    return;
+  }
+
+  auto target_file = PrepareSaveFile(output_directory, name);
   FILE *pFile = fopen(target_file.c_str(), "wb");
   ASSERT(pFile && "Failed to open output PNG image");
   if (fwrite(out_buf.data(), 1, out_buf.size(), pFile) != out_buf.size()) {
@@ -438,16 +558,81 @@ void TestHost::SaveBackBuffer(const std::string &output_directory, const std::st
   }
 }
 
+void TestHost::ConvertToRGBA(const uint32_t *argb, uint32_t *rgba, uint32_t num_pixels) {
+  // Swizzle color channels ARGB -> OBGR
+  static constexpr uint32_t kFullAlpha = 0xFF000000;
+  for (uint32_t i = 0; i < num_pixels; i++) {
+    uint32_t c = argb[i];
+    rgba[i] = (c & 0xff00ff00) | ((c >> 16) & 0xff) | ((c & 0xff) << 16) | kFullAlpha;
+  }
+}
+
+static void append_u32(std::vector<uint8_t> &buffer, uint32_t value) {
+  const auto bytes = reinterpret_cast<const uint8_t *>(&value);
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+}
+
+void TestHost::SaveResults(const std::list<Results> &results, const std::string &output_directory,
+                           const std::string &name) {
+  // Structured results are only emitted into the archive or upload stream, writing an extra file per test would defeat
+  // the purpose of the archive.
+  if (!ResultArchive::IsEnabled() && !ResultUploader::IsEnabled()) {
+    return;
+  }
+
+  // Payload layout:
+  //   u32 version, u32 num_results
+  //   { u32 title_length, title, u32 input_hash_low, u32 input_hash_high, u32 results_mask,
+  //     { u32 x, u32 y, u32 z, u32 w } for each bit in results_mask }*
+  std::vector<uint8_t> payload;
+  append_u32(payload, kResultsPayloadVersion);
+  append_u32(payload, results.size());
+
+  for (auto &result : results) {
+    append_u32(payload, result.title.size());
+    payload.insert(payload.end(), result.title.begin(), result.title.end());
+    append_u32(payload, static_cast<uint32_t>(result.input_hash));
+    append_u32(payload, static_cast<uint32_t>(result.input_hash >> 32));
+    append_u32(payload, result.results_mask);
+
+    for (uint32_t i = 0; i < 32; ++i) {
+      if (result.results_mask & (1 << i)) {
+        const auto values = reinterpret_cast<const uint32_t *>(result.cOut[i]);
+        for (uint32_t component = 0; component < 4; ++component) {
+          append_u32(payload, values[component]);
+        }
+      }
+    }
+  }
+
+  if (ResultUploader::IsEnabled()) {
+    ResultUploader::Enqueue(FolderName(output_directory), name + ".results", payload.data(), payload.size());
+  }
+
+  if (ResultArchive::IsEnabled()) {
+    ResultArchive::Write(ResultArchive::PAYLOAD_RESULTS, FolderName(output_directory), name, payload.data(),
+                         payload.size());
+  }
+}
+
+std::string TestHost::FolderName(const std::string &path) {
+  auto separator = path.find_last_of("\\/");
+  if (separator == std::string::npos) {
+    return path;
+  }
+  return path.substr(separator + 1);
+}
+
 void TestHost::Begin(DrawPrimitive primitive) const {
-  auto p = pb_begin();
-  p = pb_push1(p, NV097_SET_BEGIN_END, primitive);
-  pb_end(p);
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_BEGIN_END, primitive);
+  Pushbuffer::End();
 }
 
 void TestHost::End() const {
-  auto p = pb_begin();
-  p = pb_push1(p, NV097_SET_BEGIN_END, NV097_SET_BEGIN_END_OP_END);
-  pb_end(p);
+  Pushbuffer::Begin();
+  Pushbuffer::Push(NV097_SET_BEGIN_END, NV097_SET_BEGIN_END_OP_END);
+  Pushbuffer::End();
 }
 
 void TestHost::SetVertex(float x, float y, float z) const {
@@ -457,9 +642,9 @@ void TestHost::SetVertex(float x, float y, float z) const {
 }
 
 void TestHost::SetVertex(float x, float y, float z, float w) const {
-  auto p = pb_begin();
-  p = pb_push4f(p, NV097_SET_VERTEX4F, x, y, z, w);
-  pb_end(p);
+  Pushbuffer::Begin();
+  Pushbuffer::PushF(NV097_SET_VERTEX4F, x, y, z, w);
+  Pushbuffer::End();
 }
 
 void TestHost::SetWeight(float w1, float w2, float w3, float w4) const {
@@ -965,6 +1150,12 @@ void TestHost::SetFinalCombinerFactorC1(float red, float green, float blue, floa
   SetFinalCombinerFactorC1(TO_BGRA(rgba));
 }
 
+void TestHost::RestoreState() {
+  SetSurfaceFormat();
+  SetVertexBufferFormat(vertex_buffer_);
+  ClearState();
+}
+
 void TestHost::ClearState() {
   auto p = pb_begin();
   p = pb_push1(p, NV097_SET_LIGHTING_ENABLE, false);
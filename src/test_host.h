@@ -38,6 +38,9 @@ constexpr uint32_t kNoStrideOverride = 0xFFFFFFFF;
 //! The index of the first result in the vsh constants array.
 constexpr uint32_t kOutputConstantBaseIndex = 188;
 
+//! Version of the structured results payload written into the result archive.
+constexpr uint32_t kResultsPayloadVersion = 2;
+
 // Defines which fields in a TestHost::Results should be displayed.
 constexpr uint32_t RES_0 = 1 << 0;
 constexpr uint32_t RES_1 = 1 << 1;
@@ -53,6 +56,10 @@ class TestHost {
     uint32_t results_mask;
     XboxMath::vector_t cOut[32]{{0.0f}};
 
+    // ContentHash of the shader microcode and constant inputs that produced this result. Inputs provided through a
+    // Computation::draw override are not included. Left 0 unless the result archive or FTP upload is enabled.
+    uint64_t input_hash{0};
+
     std::map<uint32_t, std::string> result_labels;
 
     explicit Results(std::string title, uint32_t results_mask = RES_0,
@@ -208,12 +215,24 @@ class TestHost {
   void DrawResults(const std::list<Results> &results, bool allow_saving, const std::string &output_directory,
                    const std::string &name);
 
+  //! Patches the given shader with the compute footer and activates it. Exposed for benchmarking.
+  std::shared_ptr<VertexShaderProgram> PrepareCalculation(const uint32_t *shader_code, uint32_t shader_size);
+
+  //! Reads the output constants selected by `results.results_mask` back from the GPU via RDI.
+  static void FetchResults(Results &results);
+
+  //! Converts `num_pixels` framebuffer pixels from ARGB to the RGBA byte order expected by fpng.
+  static void ConvertToRGBA(const uint32_t *argb, uint32_t *rgba, uint32_t num_pixels);
+
   void SetVertexShaderProgram(std::shared_ptr<VertexShaderProgram> program);
   [[nodiscard]] std::shared_ptr<VertexShaderProgram> GetShaderProgram() const { return vertex_shader_program_; }
 
   // Clear all vertex shaders registers to known values.
   void ClearState();
 
+  // Reapplies the surface, vertex buffer and ClearState setup, e.g., after the GPU watchdog reset pbkit.
+  void RestoreState();
+
   // Start the process of rendering an inline-defined primitive (specified via SetXXXX methods below).
   // Note that End() must be called to trigger rendering, and that SetVertex() triggers the creation of a vertex.
   void Begin(DrawPrimitive primitive) const;
@@ -258,7 +277,14 @@ class TestHost {
   bool GetSaveResults() const { return save_results_; }
   void SetSaveResults(bool enable = true) { save_results_ = enable; }
 
+  //! In dry-run mode computations are counted by RunPlanner instead of being submitted and results are not rendered.
+  bool IsDryRun() const { return dry_run_; }
+  void SetDryRun(bool enable = true) { dry_run_ = enable; }
+
   static void EnsureFolderExists(const std::string &folder_path);
+  //! Ensures that `output_directory` exists and returns the path of `filename` + `ext` within it.
+  static std::string PrepareSaveFile(std::string output_directory, const std::string &filename,
+                                     const std::string &ext = ".png");
 
   void Clear(uint32_t argb = 0xFF000000, uint32_t depth_value = 0xFFFFFFFF, uint8_t stencil_value = 0x00) const;
   void ClearDepthStencilRegion(uint32_t depth_value, uint8_t stencil_value, uint32_t left = 0, uint32_t top = 0,
@@ -267,10 +293,21 @@ class TestHost {
                         uint32_t height = 0) const;
 
  private:
-  std::shared_ptr<VertexShaderProgram> PrepareCalculation(const uint32_t *shader_code, uint32_t shader_size);
+  // Uploads the program and constants for the given computation and waits for the GPU to be ready to draw.
+  void PrepareComputation(const Computation &comp);
+  // Reports the work the given computations would submit to RunPlanner, assuming `draw_dwords` for each default draw.
+  static void PlanComputations(const std::list<Computation> &computations, uint32_t draw_dwords);
+  [[nodiscard]] uint64_t HashInputs(const std::shared_ptr<VertexShaderProgram> &shader) const;
 
   void SaveBackBuffer(const std::string &output_directory, const std::string &name);
 
+  // Serializes the given results into the result archive, if one is active.
+  static void SaveResults(const std::list<Results> &results, const std::string &output_directory,
+                          const std::string &name);
+
+  // Returns the final component of the given path (e.g., the per-suite output folder name).
+  static std::string FolderName(const std::string &path);
+
   // Sets up the number of enabled color combiners and behavior flags.
   //
   // same_factor0 == true will reuse the C0 constant across all enabled stages.
@@ -349,8 +386,6 @@ class TestHost {
   void SetFinalCombinerFactorC1(uint32_t value) const;
   void SetFinalCombinerFactorC1(float red, float green, float blue, float alpha) const;
 
-  static std::string PrepareSaveFile(std::string output_directory, const std::string &filename,
-                                     const std::string &ext = ".png");
   uint32_t MakeInputCombiner(CombinerSource a_source, bool a_alpha, CombinerMapping a_mapping, CombinerSource b_source,
                              bool b_alpha, CombinerMapping b_mapping, CombinerSource c_source, bool c_alpha,
                              CombinerMapping c_mapping, CombinerSource d_source, bool d_alpha,
@@ -361,10 +396,12 @@ class TestHost {
  private:
   std::shared_ptr<VertexShaderProgram> vertex_shader_program_{};
   bool save_results_{true};
+  bool dry_run_{false};
 
   uint8_t *compute_buffer_{nullptr};
   uint32_t *shader_code_{nullptr};
   uint32_t shader_code_size_{0};
+  uint32_t shader_code_capacity_{0};
 
   float *vertex_buffer_{nullptr};
 };
@@ -0,0 +1,170 @@
+#include "test_sharder.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+
+#include "debug_output.h"
+#include "tests/test_suite.h"
+
+static std::string test_key(const std::string &suite, const std::string &test) { return suite + "::" + test; }
+
+static bool parse_positive(const char *start, const char **end, uint32_t &value) {
+  char *parse_end;
+  auto parsed = strtoul(start, &parse_end, 10);
+  if (parse_end == start || !parsed) {
+    return false;
+  }
+  value = parsed;
+  *end = parse_end;
+  return true;
+}
+
+bool TestSharder::ParseSpec(const std::string &spec, uint32_t &shard_index, uint32_t &shard_count) {
+  const char *cursor = spec.c_str();
+  uint32_t index, count;
+  if (!parse_positive(cursor, &cursor, index) || *cursor != '/' || !parse_positive(cursor + 1, &cursor, count)) {
+    return false;
+  }
+  if (*cursor || index > count) {
+    return false;
+  }
+
+  shard_index = index;
+  shard_count = count;
+  return true;
+}
+
+bool TestSharder::ParsePath(const std::string &path, uint32_t &shard_index, uint32_t &shard_count) {
+  std::string lower = path;
+  std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+
+  auto skip_separator = [](const char *cursor) { return (*cursor == '_' || *cursor == '-') ? cursor + 1 : cursor; };
+
+  // The last match wins so that the XBE name takes precedence over any of its parent directories.
+  bool found = false;
+  for (auto pos = lower.find("shard"); pos != std::string::npos; pos = lower.find("shard", pos + 1)) {
+    const char *cursor = skip_separator(lower.c_str() + pos + 5);
+    uint32_t index, count;
+    if (!parse_positive(cursor, &cursor, index)) {
+      continue;
+    }
+    cursor = skip_separator(cursor);
+    if (strncmp(cursor, "of", 2) != 0) {
+      continue;
+    }
+    cursor = skip_separator(cursor + 2);
+    if (!parse_positive(cursor, &cursor, count) || index > count) {
+      continue;
+    }
+
+    shard_index = index;
+    shard_count = count;
+    found = true;
+  }
+
+  return found;
+}
+
+std::string TestSharder::FolderName() const {
+  return "shard_" + std::to_string(shard_index_) + "_of_" + std::to_string(shard_count_);
+}
+
+bool TestSharder::LoadDurations(const std::string &path) { return ReadDurations(path, durations_); }
+
+bool TestSharder::ReadDurations(const std::string &path, std::map<std::string, uint32_t> &durations) {
+  std::ifstream durations_file(path.c_str());
+  if (!durations_file) {
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(durations_file, line)) {
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+    auto separator = line.find(' ');
+    if (separator == std::string::npos) {
+      continue;
+    }
+    durations[line.substr(separator + 1)] = strtoul(line.c_str(), nullptr, 10);
+  }
+
+  PrintMsg("Loaded %d test durations from %s\n", static_cast<int>(durations.size()), path.c_str());
+  return true;
+}
+
+uint32_t TestSharder::MedianDuration(const std::map<std::string, uint32_t> &durations) {
+  if (durations.empty()) {
+    return kDefaultDurationMilliseconds;
+  }
+
+  std::vector<uint32_t> known;
+  known.reserve(durations.size());
+  for (auto &kv : durations) {
+    known.push_back(kv.second);
+  }
+  std::nth_element(known.begin(), known.begin() + known.size() / 2, known.end());
+  return known[known.size() / 2];
+}
+
+void TestSharder::Apply(std::vector<std::shared_ptr<TestSuite>> &test_suites) const {
+  ASSERT(shard_index_ >= 1 && shard_index_ <= shard_count_ && "Invalid shard index");
+
+  struct Job {
+    std::string key;
+    uint32_t duration;
+  };
+  std::vector<Job> jobs;
+
+  const uint32_t default_duration = MedianDuration(durations_);
+
+  for (auto &suite : test_suites) {
+    for (auto &test : suite->TestNames()) {
+      auto key = test_key(suite->Name(), test);
+      auto duration = durations_.find(key);
+      jobs.push_back({key, duration == durations_.end() ? default_duration : duration->second});
+    }
+  }
+
+  // Longest processing time first, with ties broken by name so that every console computes the same partition.
+  std::sort(jobs.begin(), jobs.end(), [](const Job &a, const Job &b) {
+    if (a.duration != b.duration) {
+      return a.duration > b.duration;
+    }
+    return a.key < b.key;
+  });
+
+  std::vector<uint64_t> loads(shard_count_, 0);
+  std::set<std::string> assigned;
+  for (auto &job : jobs) {
+    auto target = std::min_element(loads.begin(), loads.end()) - loads.begin();
+    loads[target] += job.duration;
+    if (target == shard_index_ - 1) {
+      assigned.insert(job.key);
+    }
+  }
+
+  std::vector<std::shared_ptr<TestSuite>> filtered_suites;
+  for (auto &suite : test_suites) {
+    std::vector<std::string> tests_to_skip;
+    for (auto &test : suite->TestNames()) {
+      if (!assigned.count(test_key(suite->Name(), test))) {
+        tests_to_skip.push_back(test);
+      }
+    }
+
+    suite->DisableTests(tests_to_skip);
+    if (!suite->TestNames().empty()) {
+      filtered_suites.push_back(suite);
+    }
+  }
+
+  PrintMsg("Shard %d of %d: running %d of %d tests, estimated %lums\n", shard_index_, shard_count_,
+           static_cast<int>(assigned.size()), static_cast<int>(jobs.size()),
+           static_cast<unsigned long>(loads[shard_index_ - 1]));
+  test_suites = filtered_suites;
+}
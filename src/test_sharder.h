@@ -0,0 +1,54 @@
+#ifndef NXDK_VSH_TESTS_TEST_SHARDER_H
+#define NXDK_VSH_TESTS_TEST_SHARDER_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class TestSuite;
+
+//! Deterministically partitions every (suite, test) pair across `shard_count` consoles.
+//!
+//! Tests are assigned longest-first to the least loaded shard using durations from previous runs (see
+//! scripts/shard_durations.py), so every console given the same inputs computes the same partition and the shards take
+//! roughly the same amount of time. Tests without a recorded duration are assumed to take the median recorded time.
+class TestSharder {
+ public:
+  //! Duration assumed for every test if no history is available at all.
+  static constexpr uint32_t kDefaultDurationMilliseconds = 1000;
+
+ public:
+  //! `shard_index` is 1-based.
+  TestSharder(uint32_t shard_index, uint32_t shard_count) : shard_index_(shard_index), shard_count_(shard_count) {}
+
+  //! Parses a shard specification of the form "<index>/<count>", e.g. "2/4".
+  static bool ParseSpec(const std::string &spec, uint32_t &shard_index, uint32_t &shard_count);
+
+  //! Searches the given path (e.g., the launch path of the XBE) for a specification of the form "shard<index>of<count>"
+  //! (case insensitive, optionally separated by '_' or '-'), e.g. "nxdk_vsh_tests_shard2of4.xbe".
+  static bool ParsePath(const std::string &path, uint32_t &shard_index, uint32_t &shard_count);
+
+  //! Returns the name of the folder into which this shard's output should be written, e.g. "shard_2_of_4".
+  std::string FolderName() const;
+
+  //! Loads historical durations from a file containing lines of the form "<milliseconds> <suite>::<test>".
+  bool LoadDurations(const std::string &path);
+
+  //! Reads a durations file (see LoadDurations) into a map of "<suite>::<test>" to milliseconds.
+  static bool ReadDurations(const std::string &path, std::map<std::string, uint32_t> &durations);
+
+  //! Returns the median of the given durations, which is assumed for tests without history.
+  static uint32_t MedianDuration(const std::map<std::string, uint32_t> &durations);
+
+  //! Disables every test that is not assigned to this shard and removes suites that have no remaining tests.
+  void Apply(std::vector<std::shared_ptr<TestSuite>> &test_suites) const;
+
+ private:
+  uint32_t shard_index_;
+  uint32_t shard_count_;
+  std::map<std::string, uint32_t> durations_;
+};
+
+#endif  // NXDK_VSH_TESTS_TEST_SHARDER_H
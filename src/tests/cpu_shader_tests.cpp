@@ -2,15 +2,29 @@
 
 #include <pbkit/pbkit.h>
 
+#include <algorithm>
 #include <cfloat>
+#include <cstring>
+#include <fstream>
 
 #include "../test_host.h"
 #include "SDL_stdinc.h"
-#include "SDL_test_fuzzer.h"
+#include "adaptive_sampler.h"
 #include "compareasint/compare_as_int.h"
+#include "configure.h"
+#include "counter_rng.h"
 #include "debug_output.h"
+#include "float_math.h"
+#include "gpu_watchdog.h"
+#include "ilu_table_model.h"
+#include "input_shrinker.h"
+#include "logger.h"
+#include "phase_timer.h"
 #include "pbkit_ext.h"
+#include "progress_journal.h"
+#include "result_archive.h"
 #include "shaders/vertex_shader_program.h"
+#include "stratified_float_generator.h"
 #include "text_overlay.h"
 
 static constexpr int kUnitsInLastPlace = 4;
@@ -22,9 +36,26 @@ static constexpr int kUnitsInLastPlaceLowPrecision = 0x200;
 
 //#define USE_FUZZ
 
+// Also record passing comparisons in the mismatch log, e.g., to compare every result against scripts/exact_oracle.py.
+//#define LOG_ALL_COMPARISONS
+
+#ifdef USE_EXCEPTIONAL_VALUES
+static constexpr uint32_t kInputClasses = StratifiedFloatGenerator::CLASS_ALL;
+#else
+static constexpr uint32_t kInputClasses = StratifiedFloatGenerator::CLASS_FINITE;
+#endif
+
+// Random batches per opcode, see AdaptiveSampler. Setting min_batches equal to max_batches gives a fixed budget.
+static constexpr AdaptiveSampler::Budget kSamplingBudget = {8, 64, 0.005f, 0.02f};
+
 static constexpr uint32_t kNumIterations = 32;
 static constexpr uint32_t kIterationsPerFrame = 32;
 
+static constexpr const char *kMismatchLogFileName = "mismatches";
+static constexpr const char *kMismatchSummaryFileName = "mismatch_summary";
+static constexpr const char *kUlpHistogramFileName = "ulp_histogram";
+static constexpr const char *kShrunkInputsFileName = "shrunk_inputs";
+
 static const uint32_t kExceptionalValues[] = {
     kPosInfInt, kNegInfInt, kPosNaNQInt,         kNegNaNQInt,         kPosMaxInt,          kNegMaxInt,
     kPosMinInt, kNegMinInt, kPosMaxSubnormalInt, kNegMaxSubnormalInt, kPosMinSubnormalInt, kNegMinSubnormalInt,
@@ -116,8 +147,7 @@ CpuShaderTests::CpuShaderTests(TestHost &host, std::string output_dir)
     : TestSuite(host, std::move(output_dir), "CPU Shader Tests") {
   tests_["EXP"] = [this]() { TestExp(); };
   tests_["LIT"] = [this]() { TestLit(); };
-  // Asserts due to lack of log2f in nxdk.
-  //  tests_["LOG"] = [this]() { TestLog(); };
+  tests_["LOG"] = [this]() { TestLog(); };
   tests_["RCC"] = [this]() { TestRcc(); };
   tests_["RCP"] = [this]() { TestRcp(); };
   tests_["RSQ"] = [this]() { TestRsq(); };
@@ -149,6 +179,83 @@ void CpuShaderTests::Initialize() {
     test_values_.emplace_back(val);
     test_values_.emplace_back(-1.0f * val);
   }
+
+#ifdef ENABLE_MISMATCH_LOG
+  if (allow_saving_) {
+    // A resumed run keeps the records and counts of the attempts before it, so the log covers the whole run.
+    const bool resuming = ProgressJournal::IsResuming();
+    mismatch_log_ = std::make_unique<MismatchLog>(TestHost::PrepareSaveFile(output_dir_, kMismatchLogFileName, ".bin"),
+                                                  resuming);
+    if (resuming) {
+      mismatch_log_->LoadSummary(TestHost::PrepareSaveFile(output_dir_, kMismatchSummaryFileName, ".csv"));
+    }
+  }
+#endif
+
+#ifdef ENABLE_ULP_HISTOGRAMS
+  if (allow_saving_) {
+    ulp_histogram_ = std::make_unique<UlpHistogram>();
+  }
+#endif
+
+#ifdef ENABLE_INPUT_SHRINKING
+  shrink_inputs_ = true;
+  shrunk_inputs_.clear();
+#endif
+
+#ifdef ILU_TABLE_PATH
+  ilu_table_.Load(ILU_TABLE_PATH);
+#endif
+}
+
+void CpuShaderTests::Deinitialize() {
+  auto folder = output_dir_.substr(output_dir_.find_last_of('\\') + 1);
+
+  if (ulp_histogram_) {
+    auto histogram_file = TestHost::PrepareSaveFile(output_dir_, kUlpHistogramFileName, ".csv");
+    ulp_histogram_->WriteCSV(histogram_file);
+    ulp_histogram_.reset();
+    if (ResultArchive::IsEnabled()) {
+      ResultArchive::AppendFile(ResultArchive::PAYLOAD_LOG, folder, std::string(kUlpHistogramFileName) + ".csv",
+                                histogram_file);
+    }
+  }
+
+  if (allow_saving_ && !shrunk_inputs_.empty()) {
+    auto shrunk_file = TestHost::PrepareSaveFile(output_dir_, kShrunkInputsFileName, ".txt");
+    std::ofstream shrunk(shrunk_file.c_str(), std::ios_base::out | std::ios_base::trunc);
+    for (auto &entry : shrunk_inputs_) {
+      shrunk << entry << "\n";
+    }
+    shrunk.close();
+    if (ResultArchive::IsEnabled()) {
+      ResultArchive::AppendFile(ResultArchive::PAYLOAD_LOG, folder, std::string(kShrunkInputsFileName) + ".txt",
+                                shrunk_file);
+    }
+  }
+  shrunk_inputs_.clear();
+
+  if (!mismatch_log_) {
+    return;
+  }
+
+  auto summary_file = TestHost::PrepareSaveFile(output_dir_, kMismatchSummaryFileName, ".csv");
+  mismatch_log_->WriteSummary(summary_file);
+  for (auto &item : mismatch_log_->Summary()) {
+    PrintMsg("%s: %u of %u mismatched\n", item.first.c_str(), item.second.mismatches, item.second.tests);
+#ifdef ENABLE_PROGRESS_LOG
+    Logger::Log() << "  " << item.first << ": " << item.second.mismatches << " of " << item.second.tests
+                  << " mismatched" << std::endl;
+#endif
+  }
+  mismatch_log_.reset();
+
+  if (ResultArchive::IsEnabled()) {
+    ResultArchive::AppendFile(ResultArchive::PAYLOAD_LOG, folder, std::string(kMismatchLogFileName) + ".bin",
+                              TestHost::PrepareSaveFile(output_dir_, kMismatchLogFileName, ".bin"));
+    ResultArchive::AppendFile(ResultArchive::PAYLOAD_LOG, folder, std::string(kMismatchSummaryFileName) + ".csv",
+                              summary_file);
+  }
 }
 
 static void print_result_diff(const float *hw_result, const float *cpu_result) {
@@ -252,41 +359,116 @@ static bool almost_equal(const float *cpu_result, const float *hw_result, int ul
   return true;
 }
 
-static bool TestBatch(TestHost &host, const char *name, uint32_t num_inputs, const uint32_t *shader,
-                      uint32_t shader_size, const std::function<void(float *, const float *)> &cpu_op,
-                      const std::list<std::vector<float>> &inputs, uint32_t *num_successes, uint32_t *num_tests,
-                      bool low_precision) {
-  std::list<TestHost::Results> results;
+//! Returns the ULP tolerance of comparisons made with the given TestFlags.
+static int tolerance_ulps(uint32_t flags) {
+  if (flags & CpuShaderTests::CPUTF_BIT_EXACT) {
+    return 0;
+  }
+  return (flags & CpuShaderTests::CPUTF_LOW_PRECISION) ? kUnitsInLastPlaceLowPrecision : kUnitsInLastPlace;
+}
 
-  {
-    int j = 0;
-    std::list<TestHost::Computation> computations;
-    for (auto &input_set : inputs) {
-      ASSERT(input_set.size() == num_inputs * 4);
-      auto prepare = [j, input_set](const std::shared_ptr<VertexShaderProgram> &shader) {
+//! Returns the largest UlpHistogram::Bucket across the lanes that almost_equal compares by ULPs.
+static uint32_t max_ulp_bucket(const float *cpu_result, const float *hw_result) {
+  uint32_t ret = 0;
+  for (uint32_t i = 0; i < 4; ++i) {
+    uint32_t hw_int = *(uint32_t *)&hw_result[i];
+    if (!hw_int || hw_int == 0x80000000) {
+      continue;
+    }
+    ret = std::max(ret, UlpHistogram::Bucket(cpu_result[i], hw_result[i]));
+  }
+  return ret;
+}
+
+static void compute_results(TestHost &host, const uint32_t *shader, uint32_t shader_size, uint32_t num_inputs,
+                            const std::list<std::vector<float>> &inputs, std::list<TestHost::Results> &results) {
+  int j = 0;
+  std::list<TestHost::Computation> computations;
+  for (auto &input_set : inputs) {
+    ASSERT(input_set.size() == num_inputs * 4);
+    auto prepare = [j, input_set](const std::shared_ptr<VertexShaderProgram> &shader) {
 #ifdef LOG_VERBOSE
-        PrintMsg("HW INPUTS[%d]:\n", j);
+      PrintMsg("HW INPUTS[%d]:\n", j);
 #endif
-        uint32_t offset = 0;
-        for (auto input = 0; input < input_set.size() / 4; ++input, offset += 4) {
-          shader->SetUniformF(96 + input, input_set[offset], input_set[offset + 1], input_set[offset + 2],
-                              input_set[offset + 3]);
+      uint32_t offset = 0;
+      for (auto input = 0; input < input_set.size() / 4; ++input, offset += 4) {
+        shader->SetUniformF(96 + input, input_set[offset], input_set[offset + 1], input_set[offset + 2],
+                            input_set[offset + 3]);
 
 #ifdef LOG_VERBOSE
-          PrintMsg("ARG%d  %g (0x%08X), %g (0x%08X), %g (0x%08X), %g (0x%08X)\n", input, input_set[offset + 0],
-                   *(uint32_t *)&input_set[offset + 0], input_set[offset + 1], *(uint32_t *)&input_set[offset + 1],
-                   input_set[offset + 2], *(uint32_t *)&input_set[offset + 2], input_set[offset + 3],
-                   *(uint32_t *)&input_set[offset + 3]);
+        PrintMsg("ARG%d  %g (0x%08X), %g (0x%08X), %g (0x%08X), %g (0x%08X)\n", input, input_set[offset + 0],
+                 *(uint32_t *)&input_set[offset + 0], input_set[offset + 1], *(uint32_t *)&input_set[offset + 1],
+                 input_set[offset + 2], *(uint32_t *)&input_set[offset + 2], input_set[offset + 3],
+                 *(uint32_t *)&input_set[offset + 3]);
 #endif
-        }
-      };
+      }
+    };
 
-      results.emplace_back("result");
-      computations.push_back({shader, shader_size, prepare, nullptr, &results.back()});
-      ++j;
+    results.emplace_back("result");
+    computations.push_back({shader, shader_size, prepare, nullptr, &results.back()});
+    ++j;
+  }
+
+  host.Compute(computations);
+}
+
+//! Re-runs simplified variants of a failing input on the GPU and returns the simplest one that still mismatches, as an
+//! `explicit_tests` entry.
+static std::string shrink_mismatch(TestHost &host, const char *name, uint32_t num_inputs, const uint32_t *shader,
+                                   uint32_t shader_size, const std::function<void(float *, const float *)> &cpu_op,
+                                   int ulps, const std::vector<float> &input) {
+  InputShrinker shrinker([&](const std::list<std::vector<float>> &candidates) {
+    std::list<TestHost::Results> results;
+    compute_results(host, shader, shader_size, num_inputs, candidates, results);
+
+    std::vector<bool> ret;
+    ret.reserve(candidates.size());
+    auto candidate = candidates.begin();
+    for (auto &result : results) {
+      XboxMath::vector_t cpu_result;
+      cpu_op(cpu_result, candidate++->data());
+      ret.push_back(!almost_equal(cpu_result, result.cOut[0], ulps));
     }
+    return ret;
+  });
+
+  auto shrunk = InputShrinker::FormatExplicitTest(shrinker.Shrink(input));
+  PrintMsg("%s shrunk in %u rounds (%u GPU evaluations) to: %s\n", name, shrinker.Rounds(), shrinker.Evaluations(),
+           shrunk.c_str());
+#ifdef ENABLE_PROGRESS_LOG
+  Logger::Log() << "  " << name << " mismatch shrunk to: " << shrunk << std::endl;
+#endif
+  return shrunk;
+}
 
-    host.Compute(computations);
+static bool TestBatch(TestHost &host, const char *name, uint32_t num_inputs, const uint32_t *shader,
+                      uint32_t shader_size, BatchReference &reference, const std::list<std::vector<float>> &inputs,
+                      uint32_t *num_successes, uint32_t *num_tests, uint32_t flags, MismatchLog *mismatch_log,
+                      UlpHistogram *ulp_histogram, AdaptiveSampler *sampler = nullptr,
+                      std::vector<std::string> *shrunk_inputs = nullptr) {
+  const int ulps = tolerance_ulps(flags);
+  std::list<TestHost::Results> results;
+
+  compute_results(host, shader, shader_size, num_inputs, inputs, results);
+
+  if (host.IsDryRun()) {
+    // Nothing was computed, so there is nothing to compare, log or display.
+    *num_tests += inputs.size();
+    *num_successes += inputs.size();
+    return true;
+  }
+
+  if (GpuWatchdog::HasFired()) {
+    // The GPU was reset during the batch, so its results are meaningless and must not reach the comparison, the logs
+    // or the sampler. The operation is abandoned like on a mismatch.
+    PrintMsg("%s: GPU was reset, results of the batch discarded\n", name);
+    return false;
+  }
+
+  std::vector<float> cpu_results;
+  {
+    PhaseTimer::Scope timer(PhaseTimer::PHASE_CPU_REFERENCE);
+    reference.Evaluate(num_inputs, inputs, cpu_results);
   }
 
   auto input_it = inputs.begin();
@@ -306,9 +488,28 @@ static bool TestBatch(TestHost &host, const char *name, uint32_t num_inputs, con
     }
 #endif
 
-    XboxMath::vector_t cpu_result;
-    cpu_op(cpu_result, op_inputs.data());
-    if (!almost_equal(cpu_result, hw_result, low_precision ? kUnitsInLastPlaceLowPrecision : kUnitsInLastPlace)) {
+    const float *cpu_result = &cpu_results[j * 4];
+    if (ulp_histogram) {
+      ulp_histogram->Record(name, op_inputs.data(), hw_result, cpu_result, flags & CpuShaderTests::CPUTF_X_ONLY);
+    }
+    const bool matched = almost_equal(cpu_result, hw_result, ulps);
+    if (sampler) {
+      sampler->Record(j, !matched, max_ulp_bucket(cpu_result, hw_result));
+    }
+    if (!matched) {
+      // Only the first mismatch of each operation is shrunk, later ones are likely to share its cause.
+      std::string shrunk;
+      if (shrunk_inputs && !host.IsDryRun() && *num_tests - *num_successes == 1) {
+        shrunk = shrink_mismatch(host, name, num_inputs, shader, shader_size, reference.Scalar(), ulps, op_inputs);
+        shrunk_inputs->push_back(std::string("// ") + name + "\n" + shrunk);
+      }
+
+      if (mismatch_log) {
+        mismatch_log->Record(name, num_inputs, op_inputs.data(), hw_result, cpu_result);
+        ++j;
+        continue;
+      }
+
       pb_reset();
       host.Clear();
       TextOverlay::Reset();
@@ -331,31 +532,42 @@ static bool TestBatch(TestHost &host, const char *name, uint32_t num_inputs, con
       }
 
       TextOverlay::Print("at %d/%d\n", *num_successes, *num_tests);
+      if (!shrunk.empty()) {
+        TextOverlay::Print("Shrunk: %s\n", shrunk.c_str());
+      }
       return false;
     } else {
 #ifdef LOG_VERBOSE
       PrintMsg("Pass: %g (0x%08X), %g (0x%08X), %g (0x%08X), %g (0x%08X)\n", hw_result[0], *(uint32_t *)&hw_result[0],
                hw_result[1], *(uint32_t *)&hw_result[1], hw_result[2], *(uint32_t *)&hw_result[2], hw_result[3],
                *(uint32_t *)&hw_result[3]);
+#endif
+#ifdef LOG_ALL_COMPARISONS
+      if (mismatch_log) {
+        mismatch_log->Record(name, num_inputs, op_inputs.data(), hw_result, cpu_result);
+      }
 #endif
     }
     ++*num_successes;
     ++j;
   }
 
+  if (mismatch_log) {
+    mismatch_log->Flush();
+  }
+
   pb_reset();
   host.Clear();
   TextOverlay::Print("%s: %d of %d\n", name, *num_successes, *num_tests);
   TextOverlay::Render();
-  while (pb_finished()) {
-  }
+  GpuWatchdog::WaitForFlip(__func__);
 
   return true;
 }
 
 void CpuShaderTests::Test(const char *name, uint32_t num_inputs, const uint32_t *shader, uint32_t shader_size,
-                          const std::function<void(float *, const float *)> &cpu_op, uint32_t assert_line,
-                          uint32_t flags, const std::list<std::vector<float>> &additional_inputs) {
+                          BatchReference reference, uint32_t assert_line, uint32_t flags,
+                          const std::list<std::vector<float>> &additional_inputs) {
   TextOverlay::Reset();
 
   // TODO: Test exceptional values
@@ -363,31 +575,42 @@ void CpuShaderTests::Test(const char *name, uint32_t num_inputs, const uint32_t
   uint32_t num_tests = 0;
 
   if (!additional_inputs.empty()) {
-    if (!TestBatch(host_, name, num_inputs, shader, shader_size, cpu_op, additional_inputs, &num_successes, &num_tests,
-                   flags & CPUTF_LOW_PRECISION)) {
+    if (!TestBatch(host_, name, num_inputs, shader, shader_size, reference, additional_inputs, &num_successes,
+                   &num_tests, flags, mismatch_log_.get(), ulp_histogram_.get(), nullptr, shrunk_inputs())) {
       TextOverlay::Render();
-      while (pb_finished()) {
-      }
+      GpuWatchdog::WaitForFlip(__func__);
       return;
     }
   }
 
+  // Each batch draws from its own counter-based stream so that it can be regenerated from the run seed alone.
+  const uint64_t stream = CounterRng::StreamId(suite_name_, name);
+  auto report_batch = [name](uint32_t batch) {
+    PrintMsg("%s failed in batch %u of run seed 0x%llX\n", name, batch, CounterRng::RunSeed());
+    TextOverlay::Print("Replay: !seed 0x%llX batch %u\n", CounterRng::RunSeed(), batch);
+  };
+
   {
-    const uint32_t num_values = test_values_.size();
-    auto random_value = [this, flags, num_values]() {
-      float ret = test_values_[SDLTest_RandomUint32() % num_values];
-      if (flags & CPUTF_NO_NEGATIVES) {
-        return fabs(ret);
-      }
-      return ret;
+    // Inputs are stratified across value classes, with the curated test values as one of the strata. The sampler picks
+    // the stratum of the first component of each vector and decides how many batches to run.
+    StratifiedFloatGenerator generator(kInputClasses, !(flags & CPUTF_NO_NEGATIVES), test_values_);
+    AdaptiveSampler sampler(generator.StrataCount(), kIterationsPerFrame, tolerance_ulps(flags), kSamplingBudget);
+
+    // A dry run has no results to adapt to, so it plans the minimum number of batches.
+    auto done = [this, &sampler](uint32_t batch) {
+      return host_.IsDryRun() ? batch >= kSamplingBudget.min_batches : sampler.Done();
     };
+    for (uint32_t i = 0; !done(i); ++i) {
+      CounterRng rng(stream, i);
+      generator.Reset();
+      auto random_value = [&generator, &rng]() { return generator.Next(rng); };
+      const auto &plan = sampler.PlanBatch();
 
-    for (auto i = 0; i < kNumIterations; ++i) {
       std::list<std::vector<float>> inputs;
       for (auto j = 0; j < kIterationsPerFrame; ++j) {
         std::vector<float> input_set;
         for (auto input = 0; input < num_inputs; ++input) {
-          input_set.emplace_back(random_value());
+          input_set.emplace_back(input ? random_value() : generator.NextInStratum(plan[j], rng));
           if (flags & CPUTF_X_ONLY) {
             input_set.emplace_back(0.0f);
             input_set.emplace_back(0.0f);
@@ -401,48 +624,90 @@ void CpuShaderTests::Test(const char *name, uint32_t num_inputs, const uint32_t
         inputs.push_back(input_set);
       }
 
-      if (!TestBatch(host_, name, num_inputs, shader, shader_size, cpu_op, inputs, &num_successes, &num_tests,
-                     flags & CPUTF_LOW_PRECISION)) {
+      if (!TestBatch(host_, name, num_inputs, shader, shader_size, reference, inputs, &num_successes, &num_tests,
+                     flags, mismatch_log_.get(), ulp_histogram_.get(), &sampler, shrunk_inputs())) {
+        report_batch(i);
         TextOverlay::Render();
-        while (pb_finished()) {
-        }
+        GpuWatchdog::WaitForFlip(__func__);
         return;
       }
     }
+
+    PrintMsg("%s: %u random batches%s\n", name, sampler.Batches(),
+             sampler.FoundErrors() ? ", concentrated on failing inputs" : "");
+#ifdef ENABLE_PROGRESS_LOG
+    if (allow_saving_) {
+      Logger::Log() << "  " << name << ": " << sampler.Batches() << " random batches"
+                    << (sampler.FoundErrors() ? ", concentrated on failing inputs" : "") << std::endl;
+    }
+#endif
   }
 
 #ifdef USE_FUZZ
+  StratifiedFloatGenerator fuzz_generator(StratifiedFloatGenerator::CLASS_ALL, true);
   for (auto i = 0; i < kNumIterations; ++i) {
+    CounterRng rng(stream, kSamplingBudget.max_batches + i);
+    fuzz_generator.Reset();
     std::list<std::vector<float>> inputs;
     for (auto j = 0; j < kIterationsPerFrame; ++j) {
       std::vector<float> input_set;
       for (auto input = 0; input < num_inputs; ++input) {
-        input_set.emplace_back(RandomFloat());
-        input_set.emplace_back(RandomFloat());
-        input_set.emplace_back(RandomFloat());
-        input_set.emplace_back(RandomFloat());
+        input_set.emplace_back(fuzz_generator.Next(rng));
+        input_set.emplace_back(fuzz_generator.Next(rng));
+        input_set.emplace_back(fuzz_generator.Next(rng));
+        input_set.emplace_back(fuzz_generator.Next(rng));
       }
       inputs.push_back(input_set);
     }
 
-    if (!TestBatch(host_, name, num_inputs, shader, shader_size, cpu_op, inputs, &num_successes, &num_tests,
-                   flags & CPUTF_LOW_PRECISION)) {
+    if (!TestBatch(host_, name, num_inputs, shader, shader_size, reference, inputs, &num_successes, &num_tests,
+                   flags, mismatch_log_.get(), ulp_histogram_.get(), nullptr, shrunk_inputs())) {
+      report_batch(kSamplingBudget.max_batches + i);
       pb_draw_text_screen();
-      while (pb_finished()) {
-      }
+      GpuWatchdog::WaitForFlip(__func__);
       return;
     }
   }
 #endif
 
+  if (host_.IsDryRun()) {
+    return;
+  }
+
+  if (mismatch_log_) {
+    mismatch_log_->Count(name, num_tests, num_tests - num_successes);
+    // Kept current after every operation so that a resumed run can pick the counts up after a crash.
+    mismatch_log_->WriteSummary(TestHost::PrepareSaveFile(output_dir_, kMismatchSummaryFileName, ".csv"));
+  }
+
   pb_wait_for_vbl();
   pb_reset();
   host_.Clear();
   TextOverlay::Reset();
   TextOverlay::Print("%s: %d of %d Succeeded\n", name, num_successes, num_tests);
   TextOverlay::Render();
-  while (pb_finished()) {
+  GpuWatchdog::WaitForFlip(__func__);
+}
+
+std::function<void(float *, const float *)> CpuShaderTests::IluReference(
+    IluTableModel::Function function, const std::function<void(float *, const float *)> &fallback, uint32_t &flags) {
+  if (!ilu_table_.Has(function)) {
+    return fallback;
+  }
+
+  // Keys that were not captured are only as exact as the fitted quadratics, so the tolerance is kept unless the table
+  // covers every key.
+  if (ilu_table_.Complete(function)) {
+    flags |= CPUTF_BIT_EXACT;
   }
+  return [this, function, fallback](float *out, const float *inputs) {
+    float result;
+    if (ilu_table_.Evaluate(function, inputs[0], result)) {
+      out[0] = out[1] = out[2] = out[3] = result;
+    } else {
+      fallback(out, inputs);
+    }
+  };
 }
 
 void CpuShaderTests::TestExp() {
@@ -460,13 +725,44 @@ void CpuShaderTests::TestLit() {
   Test("LIT", 1, kLit, sizeof(kLit), nv2a_vsh_cpu_lit, __LINE__, CPUTF_NO_NEGATIVES | CPUTF_X_ONLY, explicit_tests);
 }
 
+// nv2a_vsh_cpu_log computes its reference with log2f, which asserts in nxdk. This reproduces its results using
+// FloatMath::Log2 instead: [floor(log2(|x|)), |x| / 2^floor(log2(|x|)), log2(|x|), 1]. It must be kept in sync with
+// the lane semantics (and special cases) of nv2a_vsh_cpu_log whenever that library is updated.
+static void cpu_log(float *out, const float *inputs) {
+  const float value = fabsf(inputs[0]);
+  out[3] = 1.0f;
+  if (value == 0.0f || isinf(value)) {
+    out[0] = out[2] = value == 0.0f ? -INFINITY : INFINITY;
+    out[1] = 1.0f;
+    return;
+  }
+  if (isnan(value)) {
+    out[0] = out[1] = out[2] = value;
+    return;
+  }
+
+  // Subnormals are scaled into the normal range so that the exponent can be read from the bit pattern.
+  float normal = value;
+  int32_t exponent_adjust = 0;
+  if (value < FLT_MIN) {
+    normal *= 0x1p23f;
+    exponent_adjust = 23;
+  }
+  uint32_t bits;
+  memcpy(&bits, &normal, sizeof(bits));
+  const int32_t exponent = static_cast<int32_t>(bits >> 23) - 127 - exponent_adjust;
+  bits = (bits & 0x007FFFFF) | 0x3F800000;
+
+  out[0] = static_cast<float>(exponent);
+  memcpy(&out[1], &bits, sizeof(out[1]));
+  out[2] = FloatMath::Log2(value);
+}
+
 void CpuShaderTests::TestLog() {
-  //  // This halts on Xbox as log2f is not implemented and asserts.
-  //  std::list<std::vector<float>> explicit_tests = {
-  //      {-5.864211e16f, 0.00789012, 5.864211e-08f, -1.844675e19f},
-  //  };
-  //  Test("LOG", 1, kLog, sizeof(kLog), nv2a_vsh_cpu_log, __LINE__, CPUTF_X_ONLY | CPUTF_LOW_PRECISION,
-  //  explicit_tests);
+  std::list<std::vector<float>> explicit_tests = {
+      {-5.864211e16f, 0.00789012, 5.864211e-08f, -1.844675e19f},
+  };
+  Test("LOG", 1, kLog, sizeof(kLog), cpu_log, __LINE__, CPUTF_X_ONLY | CPUTF_LOW_PRECISION, explicit_tests);
 }
 
 void CpuShaderTests::TestRcc() {
@@ -484,7 +780,9 @@ void CpuShaderTests::TestRcp() {
       {1.0f, 1.0f, 1.0f, 1.0f},
       {-1.0f, -1.0f, -1.0f, -1.0f},
   };
-  Test("RCP", 1, kRcp, sizeof(kRcp), nv2a_vsh_cpu_rcp, __LINE__, CPUTF_X_ONLY, explicit_tests);
+  uint32_t flags = CPUTF_X_ONLY;
+  auto cpu_op = IluReference(IluTableModel::FUNCTION_RCP, nv2a_vsh_cpu_rcp, flags);
+  Test("RCP", 1, kRcp, sizeof(kRcp), cpu_op, __LINE__, flags, explicit_tests);
 }
 
 void CpuShaderTests::TestRsq() {
@@ -493,10 +791,14 @@ void CpuShaderTests::TestRsq() {
       {-1.0f, -1.0f, -1.0f, -1.0f}, {8.90123456e25f, 0.0f, 0.0f, 0.0f}, {-8.90123456e25f, 0.0f, 0.0f, 0.0f},
   };
 
-  Test("RSQ", 1, kRsq, sizeof(kRsq), nv2a_vsh_cpu_rsq, __LINE__, CPUTF_X_ONLY, explicit_tests);
+  uint32_t flags = CPUTF_X_ONLY;
+  auto cpu_op = IluReference(IluTableModel::FUNCTION_RSQ, nv2a_vsh_cpu_rsq, flags);
+  Test("RSQ", 1, kRsq, sizeof(kRsq), cpu_op, __LINE__, flags, explicit_tests);
 }
 
-void CpuShaderTests::TestAdd() { Test("ADD", 2, kAdd, sizeof(kAdd), nv2a_vsh_cpu_add, __LINE__); }
+void CpuShaderTests::TestAdd() {
+  Test("ADD", 2, kAdd, sizeof(kAdd), {nv2a_vsh_cpu_add, BatchReference::Add}, __LINE__);
+}
 
 // void CpuShaderTests::TestArl() {}
 
@@ -507,14 +809,20 @@ void CpuShaderTests::TestDp3() {
       {-8.901235e+25f, 6.432100e-15f, 5.864211e+16f, 1.844675e+19f, 1.844675e+19f, -6.432100e-15f, 1.234568e+20f,
        -0.123457f},
   };
-  Test("DP3", 2, kDp3, sizeof(kDp3), nv2a_vsh_cpu_dp3, __LINE__, CPUTF_NONE, explicit_tests);
+  Test("DP3", 2, kDp3, sizeof(kDp3), {nv2a_vsh_cpu_dp3, BatchReference::Dp3}, __LINE__, CPUTF_NONE, explicit_tests);
 }
 
-void CpuShaderTests::TestDp4() { Test("DP4", 2, kDp4, sizeof(kDp4), nv2a_vsh_cpu_dp4, __LINE__); }
+void CpuShaderTests::TestDp4() {
+  Test("DP4", 2, kDp4, sizeof(kDp4), {nv2a_vsh_cpu_dp4, BatchReference::Dp4}, __LINE__);
+}
 
-void CpuShaderTests::TestDph() { Test("DPH", 2, kDph, sizeof(kDph), nv2a_vsh_cpu_dph, __LINE__); }
+void CpuShaderTests::TestDph() {
+  Test("DPH", 2, kDph, sizeof(kDph), {nv2a_vsh_cpu_dph, BatchReference::Dph}, __LINE__);
+}
 
-void CpuShaderTests::TestDst() { Test("DST", 2, kDst, sizeof(kDst), nv2a_vsh_cpu_dst, __LINE__); }
+void CpuShaderTests::TestDst() {
+  Test("DST", 2, kDst, sizeof(kDst), {nv2a_vsh_cpu_dst, BatchReference::Dst}, __LINE__);
+}
 
 void CpuShaderTests::TestMad() {
   std::list<std::vector<float>> explicit_tests = {
@@ -527,28 +835,34 @@ void CpuShaderTests::TestMad() {
       {-1.84467470083988e19f, -1.84467470083988e19f, 1.84467470083988e19f, 1.84467470083988e19f, 1.2345678e20f,
        -1.2345678e20f, 1.2345678e20f, -1.2345678e20f, -10.0f, -10.0f, -10.0f, -10.0f},
   };
-  Test("MAD", 3, kMad, sizeof(kMad), nv2a_vsh_cpu_mad, __LINE__, CPUTF_NONE, explicit_tests);
+  Test("MAD", 3, kMad, sizeof(kMad), {nv2a_vsh_cpu_mad, BatchReference::Mad}, __LINE__, CPUTF_NONE, explicit_tests);
 }
 
-void CpuShaderTests::TestMax() { Test("MAX", 2, kMax, sizeof(kMax), nv2a_vsh_cpu_max, __LINE__); }
+void CpuShaderTests::TestMax() {
+  Test("MAX", 2, kMax, sizeof(kMax), {nv2a_vsh_cpu_max, BatchReference::Max}, __LINE__);
+}
 
-void CpuShaderTests::TestMin() { Test("MIN", 2, kMin, sizeof(kMin), nv2a_vsh_cpu_min, __LINE__); }
+void CpuShaderTests::TestMin() {
+  Test("MIN", 2, kMin, sizeof(kMin), {nv2a_vsh_cpu_min, BatchReference::Min}, __LINE__);
+}
 
-void CpuShaderTests::TestMov() { Test("MOV", 1, kMov, sizeof(kMov), nv2a_vsh_cpu_mov, __LINE__); }
+void CpuShaderTests::TestMov() {
+  Test("MOV", 1, kMov, sizeof(kMov), {nv2a_vsh_cpu_mov, BatchReference::Mov}, __LINE__);
+}
 
 void CpuShaderTests::TestMul() {
   std::list<std::vector<float>> explicit_tests = {
       {-1.84467470083988e19f, -1.84467470083988e19f, 1.84467470083988e19f, 1.84467470083988e19f, 1.2345678e20f,
        -1.2345678e20f, 1.2345678e20f, -1.2345678e20f},
   };
-  Test("MUL", 2, kMul, sizeof(kMul), nv2a_vsh_cpu_mul, __LINE__, CPUTF_NONE, explicit_tests);
+  Test("MUL", 2, kMul, sizeof(kMul), {nv2a_vsh_cpu_mul, BatchReference::Mul}, __LINE__, CPUTF_NONE, explicit_tests);
 }
 
 void CpuShaderTests::TestSge() {
   std::list<std::vector<float>> explicit_tests = {
       {-0.0f, 0.0f, -0.0f, 0.0f, 0.0f, 0.0f, -0.0f, -0.0f},
   };
-  Test("SGE", 2, kSge, sizeof(kSge), nv2a_vsh_cpu_sge, __LINE__, CPUTF_NONE, explicit_tests);
+  Test("SGE", 2, kSge, sizeof(kSge), {nv2a_vsh_cpu_sge, BatchReference::Sge}, __LINE__, CPUTF_NONE, explicit_tests);
 }
 
 void CpuShaderTests::TestSlt() {
@@ -557,5 +871,5 @@ void CpuShaderTests::TestSlt() {
       {-0.0f, 0.0f, -0.0f, 0.0f, 0.1f, 0.1f, -0.1f, -0.1f},
       {-0.0f, 0.0f, -0.0f, 0.0f, 5.8642111e-8f, 5.8642111e-8f, -5.8642111e-8f, -5.8642111e-8f},
   };
-  Test("SLT", 2, kSlt, sizeof(kSlt), nv2a_vsh_cpu_slt, __LINE__, CPUTF_NONE, explicit_tests);
+  Test("SLT", 2, kSlt, sizeof(kSlt), {nv2a_vsh_cpu_slt, BatchReference::Slt}, __LINE__, CPUTF_NONE, explicit_tests);
 }
@@ -1,10 +1,15 @@
 #pragma once
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "batch_reference.h"
+#include "ilu_table_model.h"
+#include "mismatch_log.h"
 #include "nv2a_vsh_cpu.h"
 #include "test_host.h"
 #include "test_suite.h"
+#include "ulp_histogram.h"
 
 class CpuShaderTests : public TestSuite {
  public:
@@ -13,11 +18,14 @@ class CpuShaderTests : public TestSuite {
     CPUTF_NO_NEGATIVES = 1 << 0,
     CPUTF_X_ONLY = 1 << 1,
     CPUTF_LOW_PRECISION = 1 << 2,
+    // Compare without any ULP tolerance.
+    CPUTF_BIT_EXACT = 1 << 3,
   };
 
  public:
   CpuShaderTests(TestHost& host, std::string output_dir);
   void Initialize() override;
+  void Deinitialize() override;
 
  private:
   void TestExp();
@@ -40,10 +48,33 @@ class CpuShaderTests : public TestSuite {
   void TestSge();
   void TestSlt();
 
+  //! Compares the GPU result of `shader` with `reference` for the given and random inputs.
   void Test(const char* name, uint32_t num_inputs, const uint32_t* shader, uint32_t shader_size,
-            const std::function<void(float*, const float*)>& cpu_op, uint32_t assert_line, uint32_t flags = CPUTF_NONE,
+            BatchReference reference, uint32_t assert_line, uint32_t flags = CPUTF_NONE,
             const std::list<std::vector<float>>& additional_inputs = {});
 
+  std::vector<std::string>* shrunk_inputs() { return shrink_inputs_ ? &shrunk_inputs_ : nullptr; }
+
+  //! Returns the loaded IluTableModel as the reference for `function`, falling back to `fallback` for inputs outside of
+  //! the model. Adds CPUTF_BIT_EXACT to `flags` if the table is IluTableModel::Complete. Returns `fallback` if no
+  //! table is loaded for `function`.
+  std::function<void(float*, const float*)> IluReference(IluTableModel::Function function,
+                                                         const std::function<void(float*, const float*)>& fallback,
+                                                         uint32_t& flags);
+
  private:
+  // Curated input values, drawn as one stratum of StratifiedFloatGenerator.
   std::vector<float> test_values_;
+
+  // When set, mismatches are logged and testing continues rather than stopping at the first mismatch.
+  std::unique_ptr<MismatchLog> mismatch_log_;
+  // When set, the ULP distance of every comparison is accumulated.
+  std::unique_ptr<UlpHistogram> ulp_histogram_;
+  // When set, the first mismatch of each operation is minimized on the GPU and the result is kept as an
+  // explicit_tests entry.
+  bool shrink_inputs_{false};
+  std::vector<std::string> shrunk_inputs_;
+
+  // Bit-exact RCP and RSQ reference fitted to hardware captures, loaded from ILU_TABLE_PATH if set.
+  IluTableModel ilu_table_;
 };
@@ -0,0 +1,269 @@
+#include "harness_benchmarks.h"
+
+#include <pbkit/pbkit.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+
+#include "../test_host.h"
+#include "compareasint/compare_as_int.h"
+#include "debug_output.h"
+#include "gpu_watchdog.h"
+#include "pbkit_ext.h"
+#include "pushbuffer.h"
+#include "result_archive.h"
+#include "shaders/vertex_shader_program.h"
+#include "text_overlay.h"
+#include "tsc_clock.h"
+
+// clang format off
+static constexpr uint32_t kShader[] = {
+#include "shaders/mac_mov.vshinc"
+};
+// clang format on
+
+static constexpr char kPushbufferPushTest[] = "PushbufferPush";
+static constexpr char kUploadConstantsTest[] = "UploadConstants";
+static constexpr char kPrepareCalculationTest[] = "PrepareCalculation";
+static constexpr char kFetchResultsTest[] = "FetchResults";
+static constexpr char kAlmostEqualUlpsTest[] = "AlmostEqualUlps";
+static constexpr char kZ24ConversionTest[] = "Z24Conversion";
+static constexpr char kConvertToRGBATest[] = "ConvertToRGBA";
+
+static constexpr char kResultsFileName[] = "benchmarks";
+
+// Number of timed repeats of each benchmark, the median is reported to reject outliers from interrupts.
+static constexpr uint32_t kRepeats = 9;
+
+// Number of NV097_NO_OPERATION commands pushed per begin/end block in the pushbuffer benchmark.
+static constexpr uint32_t kPushesPerBlock = 32;
+
+// Number of 4x4 matrices (4 constant slots each) uploaded by the constant upload benchmark.
+static constexpr uint32_t kUploadMatrices = 4;
+
+// Constant slot used by the upload benchmark, well above the inputs used by the compute shaders.
+static constexpr uint32_t kUploadBaseSlot = 96;
+
+static constexpr uint32_t kNumCompareValues = 1024;
+
+HarnessBenchmarks::HarnessBenchmarks(TestHost &host, std::string output_dir)
+    : TestSuite(host, std::move(output_dir), "Harness Benchmarks") {
+  tests_[kPushbufferPushTest] = [this]() { BenchmarkPushbufferPush(); };
+  tests_[kUploadConstantsTest] = [this]() { BenchmarkUploadConstants(); };
+  tests_[kPrepareCalculationTest] = [this]() { BenchmarkPrepareCalculation(); };
+  tests_[kFetchResultsTest] = [this]() { BenchmarkFetchResults(); };
+  tests_[kAlmostEqualUlpsTest] = [this]() { BenchmarkAlmostEqualUlps(); };
+  tests_[kZ24ConversionTest] = [this]() { BenchmarkZ24Conversion(); };
+  tests_[kConvertToRGBATest] = [this]() { BenchmarkConvertToRGBA(); };
+}
+
+void HarnessBenchmarks::Initialize() {
+  TestSuite::Initialize();
+  measurements_.clear();
+}
+
+void HarnessBenchmarks::Deinitialize() {
+  WriteResults();
+  // The benchmarks leave arbitrary constants and programs behind.
+  host_.ClearState();
+}
+
+void HarnessBenchmarks::BenchmarkPushbufferPush() {
+  auto body = [](uint32_t iterations) {
+    for (uint32_t i = 0; i < iterations; ++i) {
+      Pushbuffer::Begin();
+      for (uint32_t push = 0; push < kPushesPerBlock; ++push) {
+        Pushbuffer::Push(NV097_NO_OPERATION, 0);
+      }
+      Pushbuffer::End();
+    }
+  };
+  auto settle = []() { GpuWatchdog::WaitForIdle(__func__); };
+
+  Measure(kPushbufferPushTest, 64, kPushesPerBlock, body, settle);
+}
+
+void HarnessBenchmarks::BenchmarkUploadConstants() {
+  auto shader = std::make_shared<VertexShaderProgram>();
+  float matrix[16];
+  for (uint32_t i = 0; i < 16; ++i) {
+    matrix[i] = static_cast<float>(i);
+  }
+
+  auto body = [&shader, &matrix](uint32_t iterations) {
+    for (uint32_t i = 0; i < iterations; ++i) {
+      for (uint32_t m = 0; m < kUploadMatrices; ++m) {
+        shader->SetUniform4x4F(kUploadBaseSlot + m * 4, matrix);
+      }
+      shader->PrepareDraw();
+    }
+  };
+  auto settle = []() { GpuWatchdog::WaitForIdle(__func__); };
+
+  Measure(kUploadConstantsTest, 32, kUploadMatrices * 4, body, settle);
+}
+
+void HarnessBenchmarks::BenchmarkPrepareCalculation() {
+  auto body = [this](uint32_t iterations) {
+    for (uint32_t i = 0; i < iterations; ++i) {
+      host_.PrepareCalculation(kShader, sizeof(kShader));
+    }
+  };
+  auto settle = []() { GpuWatchdog::WaitForIdle(__func__); };
+
+  Measure(kPrepareCalculationTest, 32, 1, body, settle);
+}
+
+void HarnessBenchmarks::BenchmarkFetchResults() {
+  TestHost::Results results("fetch", RES_ALL);
+
+  auto body = [&results](uint32_t iterations) {
+    for (uint32_t i = 0; i < iterations; ++i) {
+      TestHost::FetchResults(results);
+    }
+  };
+
+  Measure(kFetchResultsTest, 16, 32, body);
+}
+
+void HarnessBenchmarks::BenchmarkAlmostEqualUlps() {
+  std::vector<float> a(kNumCompareValues);
+  std::vector<float> b(kNumCompareValues);
+  for (uint32_t i = 0; i < kNumCompareValues; ++i) {
+    a[i] = RandomFloat();
+    b[i] = (i & 1) ? a[i] : RandomFloat();
+  }
+
+  volatile uint32_t sink = 0;
+  auto body = [&a, &b, &sink](uint32_t iterations) {
+    uint32_t matches = 0;
+    for (uint32_t i = 0; i < iterations; ++i) {
+      for (uint32_t v = 0; v < kNumCompareValues; ++v) {
+        matches += almost_equal_ulps(a[v], b[v], 4);
+      }
+    }
+    sink = matches;
+  };
+
+  Measure(kAlmostEqualUlpsTest, 16, kNumCompareValues, body);
+}
+
+void HarnessBenchmarks::BenchmarkZ24Conversion() {
+  std::vector<float> values(kNumCompareValues);
+  for (uint32_t i = 0; i < kNumCompareValues; ++i) {
+    values[i] = static_cast<float>(i) / kNumCompareValues;
+  }
+
+  volatile float sink = 0.0f;
+  auto body = [&values, &sink](uint32_t iterations) {
+    float total = 0.0f;
+    for (uint32_t i = 0; i < iterations; ++i) {
+      for (auto value : values) {
+        total += z24_to_float(float_to_z24(value));
+      }
+    }
+    sink = total;
+  };
+
+  Measure(kZ24ConversionTest, 16, kNumCompareValues, body);
+}
+
+void HarnessBenchmarks::BenchmarkConvertToRGBA() {
+  static constexpr uint32_t kNumPixels = kFramebufferWidth * kFramebufferHeight;
+  std::vector<uint32_t> source(kNumPixels);
+  std::vector<uint32_t> dest(kNumPixels);
+  for (uint32_t i = 0; i < kNumPixels; ++i) {
+    source[i] = i * 0x01010101;
+  }
+
+  auto body = [&source, &dest](uint32_t iterations) {
+    for (uint32_t i = 0; i < iterations; ++i) {
+      TestHost::ConvertToRGBA(source.data(), dest.data(), kNumPixels);
+    }
+  };
+
+  Measure(kConvertToRGBATest, 2, kNumPixels, body);
+}
+
+void HarnessBenchmarks::Measure(const std::string &name, uint32_t iterations, uint32_t ops_per_iteration,
+                                const std::function<void(uint32_t)> &body, const std::function<void()> &settle) {
+  // Warm up caches and any lazily allocated state.
+  body(iterations);
+  if (settle) {
+    settle();
+  }
+
+  std::vector<uint64_t> cycles;
+  cycles.reserve(kRepeats);
+  for (uint32_t repeat = 0; repeat < kRepeats; ++repeat) {
+    auto start = TscClock::Now();
+    body(iterations);
+    cycles.push_back(TscClock::Now() - start);
+
+    if (settle) {
+      settle();
+    }
+  }
+
+  std::sort(cycles.begin(), cycles.end());
+  const double ops = static_cast<double>(iterations) * ops_per_iteration;
+  const double ns_per_cycle = 1000.0 / static_cast<double>(TscClock::CyclesPerMicrosecond());
+
+  Measurement measurement{name, iterations, ops_per_iteration, static_cast<double>(cycles.front()) * ns_per_cycle / ops,
+                          static_cast<double>(cycles[kRepeats / 2]) * ns_per_cycle / ops};
+  PrintMsg("%s: min %f ns/op, median %f ns/op\n", name.c_str(), measurement.min_ns_per_op,
+           measurement.median_ns_per_op);
+
+  DisplayMeasurement(measurement);
+  measurements_.push_back(measurement);
+}
+
+void HarnessBenchmarks::DisplayMeasurement(const Measurement &measurement) const {
+  pb_wait_for_vbl();
+  pb_reset();
+  host_.Clear(0x2F2C2E);
+
+  TextOverlay::Print("%s\n", measurement.name.c_str());
+  TextOverlay::Print("  %u iterations x %u ops x %u repeats\n", measurement.iterations, measurement.ops_per_iteration,
+                     kRepeats);
+  TextOverlay::Print("  min    %.3f ns/op\n", measurement.min_ns_per_op);
+  TextOverlay::Print("  median %.3f ns/op\n", measurement.median_ns_per_op);
+  TextOverlay::Render();
+
+  GpuWatchdog::WaitForFlip(__func__);
+}
+
+void HarnessBenchmarks::WriteResults() const {
+  if (!allow_saving_ || measurements_.empty()) {
+    return;
+  }
+
+  std::string json = "{\n  \"suite\": \"" + suite_name_ + "\",\n  \"benchmarks\": [\n";
+  char buf[256];
+  for (auto it = measurements_.begin(); it != measurements_.end(); ++it) {
+    snprintf(buf, sizeof(buf),
+             "    {\"name\": \"%s\", \"iterations\": %u, \"ops_per_iteration\": %u, \"repeats\": %u, "
+             "\"min_ns_per_op\": %.3f, \"median_ns_per_op\": %.3f}%s\n",
+             it->name.c_str(), it->iterations, it->ops_per_iteration, kRepeats, it->min_ns_per_op,
+             it->median_ns_per_op, it + 1 == measurements_.end() ? "" : ",");
+    json += buf;
+  }
+  json += "  ]\n}\n";
+
+  if (ResultArchive::IsEnabled()) {
+    auto folder = output_dir_.substr(output_dir_.find_last_of('\\') + 1);
+    ResultArchive::Write(ResultArchive::PAYLOAD_LOG, folder, std::string(kResultsFileName) + ".json", json.data(),
+                         json.size());
+    return;
+  }
+
+  auto target_file = TestHost::PrepareSaveFile(output_dir_, kResultsFileName, ".json");
+  std::ofstream out(target_file.c_str(), std::ios_base::out | std::ios_base::trunc);
+  if (!out) {
+    PrintMsg("Failed to open benchmark output %s\n", target_file.c_str());
+    return;
+  }
+  out << json;
+}
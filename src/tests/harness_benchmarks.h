@@ -0,0 +1,47 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "test_host.h"
+#include "test_suite.h"
+
+//! Measures the throughput of the harness itself (pushbuffer submission, constant upload, readback, result comparison
+//! and image conversion) so that performance changes to the harness can be quantified.
+//!
+//! Each benchmark is run repeatedly and the minimum and median time per operation are written to benchmarks.json when
+//! the suite is deinitialized. Compare runs with scripts/compare_benchmarks.py.
+class HarnessBenchmarks : public TestSuite {
+ public:
+  HarnessBenchmarks(TestHost &host, std::string output_dir);
+  void Initialize() override;
+  void Deinitialize() override;
+
+ private:
+  struct Measurement {
+    std::string name;
+    uint32_t iterations;
+    uint32_t ops_per_iteration;
+    double min_ns_per_op;
+    double median_ns_per_op;
+  };
+
+  void BenchmarkPushbufferPush();
+  void BenchmarkUploadConstants();
+  void BenchmarkPrepareCalculation();
+  void BenchmarkFetchResults();
+  void BenchmarkAlmostEqualUlps();
+  void BenchmarkZ24Conversion();
+  void BenchmarkConvertToRGBA();
+
+  //! Runs `body(iterations)` kRepeats times after a warm up run, calling `settle` outside of the timed region after each
+  //! repeat, and records the result under `name`.
+  void Measure(const std::string &name, uint32_t iterations, uint32_t ops_per_iteration,
+               const std::function<void(uint32_t)> &body, const std::function<void()> &settle = nullptr);
+
+  void DisplayMeasurement(const Measurement &measurement) const;
+  void WriteResults() const;
+
+ private:
+  std::vector<Measurement> measurements_;
+};
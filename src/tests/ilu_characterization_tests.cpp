@@ -0,0 +1,155 @@
+#include "ilu_characterization_tests.h"
+
+#include <pbkit/pbkit.h>
+
+#include <algorithm>
+#include <cstring>
+#include <list>
+
+#include "../test_host.h"
+#include "configure.h"
+#include "debug_output.h"
+#include "gpu_watchdog.h"
+#include "nv2a_vsh_cpu.h"
+#include "pbkit_ext.h"
+#include "progress_journal.h"
+#include "result_archive.h"
+#include "shaders/vertex_shader_program.h"
+#include "text_overlay.h"
+
+// clang format off
+static constexpr uint32_t kRcp[] = {
+#include "shaders/ilu_characterization_rcp.vshinc"
+};
+static constexpr uint32_t kRsq[] = {
+#include "shaders/ilu_characterization_rsq.vshinc"
+};
+// clang format on
+
+static constexpr const char *kCapturesFileName = "ilu_captures";
+
+// Strata per function, each of which contributes two keys. 0 captures every key of both functions exactly once.
+static constexpr uint32_t kStrataPerFunction = ILU_CHARACTERIZATION_STRATA;
+static_assert(!(kStrataPerFunction & (kStrataPerFunction - 1)), "ILU_CHARACTERIZATION_STRATA must be a power of two");
+
+// Computations per call to TestHost::Compute, each of which captures four inputs.
+static constexpr uint32_t kComputationsPerBatch = 256;
+static constexpr uint32_t kInputsPerComputation = 4;
+
+static constexpr uint32_t kMantissaMask = 0x007FFFFF;
+static constexpr uint32_t kExponentShift = 23;
+static constexpr uint32_t kExponentBias = 127;
+
+IluCharacterizationTests::IluCharacterizationTests(TestHost &host, std::string output_dir)
+    : TestSuite(host, std::move(output_dir), "ILU Characterization") {
+  tests_["RCP"] = [this]() { Characterize("RCP", 23, kRcp, sizeof(kRcp), nv2a_vsh_cpu_rcp); };
+  tests_["RSQ"] = [this]() { Characterize("RSQ", 24, kRsq, sizeof(kRsq), nv2a_vsh_cpu_rsq); };
+}
+
+void IluCharacterizationTests::Initialize() {
+  TestSuite::Initialize();
+
+  if (allow_saving_) {
+    // A resumed run appends to the captures of the attempts before it.
+    captures_ = std::make_unique<MismatchLog>(TestHost::PrepareSaveFile(output_dir_, kCapturesFileName, ".bin"),
+                                              ProgressJournal::IsResuming());
+  }
+}
+
+void IluCharacterizationTests::Deinitialize() {
+  if (!captures_) {
+    return;
+  }
+  captures_.reset();
+
+  if (ResultArchive::IsEnabled()) {
+    auto folder = output_dir_.substr(output_dir_.find_last_of('\\') + 1);
+    ResultArchive::AppendFile(ResultArchive::PAYLOAD_LOG, folder, std::string(kCapturesFileName) + ".bin",
+                              TestHost::PrepareSaveFile(output_dir_, kCapturesFileName, ".bin"));
+  }
+}
+
+uint32_t IluCharacterizationTests::MakeInput(const char *name, uint32_t key) {
+  uint32_t exponent;
+  if (!strcmp(name, "RCP")) {
+    // Keeps the reciprocal normal.
+    exponent = 2 + random_.NextUint32() % 250;
+  } else {
+    // The top bit of the key is the parity of the unbiased exponent.
+    exponent = 1 + random_.NextUint32() % 252;
+    if (((exponent - kExponentBias) & 1) != (key >> kExponentShift)) {
+      ++exponent;
+    }
+  }
+  return (exponent << kExponentShift) | (key & kMantissaMask);
+}
+
+void IluCharacterizationTests::Characterize(const char *name, uint32_t key_bits, const uint32_t *shader,
+                                            uint32_t shader_size,
+                                            const std::function<void(float *, const float *)> &cpu_op) {
+  if (!captures_) {
+    PrintMsg("%s characterization skipped, saving is disabled\n", name);
+    return;
+  }
+
+  // Each stratum contributes two inputs: its first key, which hits every power of two and table segment boundary, and
+  // a random one. Strata of a single key contribute just that key. Inputs are generated per batch as an exhaustive run
+  // would not fit into memory at once.
+  const uint32_t num_keys = 1u << key_bits;
+  const uint32_t num_strata = kStrataPerFunction ? std::min(kStrataPerFunction, num_keys) : num_keys;
+  const uint32_t stride = num_keys / num_strata;
+  const uint32_t inputs_per_stratum = stride > 1 ? 2 : 1;
+  const uint32_t num_inputs = num_strata * inputs_per_stratum;
+  ASSERT(!(num_inputs % kInputsPerComputation) && "Inputs must fill every computation");
+
+  const uint32_t inputs_per_batch = kComputationsPerBatch * kInputsPerComputation;
+  std::vector<uint32_t> inputs;
+  inputs.reserve(inputs_per_batch);
+  for (uint32_t first = 0; first < num_inputs; first += inputs_per_batch) {
+    inputs.clear();
+    for (uint32_t index = first; index < num_inputs && inputs.size() < inputs_per_batch; ++index) {
+      const uint32_t start = (index / inputs_per_stratum) * stride;
+      inputs.push_back(MakeInput(name, (index % inputs_per_stratum) ? start + random_.NextUint32() % stride : start));
+    }
+
+    std::list<TestHost::Results> results;
+    std::list<TestHost::Computation> computations;
+    for (uint32_t offset = 0; offset < inputs.size(); offset += kInputsPerComputation) {
+      XboxMath::vector_t values;
+      memcpy(values, &inputs[offset], sizeof(values));
+      auto prepare = [values](const std::shared_ptr<VertexShaderProgram> &shader) {
+        shader->SetUniform4F(96, values);
+      };
+      results.emplace_back("result", RES_0 | RES_1 | RES_2 | RES_3);
+      computations.push_back({shader, shader_size, prepare, nullptr, &results.back()});
+    }
+
+    host_.Compute(computations);
+    if (GpuWatchdog::HasFired()) {
+      // Results read back around a GPU reset would be captured as hardware behavior.
+      PrintMsg("%s characterization stopped after a GPU reset, %u inputs captured\n", name, first);
+      return;
+    }
+
+    auto input = inputs.begin();
+    for (auto &result : results) {
+      for (uint32_t lane = 0; lane < kInputsPerComputation; ++lane) {
+        XboxMath::vector_t args = {0.0f, 0.0f, 0.0f, 0.0f};
+        memcpy(&args[0], &*input++, sizeof(args[0]));
+        XboxMath::vector_t cpu_result;
+        cpu_op(cpu_result, args);
+        captures_->Record(name, 1, args, result.cOut[lane], cpu_result);
+      }
+    }
+    captures_->Flush();
+
+    pb_reset();
+    host_.Clear();
+    TextOverlay::Reset();
+    TextOverlay::Print("%s: captured %u of %u\n", name, first + static_cast<uint32_t>(inputs.size()), num_inputs);
+    TextOverlay::Render();
+    GpuWatchdog::WaitForFlip(__func__);
+  }
+
+  PrintMsg("%s: captured %u inputs\n", name, num_inputs);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "mismatch_log.h"
+#include "test_host.h"
+#include "test_suite.h"
+
+//! Captures the hardware RCP and RSQ results over their whole reduced argument range (see IluTableModel) so that
+//! scripts/fit_ilu_table.py can fit tables that reproduce them bit for bit.
+//!
+//! The range of each function is split into equal strata, each of which contributes its first key and one random key
+//! with a random exponent. Every result is written to ilu_captures.bin in the MismatchLog format, with the nv2a_vsh_cpu
+//! result as the CPU value, so the captures can also be inspected with scripts/mismatch_log.py and
+//! scripts/exact_oracle.py. Runs with different seeds capture different random keys and can be combined.
+class IluCharacterizationTests : public TestSuite {
+ public:
+  IluCharacterizationTests(TestHost &host, std::string output_dir);
+  void Initialize() override;
+  void Deinitialize() override;
+
+ private:
+  //! Captures `name` for every stratum of its `key_bits` wide reduced argument.
+  void Characterize(const char *name, uint32_t key_bits, const uint32_t *shader, uint32_t shader_size,
+                    const std::function<void(float *, const float *)> &cpu_op);
+
+  //! Returns an input with the given reduced argument and a random exponent, see IluTableModel.
+  uint32_t MakeInput(const char *name, uint32_t key);
+
+ private:
+  std::unique_ptr<MismatchLog> captures_;
+};
@@ -3,11 +3,18 @@
 #include <fstream>
 
 #include "SDL_stdinc.h"
-#include "SDL_test_fuzzer.h"
 #include "debug_output.h"
+#include "gpu_watchdog.h"
+#include "heap_tracker.h"
 #include "logger.h"
 #include "pbkit_ext.h"
+#include "phase_timer.h"
+#include "progress_journal.h"
+#include "pushbuffer_stats.h"
+#include "run_planner.h"
+#include "runtime_history.h"
 #include "test_host.h"
+#include "trace_recorder.h"
 
 #define SET_MASK(mask, val) (((val) << (__builtin_ffs(mask) - 1)) & (mask))
 
@@ -41,8 +48,30 @@ void TestSuite::Run(const std::string& test_name) {
   }
 
   auto start_time = LogTestStart(test_name);
-  it->second();
+  GpuWatchdog::SetCurrentTest(suite_name_, test_name);
+  RuntimeHistory::BeginTest(suite_name_, test_name);
+  PhaseTimer::BeginTest(suite_name_, test_name);
+  PushbufferStats::BeginTest(suite_name_, test_name);
+  HeapTracker::BeginTest(suite_name_, test_name);
+  RunPlanner::BeginTest(suite_name_, test_name);
+  random_ = CounterRng(suite_name_, test_name);
+  {
+    TraceRecorder::Scope trace("test", suite_name_ + "::" + test_name);
+    it->second();
+  }
+  RunPlanner::EndTest();
+  HeapTracker::EndTest();
+  PushbufferStats::EndTest();
+  PhaseTimer::EndTest();
+  // Reads the phase times of the test from PhaseTimer, so must follow it.
+  RuntimeHistory::EndTest();
   LogTestEnd(test_name, start_time);
+
+  if (GpuWatchdog::HasFired()) {
+    // pbkit was reset mid-test, so restore the render state that the remaining tests rely on.
+    GpuWatchdog::ClearFired();
+    host_.RestoreState();
+  }
 }
 
 void TestSuite::RunAll() {
@@ -60,6 +89,7 @@ std::chrono::steady_clock::time_point TestSuite::LogTestStart(const std::string&
 #ifdef ENABLE_PROGRESS_LOG
   if (allow_saving_) {
     Logger::Log() << "Starting " << suite_name_ << "::" << test_name << std::endl;
+    ProgressJournal::RecordTestStart(suite_name_, test_name);
   }
 #endif
 
@@ -75,14 +105,12 @@ void TestSuite::LogTestEnd(const std::string& test_name, std::chrono::steady_clo
 #ifdef ENABLE_PROGRESS_LOG
   if (allow_saving_) {
     Logger::Log() << "  Completed " << test_name << " " << elapsed << "ms" << std::endl;
+    ProgressJournal::RecordTestEnd(suite_name_, test_name, elapsed);
   }
 #endif
 }
 
-float TestSuite::RandomFloat() {
-  uint32_t val = SDLTest_RandomUint32();
-  return *(float*)&val;
-}
+float TestSuite::RandomFloat() { return random_.NextBitsFloat(); }
 
 void TestSuite::RandomVector(XboxMath::vector_t out) {
   out[0] = RandomFloat();
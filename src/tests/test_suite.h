@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 
+#include "counter_rng.h"
 #include "xbox_math_matrix.h"
 
 class TestHost;
@@ -54,6 +55,7 @@ class TestSuite {
 
   void SetSavingAllowed(bool enable = true) { allow_saving_ = enable; }
 
+  //! Returns values from a stream that restarts at each test, see CounterRng.
   float RandomFloat();
   void RandomVector(XboxMath::vector_t out);
 
@@ -66,6 +68,9 @@ class TestSuite {
   std::string output_dir_;
   std::string suite_name_;
 
+  // Random stream of the test that is running.
+  CounterRng random_{0, 0};
+
   // Flag to forcibly disallow saving of output (e.g., when in multiframe test mode for debugging).
   bool allow_saving_{true};
 
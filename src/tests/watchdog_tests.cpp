@@ -0,0 +1,101 @@
+#include "watchdog_tests.h"
+
+#include <pbkit/pbkit.h>
+
+#include <cstring>
+
+#include "../test_host.h"
+#include "debug_output.h"
+#include "gpu_watchdog.h"
+#include "shaders/vertex_shader_program.h"
+#include "text_overlay.h"
+
+// clang format off
+static constexpr uint32_t kShader[] = {
+#include "shaders/mac_mov.vshinc"
+};
+// clang format on
+
+static constexpr char kInjectedHangTest[] = "InjectedHang";
+static constexpr char kComputeAfterRecoveryTest[] = "ComputeAfterRecovery";
+
+// Deadline used while a hang is injected so that the test does not take kDefaultTimeoutMilliseconds.
+static constexpr uint32_t kInjectedHangTimeoutMilliseconds = 250;
+
+static const XboxMath::vector_t kInput = {1.0f, -2.5f, 0.125f, 1024.0f};
+
+// Mock backend that reports the GPU as busy until it is reset.
+static bool hang_injected = false;
+static bool mock_is_busy() { return hang_injected || GpuWatchdog::kPBKitBackend.is_busy(); }
+static bool mock_try_finish() { return hang_injected || GpuWatchdog::kPBKitBackend.try_finish(); }
+static void mock_reset() {
+  hang_injected = false;
+  GpuWatchdog::kPBKitBackend.reset();
+}
+static const GpuWatchdog::Backend kHangBackend = {
+    mock_is_busy,
+    mock_try_finish,
+    GpuWatchdog::kPBKitBackend.read_dma_pointers,
+    mock_reset,
+};
+
+WatchdogTests::WatchdogTests(TestHost &host, std::string output_dir)
+    : TestSuite(host, std::move(output_dir), "Watchdog Tests") {
+  tests_[kInjectedHangTest] = [this]() { TestInjectedHang(); };
+  tests_[kComputeAfterRecoveryTest] = [this]() { TestComputeAfterRecovery(); };
+}
+
+void WatchdogTests::Initialize() {
+  TestSuite::Initialize();
+
+  results_.clear();
+  computations_.clear();
+
+  auto prepare = [](const std::shared_ptr<VertexShaderProgram> &shader) { shader->SetUniform4F(96, kInput); };
+  results_.emplace_back("mov c[188], c[96]", RES_0);
+  computations_.push_back({kShader, sizeof(kShader), prepare, nullptr, &results_.back()});
+}
+
+bool WatchdogTests::InjectHang() {
+  auto previous_backend = GpuWatchdog::SetBackend(&kHangBackend);
+  auto previous_timeout = GpuWatchdog::Timeout();
+  GpuWatchdog::SetTimeout(kInjectedHangTimeoutMilliseconds);
+
+  hang_injected = true;
+  host_.Compute(computations_);
+  bool fired = GpuWatchdog::HasFired();
+  hang_injected = false;
+
+  GpuWatchdog::SetTimeout(previous_timeout);
+  GpuWatchdog::SetBackend(previous_backend);
+  return fired;
+}
+
+void WatchdogTests::TestInjectedHang() {
+  bool fired = InjectHang();
+
+  host_.Clear();
+  TextOverlay::Reset();
+  TextOverlay::Print("%s: watchdog %s\n", fired ? "PASS" : "FAIL", fired ? "fired" : "did not fire");
+  TextOverlay::Render();
+  GpuWatchdog::WaitForFlip(__func__);
+}
+
+void WatchdogTests::TestComputeAfterRecovery() {
+  // Tests run in name order, so this injects its own hang rather than relying on TestInjectedHang having run first.
+  bool fired = InjectHang();
+
+  // Recover the same way TestSuite::Run does after a test in which the watchdog fired.
+  GpuWatchdog::ClearFired();
+  host_.RestoreState();
+
+  // Cleared so that a result read back during the hang cannot pass.
+  auto &outputs = results_.front().cOut[0];
+  memset(outputs, 0, sizeof(outputs));
+  host_.Compute(computations_);
+
+  bool passed = fired && !GpuWatchdog::HasFired() && !memcmp(outputs, kInput, sizeof(kInput));
+  PrintMsg("Watchdog recovery %s\n", passed ? "passed" : "FAILED");
+
+  host_.DrawResults(results_, allow_saving_, output_dir_, kComputeAfterRecoveryTest);
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "test_host.h"
+#include "test_suite.h"
+
+//! Verifies the GpuWatchdog recovery path by injecting a simulated GPU hang through a mock backend.
+class WatchdogTests : public TestSuite {
+ public:
+  WatchdogTests(TestHost &host, std::string output_dir);
+  void Initialize() override;
+
+ private:
+  void TestInjectedHang();
+  void TestComputeAfterRecovery();
+
+  //! Runs the computation against a backend that never finishes and returns true if the watchdog fired.
+  bool InjectHang();
+
+ private:
+  std::list<TestHost::Computation> computations_;
+  std::list<TestHost::Results> results_;
+};
@@ -0,0 +1,114 @@
+#include "trace_recorder.h"
+
+#include <cstring>
+
+#include "debug_output.h"
+
+TraceRecorder *TraceRecorder::singleton_ = nullptr;
+
+// Chrome trace-event process and thread IDs. Everything is recorded from the main thread.
+static constexpr uint32_t kProcessID = 1;
+static constexpr uint32_t kThreadID = 1;
+
+void TraceRecorder::Initialize(const std::string &trace_path) {
+  ASSERT(!singleton_ && "Invalid attempt to initialize trace recorder twice.");
+
+  singleton_ = new TraceRecorder(trace_path);
+}
+
+TraceRecorder::TraceRecorder(const std::string &trace_path) {
+  const char *p = trace_path.c_str();
+  PrintMsg("Recording trace to %s\n", p);
+
+  file_ = fopen(p, "wb");
+  ASSERT(file_ && "Failed to open trace for output");
+
+  events_ = new Event[kMaxEvents];
+
+  TscClock::CyclesPerMicrosecond();
+  start_time_ = TscClock::Now();
+
+  // The JSON array format is used because viewers accept it even if the run dies before Close terminates it.
+  fputs("[\n", file_);
+  fprintf(file_,
+          R"({"name":"process_name","ph":"M","pid":%u,"tid":%u,"args":{"name":"nxdk_vsh_tests"}},)"
+          "\n",
+          kProcessID, kThreadID);
+}
+
+void TraceRecorder::Close() {
+  if (!singleton_) {
+    return;
+  }
+
+  singleton_->Flush();
+
+  // Terminate the array with an event so that the final record does not end with a trailing comma.
+  auto elapsed = (TscClock::Now() - singleton_->start_time_) / TscClock::CyclesPerMicrosecond();
+  fprintf(singleton_->file_, R"({"name":"run_end","ph":"i","s":"g","pid":%u,"tid":%u,"ts":%llu})"
+                             "\n]\n",
+          kProcessID, kThreadID, elapsed);
+  fclose(singleton_->file_);
+
+  delete[] singleton_->events_;
+  delete singleton_;
+  singleton_ = nullptr;
+}
+
+void TraceRecorder::Record(char phase, const char *category, const char *name) {
+  if (num_events_ == kMaxEvents) {
+    Flush();
+  }
+
+  auto &event = events_[num_events_++];
+  event.timestamp = TscClock::Now();
+  event.phase = phase;
+  event.category = category;
+  if (name) {
+    strncpy(event.name, name, sizeof(event.name) - 1);
+    event.name[sizeof(event.name) - 1] = 0;
+  } else {
+    event.name[0] = 0;
+  }
+}
+
+void TraceRecorder::Flush() {
+  Event flush_begin{TscClock::Now(), 'B', "trace", "TraceRecorder::Flush"};
+
+  for (uint32_t i = 0; i < num_events_; ++i) {
+    WriteEvent(events_[i]);
+  }
+  num_events_ = 0;
+
+  WriteEvent(flush_begin);
+  fflush(file_);
+  WriteEvent({TscClock::Now(), 'E', nullptr, ""});
+}
+
+void TraceRecorder::WriteEvent(const Event &event) {
+  // Timestamps are in microseconds with nanosecond precision.
+  auto cycles_per_microsecond = TscClock::CyclesPerMicrosecond();
+  auto elapsed = event.timestamp - start_time_;
+  auto microseconds = elapsed / cycles_per_microsecond;
+  auto nanoseconds = (elapsed % cycles_per_microsecond) * 1000 / cycles_per_microsecond;
+
+  fprintf(file_, R"({"ph":"%c","pid":%u,"tid":%u,"ts":%llu.%03llu)", event.phase, kProcessID, kThreadID, microseconds,
+          nanoseconds);
+
+  if (event.phase == 'B') {
+    fprintf(file_, R"(,"cat":"%s","name":")", event.category);
+    for (auto c = event.name; *c; ++c) {
+      if (static_cast<unsigned char>(*c) < 0x20) {
+        fprintf(file_, "\\u%04X", static_cast<unsigned char>(*c));
+        continue;
+      }
+      if (*c == '"' || *c == '\\') {
+        fputc('\\', file_);
+      }
+      fputc(*c, file_);
+    }
+    fputc('"', file_);
+  }
+
+  fputs("},\n", file_);
+}
@@ -0,0 +1,69 @@
+#ifndef NXDK_VSH_TESTS_TRACE_RECORDER_H
+#define NXDK_VSH_TESTS_TRACE_RECORDER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "tsc_clock.h"
+
+//! Records begin/end events for tests, computations, pushbuffer flushes and GPU waits as a Chrome trace-event JSON
+//! timeline that can be loaded in chrome://tracing or https://ui.perfetto.dev.
+//!
+//! Events are written into a fixed size in-memory ring and only serialized when the ring fills up or the recorder is
+//! closed, so recording is a handful of stores. Events are only recorded from the main thread, so the ring needs no
+//! synchronization. Flushes show up in the timeline as "TraceRecorder::Flush" so their cost is not mistaken for a stall.
+class TraceRecorder {
+ public:
+  //! Records a begin event on construction and the matching end event on destruction.
+  class Scope {
+   public:
+    Scope(const char *category, const char *name) {
+      if (singleton_) {
+        singleton_->Record('B', category, name);
+      }
+    }
+    Scope(const char *category, const std::string &name) : Scope(category, name.c_str()) {}
+    ~Scope() {
+      if (singleton_) {
+        singleton_->Record('E', nullptr, nullptr);
+      }
+    }
+  };
+
+ public:
+  //! Creates (or truncates) the trace file at the given path and starts recording.
+  static void Initialize(const std::string &trace_path);
+
+  static bool IsEnabled() { return singleton_ != nullptr; }
+
+  //! Serializes any buffered events, terminates the JSON array and closes the trace file.
+  static void Close();
+
+ private:
+  struct Event {
+    uint64_t timestamp;
+    char phase;
+    const char *category;
+    // Names are copied because test and result titles may be released before the ring is flushed.
+    char name[48];
+  };
+
+  static constexpr uint32_t kMaxEvents = 16384;
+
+  explicit TraceRecorder(const std::string &trace_path);
+
+  void Record(char phase, const char *category, const char *name);
+  void Flush();
+  void WriteEvent(const Event &event);
+
+ private:
+  FILE *file_{nullptr};
+  Event *events_{nullptr};
+  uint32_t num_events_{0};
+  uint64_t start_time_{0};
+
+  static TraceRecorder *singleton_;
+};
+
+#endif  // NXDK_VSH_TESTS_TRACE_RECORDER_H
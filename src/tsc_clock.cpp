@@ -0,0 +1,35 @@
+#include "tsc_clock.h"
+
+#include <windows.h>
+
+#include "debug_output.h"
+
+// Duration of the calibration, long enough to make the error from the performance counter negligible.
+static constexpr uint32_t kCalibrationMilliseconds = 50;
+
+// Nominal clock of a retail Xbox CPU, used if calibration fails.
+static constexpr uint64_t kDefaultCyclesPerMicrosecond = 733;
+
+uint64_t TscClock::CyclesPerMicrosecond() {
+  static uint64_t cycles_per_microsecond = 0;
+  if (cycles_per_microsecond) {
+    return cycles_per_microsecond;
+  }
+
+  LARGE_INTEGER frequency, counter_start, counter_end;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter_start);
+  auto tsc_start = Now();
+  Sleep(kCalibrationMilliseconds);
+  QueryPerformanceCounter(&counter_end);
+  auto tsc_end = Now();
+
+  auto elapsed_microseconds = (counter_end.QuadPart - counter_start.QuadPart) * 1000000 / frequency.QuadPart;
+  cycles_per_microsecond = elapsed_microseconds > 0 ? (tsc_end - tsc_start) / elapsed_microseconds : 0;
+  if (!cycles_per_microsecond) {
+    cycles_per_microsecond = kDefaultCyclesPerMicrosecond;
+  }
+
+  PrintMsg("Time stamp counter runs at %llu cycles per microsecond\n", cycles_per_microsecond);
+  return cycles_per_microsecond;
+}
@@ -0,0 +1,17 @@
+#ifndef NXDK_VSH_TESTS_TSC_CLOCK_H
+#define NXDK_VSH_TESTS_TSC_CLOCK_H
+
+#include <x86intrin.h>
+
+#include <cstdint>
+
+//! Reads the CPU time stamp counter, which has far finer resolution than GetTickCount or std::chrono on the Xbox.
+class TscClock {
+ public:
+  static uint64_t Now() { return __rdtsc(); }
+
+  //! Returns the number of counter ticks per microsecond, calibrating against the performance counter on first use.
+  static uint64_t CyclesPerMicrosecond();
+};
+
+#endif  // NXDK_VSH_TESTS_TSC_CLOCK_H
@@ -0,0 +1,73 @@
+#include "ulp_histogram.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "debug_output.h"
+
+static uint32_t as_uint(float value) {
+  uint32_t ret;
+  memcpy(&ret, &value, sizeof(ret));
+  return ret;
+}
+
+static bool is_nan(uint32_t bits) { return (bits & 0x7F800000) == 0x7F800000 && (bits & 0x007FFFFF); }
+
+uint32_t UlpHistogram::Bucket(float a, float b) {
+  const uint32_t a_bits = as_uint(a);
+  const uint32_t b_bits = as_uint(b);
+
+  const bool a_nan = is_nan(a_bits);
+  const bool b_nan = is_nan(b_bits);
+  if (a_nan || b_nan) {
+    return a_nan == b_nan ? 0 : kBucketNaN;
+  }
+
+  const uint32_t a_magnitude = a_bits & 0x7FFFFFFF;
+  const uint32_t b_magnitude = b_bits & 0x7FFFFFFF;
+  if ((a_bits ^ b_bits) & 0x80000000) {
+    return !a_magnitude && !b_magnitude ? 0 : kBucketSign;
+  }
+
+  // Floats of the same sign are ordered by the integer value of their magnitude.
+  const uint32_t distance = a_magnitude > b_magnitude ? a_magnitude - b_magnitude : b_magnitude - a_magnitude;
+  return distance ? 32 - __builtin_clz(distance) : 0;
+}
+
+void UlpHistogram::Record(const char *opcode, const float *input, const float *hw_result, const float *cpu_result,
+                          bool x_only) {
+  auto &counts = counts_[opcode];
+  for (uint32_t lane = 0; lane < 4; ++lane) {
+    const uint32_t input_bits = as_uint(input[x_only ? 0 : lane]);
+    const uint32_t sign = input_bits >> 31;
+    const uint32_t exponent = (input_bits >> 23) & 0xFF;
+    ++counts[Key(lane, sign, exponent, Bucket(hw_result[lane], cpu_result[lane]))];
+  }
+}
+
+void UlpHistogram::WriteCSV(const std::string &path) const {
+  std::ofstream csv(path.c_str(), std::ios_base::out | std::ios_base::trunc);
+  if (!csv) {
+    PrintMsg("Failed to open ULP histogram output %s\n", path.c_str());
+    return;
+  }
+
+  static constexpr const char kLanes[] = "xyzw";
+  csv << "opcode,lane,input_sign,input_exponent,bucket,count" << std::endl;
+  for (auto &opcode : counts_) {
+    for (auto &item : opcode.second) {
+      const uint32_t key = item.first;
+      const uint32_t bucket = key & 0x3F;
+      csv << opcode.first << "," << kLanes[(key >> 15) & 0x03] << "," << ((key >> 14) & 0x01 ? "-" : "+") << ","
+          << ((key >> 6) & 0xFF) << ",";
+      if (bucket == kBucketSign) {
+        csv << "sign";
+      } else if (bucket == kBucketNaN) {
+        csv << "nan";
+      } else {
+        csv << bucket;
+      }
+      csv << "," << item.second << "\n";
+    }
+  }
+}
@@ -0,0 +1,41 @@
+#ifndef NXDK_VSH_TESTS_ULP_HISTOGRAM_H
+#define NXDK_VSH_TESTS_ULP_HISTOGRAM_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+//! Accumulates the distance in units in the last place between hardware and CPU reference results so that the accuracy
+//! of each operation can be characterized rather than reduced to pass/fail.
+//!
+//! Distances are counted per opcode, output lane, and the sign and biased exponent of the input that produced the lane,
+//! in power of two buckets: bucket 0 is an exact match and bucket k (1 <= k <= 31) covers [2^(k-1), 2^k - 1] ULPs.
+//! Results of opposite sign and results where exactly one side is NaN are counted in separate buckets. The histogram is
+//! written as CSV by WriteCSV, see scripts/ulp_histogram.py.
+class UlpHistogram {
+ public:
+  static constexpr uint32_t kBucketSign = 33;
+  static constexpr uint32_t kBucketNaN = 34;
+
+ public:
+  //! Records the four lanes of a result. `input` is the vector of the first operand. If `x_only` is set, every lane is
+  //! attributed to input.x (e.g., for ILU operations), otherwise each lane is attributed to the same lane of the input.
+  void Record(const char *opcode, const float *input, const float *hw_result, const float *cpu_result, bool x_only);
+
+  //! Returns the bucket of the distance between two floats. Zeros of either sign and NaNs of any form are equal.
+  static uint32_t Bucket(float a, float b);
+
+  //! Writes "opcode,lane,input_sign,input_exponent,bucket,count" rows.
+  void WriteCSV(const std::string &path) const;
+
+ private:
+  // Packs lane (2 bits), sign (1 bit), exponent (8 bits) and bucket (6 bits).
+  static uint32_t Key(uint32_t lane, uint32_t sign, uint32_t exponent, uint32_t bucket) {
+    return (lane << 15) | (sign << 14) | (exponent << 6) | bucket;
+  }
+
+ private:
+  std::map<std::string, std::map<uint32_t, uint32_t>> counts_;
+};
+
+#endif  // NXDK_VSH_TESTS_ULP_HISTOGRAM_H